@@ -0,0 +1,107 @@
+#include "benchmarks.hpp"
+#include "test_config.hpp"
+
+#include <imglib/adaptors/jpeg_adaptor.hpp>
+#include <imglib/adaptors/png_adaptor.hpp>
+#include <imglib/algorithms/geometric_modifications.hpp>
+#include <imglib/algorithms/resize.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace imglib;
+
+namespace
+{
+    // Runs func numRuns times and returns the throughput in source megapixels per second.
+    template <typename Func>
+    double MeasureThroughput(size_t numPixels, size_t numRuns, Func&& func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < numRuns; i++)
+            func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        return numPixels * numRuns / elapsed.count() / 1e6;
+    }
+}
+
+void BenchmarkResize()
+{
+    std::wstring inImgPath{ input_img_path };
+    inImgPath += L"/petit_prince.jpg";
+    auto img = jpeg::Read(inImgPath);
+
+    constexpr size_t numRuns{ 10 };
+
+    std::cout << "Source: " << img.width() << " x " << img.height() << " x " << img.num_channels() << ", MP/s of source pixels" << std::endl;
+    std::cout << std::setw(8) << "factor" << std::setw(12) << "Shrink" << std::setw(12) << "Bilinear" << std::setw(12) << "Bicubic" << std::setw(12) << "Lanczos3" << std::endl;
+
+    for (size_t factor : { 2, 3, 4, 8 })
+    {
+        size_t height = img.height() / factor;
+        size_t width = img.width() / factor;
+
+        std::cout << std::setw(8) << factor << std::fixed << std::setprecision(1);
+        std::cout << std::setw(12) << MeasureThroughput(img.size(), numRuns, [&]() { algorithm::Shrink(img, factor); });
+
+        for (auto filter : { algorithm::ResizeFilter::Bilinear, algorithm::ResizeFilter::Bicubic, algorithm::ResizeFilter::Lanczos3 })
+            std::cout << std::setw(12) << MeasureThroughput(img.size(), numRuns, [&]() { algorithm::Resize(img, height, width, filter); });
+
+        std::cout << std::endl;
+    }
+}
+
+void BenchmarkPngEncode()
+{
+    constexpr size_t numRuns{ 3 };
+
+    struct Setting
+    {
+        const char* name;
+        png::PngWriteOptions options;
+    };
+
+    const Setting settings[]
+    {
+        { "store", { 0, png::CompressionStrategy::Default, 8, 15, png::RowFilter::None } },
+        { "1 rle up", { 1, png::CompressionStrategy::Rle, 8, 15, png::RowFilter::Up } },
+        { "1 rle sub", { 1, png::CompressionStrategy::Rle, 8, 15, png::RowFilter::Sub } },
+        { "1 filtered up", { 1, png::CompressionStrategy::Filtered, 8, 15, png::RowFilter::Up } },
+        { "3 filtered paeth", { 3, png::CompressionStrategy::Filtered, 8, 15, png::RowFilter::Paeth } },
+        { "6 adaptive", { 6, png::CompressionStrategy::Filtered, 8, 15, png::RowFilter::Adaptive } },
+        { "9 adaptive", { 9, png::CompressionStrategy::Filtered, 9, 15, png::RowFilter::Adaptive } },
+        { "9 default none", { 9, png::CompressionStrategy::Default, 9, 15, png::RowFilter::None } },
+        { "6 adaptive 4 thr", { 6, png::CompressionStrategy::Filtered, 8, 15, png::RowFilter::Adaptive, 8192, 4 } },
+        { "6 adaptive all thr", { 6, png::CompressionStrategy::Filtered, 8, 15, png::RowFilter::Adaptive, 8192, 0 } },
+        { "9 adaptive all thr", { 9, png::CompressionStrategy::Filtered, 9, 15, png::RowFilter::Adaptive, 8192, 0 } }
+    };
+
+    std::wstring outImgPath{ output_img_path };
+    outImgPath += L"/png_encode_benchmark.png";
+
+    for (auto name : { L"/petit_prince.jpg", L"/petit_prince_grayscale.jpg" })
+    {
+        std::wstring inImgPath{ input_img_path };
+        inImgPath += name;
+        auto img = jpeg::Read(inImgPath);
+
+        // Converted once, so the runs do not copy the image into the variant.
+        const png::PngImg pngImg{ img };
+
+        std::cout << "Source: " << img.width() << " x " << img.height() << " x " << img.num_channels() << ", MP/s and size in percent of the raw data" << std::endl;
+        std::cout << std::setw(20) << "setting" << std::setw(12) << "MP/s" << std::setw(12) << "size %" << std::endl;
+
+        for (const auto& setting : settings)
+        {
+            double throughput = MeasureThroughput(img.size(), numRuns, [&]() { png::Write(pngImg, outImgPath, setting.options); });
+            double ratio = 100.0 * std::filesystem::file_size(outImgPath) / img.data_size();
+            std::cout << std::setw(20) << setting.name << std::fixed << std::setprecision(1) << std::setw(12) << throughput << std::setw(12) << ratio << std::endl;
+        }
+
+        std::cout << std::endl;
+    }
+}
@@ -1,4 +1,5 @@
 #include "convolution_tests.hpp"
+#include "benchmarks.hpp"
 
 #include <imglib/image/channel.hpp>
 #include <iterator>
@@ -28,6 +29,8 @@ int main(void)
 	// GenerateAveragedImages();
 	// GenerateEdgeDetectedImages();
 	// GenerateGradientImages();
+	// BenchmarkResize();
+	// BenchmarkPngEncode();
 	return 0;
 }
 
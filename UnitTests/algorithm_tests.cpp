@@ -1,12 +1,23 @@
 #include "pch.h"
 #include "test_helpers.h"
 
+#include <cmath>
 #include <numeric>
 #include <array>
 
 #include <imglib/adaptors/jpeg_adaptor.hpp>
 #include <imglib/algorithms/image_generation.hpp>
 #include <imglib/algorithms/histogram.hpp>
+#include <imglib/algorithms/histogram_equalization.hpp>
+#include <imglib/algorithms/local_statistics.hpp>
+#include <imglib/algorithms/geometric_modifications.hpp>
+#include <imglib/algorithms/image_pyramid.hpp>
+#include <imglib/algorithms/resize.hpp>
+#include <imglib/algorithms/orientation.hpp>
+#include <imglib/algorithms/warp.hpp>
+#include <imglib/algorithms/remap.hpp>
+#include <imglib/algorithms/compositing.hpp>
+#include <imglib/algorithms/bit_depth_conversion.hpp>
 #include <imglib/image/image.hpp>
 
 using namespace imglib;
@@ -189,4 +200,846 @@ TEST(AlgorithmTests, histogram_test2)
     for (size_t j = histImg.width() - 1; j > histImg.width() - 1 - settings.padding; j--)
         for (size_t i = 0; i < histImg.height(); i++)
             EXPECT_EQ(histImg(0)(i, j), settings.back(0));
-}
\ No newline at end of file
+}
+
+TEST(AlgorithmTests, histogram_test3)
+{
+    // Maximum value of the data range is counted in the last bin
+    auto ch1 = Channel<std::uint8_t>(4, 4, 255);
+    ch1(0) = 0;
+    auto histVec1 = algorithm::get_histogram(ch1, 10);
+    EXPECT_EQ(histVec1[0], 1);
+    EXPECT_EQ(histVec1[9], 15);
+
+    auto ch2 = Channel<std::uint16_t>(3, 7, 0);
+    ch2(5) = 65535;
+    ch2(6) = 32768;
+    auto histVec2 = algorithm::get_histogram(ch2, 4);
+    EXPECT_EQ(histVec2[0], 19);
+    EXPECT_EQ(histVec2[1], 0);
+    EXPECT_EQ(histVec2[2], 1);
+    EXPECT_EQ(histVec2[3], 1);
+
+    EXPECT_THROW(algorithm::get_histogram(ch2, 0), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, histogram_parallel)
+{
+    auto ch8 = Channel<std::uint8_t>(517, 631, 0);
+    auto ch16 = Channel<std::uint16_t>(517, 631, 0);
+    for (size_t i = 0; i < ch8.size(); i++)
+    {
+        ch8(i) = static_cast<std::uint8_t>((i * 7919) % 256);
+        ch16(i) = static_cast<std::uint16_t>((i * 104729) % 65536);
+    }
+
+    for (size_t numBins : { 1, 10, 64, 256 })
+    {
+        auto hist8 = algorithm::get_histogram(ch8, numBins);
+        EXPECT_EQ(hist8, algorithm::get_histogram_parallel(ch8, numBins, 4));
+        EXPECT_EQ(std::accumulate(hist8.begin(), hist8.end(), size_t{ 0 }), ch8.size());
+
+        auto hist16 = algorithm::get_histogram(ch16, numBins);
+        EXPECT_EQ(hist16, algorithm::get_histogram_parallel(ch16, numBins, 4));
+        EXPECT_EQ(std::accumulate(hist16.begin(), hist16.end(), size_t{ 0 }), ch16.size());
+    }
+}
+
+TEST(AlgorithmTests, histogram_region)
+{
+    auto ch = Channel<std::uint8_t>(6, 8, 0);
+    Rectangle2D<size_t> box{ Point2D{ 1, 2 }, 3, 4 };
+    for (size_t i = 1; i < 4; i++)
+        for (size_t j = 2; j < 6; j++)
+            ch(i, j) = 200;
+
+    auto histVec = algorithm::get_histogram(ch, box, 4);
+    EXPECT_EQ(histVec[0], 0);
+    EXPECT_EQ(histVec[3], 12);
+}
+
+TEST(AlgorithmTests, equalize_histogram)
+{
+    auto ch = Channel<std::uint8_t>(4, 4, 100);
+    for (size_t i = 8; i < 16; i++)
+        ch(i) = 110;
+
+    auto eq = algorithm::equalize_histogram(ch);
+    EXPECT_EQ(eq(0), 0);
+    EXPECT_EQ(eq(15), 255);
+
+    // Constant channels are left unchanged
+    auto constant = Channel<std::uint16_t>(3, 3, 1234);
+    auto eq2 = algorithm::equalize_histogram(constant);
+    EXPECT_TRUE(helpers::AllPixelsEqualTo<std::uint16_t>(eq2.data(), eq2.size(), 1234));
+}
+
+TEST(AlgorithmTests, match_histogram)
+{
+    auto ch = Channel<std::uint8_t>(4, 4, 10);
+    for (size_t i = 8; i < 16; i++)
+        ch(i) = 20;
+
+    auto reference = Channel<std::uint8_t>(2, 2, 50);
+    reference(2) = 150;
+    reference(3) = 150;
+
+    auto matched = algorithm::match_histogram(ch, reference);
+    EXPECT_EQ(matched(0), 50);
+    EXPECT_EQ(matched(15), 150);
+
+    auto identity = algorithm::match_histogram(ch, ch);
+    EXPECT_TRUE(std::equal(identity.cbegin(), identity.cend(), ch.cbegin()));
+}
+
+TEST(AlgorithmTests, clahe)
+{
+    // A single tile without clipping is plain cumulative mapping
+    auto ch = Channel<std::uint8_t>(8, 8, 10);
+    for (size_t i = 32; i < 64; i++)
+        ch(i) = 200;
+
+    algorithm::ClaheSettings settings;
+    settings.tile_rows = 1;
+    settings.tile_columns = 1;
+    settings.clip_limit = 0;
+    auto out = algorithm::clahe(ch, settings);
+    EXPECT_EQ(out(0), 128);
+    EXPECT_EQ(out(63), 255);
+
+    // Constant channels map to a constant output
+    auto constant = Channel<std::uint16_t>(64, 48, 4000);
+    auto out2 = algorithm::clahe(constant, algorithm::ClaheSettings{ 4, 3, 2.0, 1024 });
+    EXPECT_TRUE(helpers::AllPixelsEqualTo<std::uint16_t>(out2.data(), out2.size(), out2(0)));
+
+    EXPECT_THROW(algorithm::clahe(ch, algorithm::ClaheSettings{ 9, 1 }), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, local_statistics)
+{
+    auto ch = Channel<std::uint8_t>(9, 11, 0);
+    for (size_t i = 0; i < ch.size(); i++)
+        ch(i) = static_cast<std::uint8_t>((i * 37) % 251);
+
+    for (size_t radius : { 0, 1, 2, 4, 12 })
+    {
+        algorithm::LocalStatisticsSettings settings;
+        settings.radius = radius;
+        settings.num_threads = 3;
+        auto stats = algorithm::get_local_statistics(ch, settings);
+
+        // Compare with a brute force evaluation of every window
+        for (size_t row = 0; row < ch.num_rows(); row++)
+        {
+            for (size_t col = 0; col < ch.num_columns(); col++)
+            {
+                size_t r0 = row > radius ? row - radius : 0, r1 = std::min(row + radius, ch.num_rows() - 1);
+                size_t c0 = col > radius ? col - radius : 0, c1 = std::min(col + radius, ch.num_columns() - 1);
+
+                double sum{ 0 }, sqSum{ 0 };
+                std::uint8_t minVal{ 255 }, maxVal{ 0 };
+                for (size_t i = r0; i <= r1; i++)
+                {
+                    for (size_t j = c0; j <= c1; j++)
+                    {
+                        sum += ch(i, j);
+                        sqSum += ch(i, j) * ch(i, j);
+                        minVal = std::min(minVal, ch(i, j));
+                        maxVal = std::max(maxVal, ch(i, j));
+                    }
+                }
+
+                double count = static_cast<double>((r1 - r0 + 1) * (c1 - c0 + 1));
+                double mean = sum / count;
+                EXPECT_NEAR(stats.mean(row, col), mean, 1e-9);
+                EXPECT_NEAR(stats.variance(row, col), sqSum / count - mean * mean, 1e-6);
+                EXPECT_EQ(stats.min(row, col), minVal);
+                EXPECT_EQ(stats.max(row, col), maxVal);
+            }
+        }
+    }
+
+    algorithm::LocalStatisticsSettings meanOnly{ 2, true, false, false };
+    auto stats = algorithm::get_local_statistics(ch, meanOnly);
+    EXPECT_FALSE(stats.mean.empty());
+    EXPECT_TRUE(stats.variance.empty());
+    EXPECT_TRUE(stats.min.empty());
+}
+
+TEST(AlgorithmTests, local_histogram)
+{
+    auto ch = Channel<std::uint8_t>(6, 7, 0);
+    for (size_t i = 0; i < ch.size(); i++)
+        ch(i) = static_cast<std::uint8_t>((i * 53) % 256);
+
+    size_t radius{ 1 }, numBins{ 8 };
+    algorithm::for_each_local_histogram(ch, radius, numBins, [&](size_t row, size_t col, const std::vector<size_t>& hist)
+        {
+            size_t r0 = row > radius ? row - radius : 0, r1 = std::min(row + radius, ch.num_rows() - 1);
+            size_t c0 = col > radius ? col - radius : 0, c1 = std::min(col + radius, ch.num_columns() - 1);
+            auto expected = algorithm::get_histogram(ch, Rectangle2D<size_t>{ Point2D{ r0, c0 }, r1 - r0 + 1, c1 - c0 + 1 }, numBins);
+            EXPECT_EQ(hist, expected);
+        });
+}
+
+TEST(AlgorithmTests, fill_rectangle)
+{
+    Image<std::uint16_t> img{ 6, 5, ColorSpace::RGB, 3, 7 };
+    algorithm::fill_rectangle(img, Rectangle2D<size_t>{ Point2D{ 1, 2 }, 4, 3 }, Color<std::uint16_t, 3>{ ColorSpace::RGB, 1, 2, 3 });
+
+    for (size_t t = 0; t < 3; t++)
+    {
+        size_t sum = std::accumulate(img(t).begin(), img(t).end(), size_t{ 0 });
+        EXPECT_EQ(sum, 18 * 7 + 12 * (t + 1));
+        EXPECT_EQ(img(t)(1, 2), t + 1);
+        EXPECT_EQ(img(t)(4, 4), t + 1);
+        EXPECT_EQ(img(t)(0, 2), 7);
+        EXPECT_EQ(img(t)(1, 1), 7);
+    }
+
+    EXPECT_THROW(algorithm::fill_rectangle(img(0), Rectangle2D<size_t>{ Point2D{ 3, 3 }, 4, 1 }, std::uint16_t{ 0 }), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, histogram_atlas)
+{
+    algorithm::HistogramImageSettings<std::uint8_t, 1> settings;
+    settings.bin_width = 4;
+    settings.num_bins = 8;
+    settings.max_bin_height = 20;
+    settings.padding = 3;
+    settings.front = Color<std::uint8_t, 1>{ ColorSpace::GrayScale, 0 };
+    settings.back = Color<std::uint8_t, 1>{ ColorSpace::GrayScale, 255 };
+
+    auto ch1 = Channel<std::uint8_t>(4, 4, 10);
+    auto ch2 = Channel<std::uint8_t>(4, 4, 100);
+    auto ch3 = Channel<std::uint8_t>(4, 4, 200);
+    ch3(0) = 0;
+
+    auto atlas = algorithm::get_histogram_atlas(std::vector<Channel<std::uint8_t> const*>{ &ch1, &ch2, &ch3 }, settings, 2);
+
+    size_t tileHeight = settings.max_bin_height + 2 * settings.padding;
+    size_t tileWidth = settings.num_bins * settings.bin_width + 2 * settings.padding;
+    EXPECT_EQ(atlas.height(), 2 * tileHeight);
+    EXPECT_EQ(atlas.width(), 2 * tileWidth);
+
+    // Every tile is identical to the separately rendered histogram image
+    std::vector<Channel<std::uint8_t> const*> channels{ &ch1, &ch2, &ch3 };
+    for (size_t k = 0; k < channels.size(); k++)
+    {
+        auto histImg = algorithm::get_histogram_image(*channels[k], settings);
+        size_t rowOffset = (k / 2) * tileHeight, colOffset = (k % 2) * tileWidth;
+        for (size_t i = 0; i < tileHeight; i++)
+            for (size_t j = 0; j < tileWidth; j++)
+                EXPECT_EQ(atlas(0)(rowOffset + i, colOffset + j), histImg(0)(i, j));
+    }
+
+    // The unused tile is background
+    for (size_t i = tileHeight; i < atlas.height(); i++)
+        for (size_t j = tileWidth; j < atlas.width(); j++)
+            EXPECT_EQ(atlas(0)(i, j), 255);
+}
+
+namespace
+{
+    template <typename T>
+    Image<T> ShrinkReference(const Image<T>& img, size_t amount)
+    {
+        Image<T> out(img.height() / amount, img.width() / amount, img.color_space(), img.num_channels());
+        for (size_t t = 0; t < img.num_channels(); t++)
+        {
+            for (size_t i = 0; i < out.height(); i++)
+            {
+                for (size_t j = 0; j < out.width(); j++)
+                {
+                    double sum{ 0 };
+                    for (size_t k = 0; k < amount; k++)
+                        for (size_t l = 0; l < amount; l++)
+                            sum += img(t)(i * amount + k, j * amount + l);
+
+                    out(t)(i, j) = std::is_integral_v<T> ? static_cast<T>(std::floor(sum / (amount * amount) + 0.5)) : static_cast<T>(sum / (amount * amount));
+                }
+            }
+        }
+        return out;
+    }
+
+    template <typename T>
+    void FillPattern(Image<T>& img, size_t seed)
+    {
+        for (size_t t = 0; t < img.num_channels(); t++)
+            for (size_t i = 0; i < img.size(); i++)
+                img(t)(i) = static_cast<T>((i * 2654435761u + seed * 97 + t * 31) % (static_cast<size_t>(std::numeric_limits<T>::max()) + 1));
+    }
+}
+
+TEST(AlgorithmTests, shrink)
+{
+    Image<std::uint8_t> img8{ 167, 193, ColorSpace::RGB, 3 };
+    Image<std::uint16_t> img16{ 167, 193, ColorSpace::RGB, 3 };
+    FillPattern(img8, 1);
+    FillPattern(img16, 2);
+
+    for (size_t amount : { 2, 3, 4, 5, 8 })
+    {
+        auto shrinked8 = algorithm::Shrink(img8, amount, 3);
+        auto expected8 = ShrinkReference(img8, amount);
+        auto shrinked16 = algorithm::Shrink(img16, amount, 3);
+        auto expected16 = ShrinkReference(img16, amount);
+
+        ASSERT_EQ(shrinked8.height(), 167 / amount);
+        ASSERT_EQ(shrinked8.width(), 193 / amount);
+        for (size_t t = 0; t < 3; t++)
+        {
+            EXPECT_TRUE(std::equal(shrinked8(t).cbegin(), shrinked8(t).cend(), expected8(t).cbegin()));
+            EXPECT_TRUE(std::equal(shrinked16(t).cbegin(), shrinked16(t).cend(), expected16(t).cbegin()));
+        }
+    }
+
+    // Averages are rounded to the nearest value
+    Image<std::uint8_t> img{ 2, 2, ColorSpace::GrayScale, 1, 0 };
+    img(0)(0) = 1;
+    img(0)(1) = 1;
+    EXPECT_EQ(algorithm::Shrink(img, 2)(0)(0), 1);
+
+    Image<float> imgf{ 4, 4, ColorSpace::GrayScale, 1, 0.5f };
+    imgf(0)(0) = 1.5f;
+    EXPECT_FLOAT_EQ(algorithm::Shrink(imgf, 2)(0)(0), 0.75f);
+
+    EXPECT_THROW(algorithm::Shrink(img, 0), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, image_pyramid_box)
+{
+    Image<std::uint8_t> img{ 123, 77, ColorSpace::RGB, 3 };
+    FillPattern(img, 3);
+
+    algorithm::ImagePyramid<std::uint8_t> pyramid{ img, 5 };
+    EXPECT_EQ(pyramid.num_levels(), 5);
+    EXPECT_EQ(pyramid.num_channels(), 3);
+
+    // Every level equals the previous level shrinked by 2
+    auto level = img;
+    for (size_t l = 0; l < pyramid.num_levels(); l++)
+    {
+        ASSERT_EQ(pyramid.height(l), level.height());
+        ASSERT_EQ(pyramid.width(l), level.width());
+
+        for (size_t t = 0; t < 3; t++)
+        {
+            auto view = pyramid(l, t);
+            EXPECT_TRUE(std::equal(view.begin(), view.end(), level(t).cbegin()));
+            EXPECT_TRUE(std::equal(view.crbegin(), view.crend(), level(t).crbegin()));
+
+            const size_t lastRow = view.num_rows() - 1;
+            EXPECT_TRUE(std::equal(view.crow_begin(lastRow), view.crow_end(lastRow), level(t).crow_begin(lastRow)));
+            EXPECT_TRUE(std::equal(view.crrow_begin(0), view.crrow_end(0), level(t).crrow_begin(0)));
+            EXPECT_EQ(*view.cgit(lastRow, 0), *level(t).cgit(lastRow, 0));
+        }
+
+        if (l + 1 < pyramid.num_levels())
+            level = algorithm::Shrink(level, 2);
+    }
+
+    auto img2 = pyramid.image(2);
+    EXPECT_EQ(img2.height(), 30);
+    EXPECT_EQ(img2.width(), 19);
+    EXPECT_EQ(img2.color_space(), ColorSpace::RGB);
+
+    EXPECT_THROW((algorithm::ImagePyramid<std::uint8_t>{ img, 8 }), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, image_pyramid_gaussian)
+{
+    Image<std::uint16_t> img{ 40, 64, ColorSpace::GrayScale, 1, 1000 };
+    algorithm::ImagePyramid<std::uint16_t> pyramid{ img, 4, algorithm::PyramidFilter::Gaussian };
+
+    for (size_t l = 0; l < pyramid.num_levels(); l++)
+    {
+        EXPECT_EQ(pyramid.height(l), 40 >> l);
+        EXPECT_EQ(pyramid.width(l), 64 >> l);
+
+        // A constant image stays constant
+        auto view = pyramid(l, 0);
+        EXPECT_TRUE(std::all_of(view.begin(), view.end(), [](std::uint16_t val) { return val == 1000; }));
+    }
+
+    // A single bright pixel is spread with the binomial weights
+    Image<float> imgf{ 16, 16, ColorSpace::GrayScale, 1, 0.0f };
+    imgf(0)(8, 8) = 256.0f;
+    algorithm::ImagePyramid<float> pyramidf{ imgf, 2, algorithm::PyramidFilter::Gaussian };
+    EXPECT_FLOAT_EQ(pyramidf(1, 0)(4, 4), 36.0f);
+    EXPECT_FLOAT_EQ(pyramidf(1, 0)(4, 5), 6.0f);
+    EXPECT_FLOAT_EQ(pyramidf(1, 0)(5, 5), 1.0f);
+}
+
+TEST(AlgorithmTests, resize)
+{
+    const std::array<algorithm::ResizeFilter, 3> filters{ algorithm::ResizeFilter::Bilinear, algorithm::ResizeFilter::Bicubic, algorithm::ResizeFilter::Lanczos3 };
+
+    Image<std::uint8_t> img{ 37, 53, ColorSpace::RGB, 3 };
+    FillPattern(img, 4);
+
+    CImage<std::uint8_t, 3> cimg{ 37, 53, ColorSpace::RGB };
+    PImage<std::uint8_t, 3> pimg{ 37, 53, ColorSpace::RGB };
+    for (size_t i = 0; i < img.size(); i++)
+    {
+        cimg.set_pixel(i, img(0)(i), img(1)(i), img(2)(i));
+        pimg(i) = Pixel<std::uint8_t, 3>{ img(0)(i), img(1)(i), img(2)(i) };
+    }
+
+    for (auto filter : filters)
+    {
+        // Same size is the identity
+        auto same = algorithm::Resize(img, 37, 53, filter);
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_TRUE(std::equal(same(t).cbegin(), same(t).cend(), img(t).cbegin()));
+
+        // Planar and interleaved containers give the same result
+        for (auto [height, width] : { std::pair<size_t, size_t>{ 16, 20 }, { 80, 111 }, { 5, 140 } })
+        {
+            auto resized = algorithm::Resize(img, height, width, filter, 2);
+            auto cresized = algorithm::Resize(cimg, height, width, filter, 2);
+            auto presized = algorithm::Resize(pimg, height, width, filter, 2);
+
+            ASSERT_EQ(resized.height(), height);
+            ASSERT_EQ(resized.width(), width);
+            ASSERT_EQ(cresized.height(), height);
+            ASSERT_EQ(presized.width(), width);
+
+            for (size_t i = 0; i < resized.size(); i++)
+            {
+                for (size_t t = 0; t < 3; t++)
+                {
+                    EXPECT_EQ(resized(t)(i), cresized(i, t));
+                    EXPECT_EQ(resized(t)(i), presized(i).p[t]);
+                }
+            }
+        }
+
+        // Flat areas stay flat
+        Image<std::uint16_t> flat{ 20, 30, ColorSpace::GrayScale, 1, 40000 };
+        auto flatResized = algorithm::Resize(flat, 47, 9, filter);
+        EXPECT_TRUE(helpers::AllPixelsEqualTo<std::uint16_t>(flatResized(0).data(), flatResized.size(), 40000));
+
+        // 8-bit results are rounded once, from the intermediate in floating point: they match resampling in double, up to
+        // values close to a half, which the fixed point weights of the horizontal pass may round either way
+        Image<double> imgd{ 37, 53, ColorSpace::RGB, 3 };
+        for (size_t t = 0; t < 3; t++)
+            std::copy(img(t).cbegin(), img(t).cend(), imgd(t).begin());
+
+        auto resized = algorithm::Resize(img, 23, 71, filter);
+        auto expected = algorithm::Resize(imgd, 23, 71, filter);
+        for (size_t t = 0; t < 3; t++)
+        {
+            for (size_t i = 0; i < resized.size(); i++)
+            {
+                double val = std::clamp(std::floor(expected(t)(i) + 0.5), 0.0, 255.0);
+                bool nearHalf = std::abs(expected(t)(i) - std::floor(expected(t)(i)) - 0.5) < 0.05;
+                EXPECT_NEAR(resized(t)(i), val, nearHalf ? 1 : 0);
+            }
+        }
+    }
+
+    // Bilinear upscaling of a horizontal ramp is monotonic
+    Image<float> ramp{ 2, 8, ColorSpace::GrayScale, 1 };
+    for (size_t j = 0; j < 8; j++)
+        ramp(0)(0, j) = ramp(0)(1, j) = static_cast<float>(j);
+
+    auto upscaled = algorithm::Resize(ramp, 4, 16, algorithm::ResizeFilter::Bilinear);
+    for (size_t j = 1; j < 16; j++)
+        EXPECT_LE(upscaled(0)(2, j - 1), upscaled(0)(2, j));
+    EXPECT_FLOAT_EQ(upscaled(0)(0, 3), 1.25f);
+}
+
+TEST(AlgorithmTests, transpose_rotate_flip)
+{
+    // Sizes that are not multiples of the tile or the 8 x 8 blocks
+    Image<std::uint8_t> img8{ 45, 70, ColorSpace::RGB, 3 };
+    Image<std::uint16_t> img16{ 45, 70, ColorSpace::RGB, 3 };
+    Image<double> imgd{ 45, 70, ColorSpace::RGB, 3 };
+    FillPattern(img8, 1);
+    FillPattern(img16, 2);
+    for (size_t t = 0; t < 3; t++)
+        std::iota(imgd(t).begin(), imgd(t).end(), t * 0.5);
+
+    auto check = [](const auto& img)
+        {
+            const size_t h = img.height(), w = img.width();
+
+            auto transposed = algorithm::Transpose(img);
+            auto rotated90 = algorithm::Rotate(img, algorithm::Rotation::Rotate90);
+            auto rotated180 = algorithm::Rotate(img, algorithm::Rotation::Rotate180);
+            auto rotated270 = algorithm::Rotate(img, algorithm::Rotation::Rotate270);
+            auto flippedH = algorithm::Flip(img, Orientation2D::Horizontal);
+            auto flippedV = algorithm::Flip(img, Orientation2D::Vertical);
+            auto transverse = algorithm::ApplyExifOrientation(img, 7);
+
+            ASSERT_EQ(transposed.height(), w);
+            ASSERT_EQ(transposed.width(), h);
+            ASSERT_EQ(rotated90.height(), w);
+            ASSERT_EQ(rotated180.height(), h);
+
+            for (size_t t = 0; t < img.num_channels(); t++)
+            {
+                for (size_t i = 0; i < h; i++)
+                {
+                    for (size_t j = 0; j < w; j++)
+                    {
+                        auto val = img(t)(i, j);
+                        EXPECT_EQ(transposed(t)(j, i), val);
+                        EXPECT_EQ(rotated90(t)(j, h - 1 - i), val);
+                        EXPECT_EQ(rotated180(t)(h - 1 - i, w - 1 - j), val);
+                        EXPECT_EQ(rotated270(t)(w - 1 - j, i), val);
+                        EXPECT_EQ(flippedH(t)(i, w - 1 - j), val);
+                        EXPECT_EQ(flippedV(t)(h - 1 - i, j), val);
+                        EXPECT_EQ(transverse(t)(w - 1 - j, h - 1 - i), val);
+                    }
+                }
+            }
+        };
+
+    check(img8);
+    check(img16);
+    check(imgd);
+
+    // EXIF orientations are the same as the explicit operations
+    auto exif6 = algorithm::ApplyExifOrientation(img8, 6);
+    auto exif8 = algorithm::ApplyExifOrientation(img8, 8);
+    auto rotated90 = algorithm::Rotate(img8, algorithm::Rotation::Rotate90);
+    auto rotated270 = algorithm::Rotate(img8, algorithm::Rotation::Rotate270);
+    EXPECT_TRUE(std::equal(exif6(1).cbegin(), exif6(1).cend(), rotated90(1).cbegin()));
+    EXPECT_TRUE(std::equal(exif8(2).cbegin(), exif8(2).cend(), rotated270(2).cbegin()));
+    EXPECT_THROW(algorithm::ApplyExifOrientation(img8, 9), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, transpose_rotate_flip_in_place)
+{
+    Image<std::uint8_t> square{ 67, 67, ColorSpace::GrayScale, 1 };
+    FillPattern(square, 5);
+
+    for (auto rotation : { algorithm::Rotation::Rotate90, algorithm::Rotation::Rotate180, algorithm::Rotation::Rotate270 })
+    {
+        auto expected = algorithm::Rotate(square, rotation);
+        auto rotated = square;
+        algorithm::RotateInPlace(rotated, rotation);
+        EXPECT_TRUE(std::equal(rotated(0).cbegin(), rotated(0).cend(), expected(0).cbegin()));
+    }
+
+    Channel<std::uint16_t> ch{ 40, 40 };
+    std::iota(ch.begin(), ch.end(), std::uint16_t{ 0 });
+    auto expected = algorithm::Transpose(ch);
+    algorithm::TransposeInPlace(ch);
+    EXPECT_TRUE(std::equal(ch.cbegin(), ch.cend(), expected.cbegin()));
+
+    for (auto direction : { Orientation2D::Horizontal, Orientation2D::Vertical })
+    {
+        Channel<float> rect{ 5, 9 };
+        std::iota(rect.begin(), rect.end(), 0.0f);
+        auto flipped = algorithm::Flip(rect, direction);
+        algorithm::FlipInPlace(rect, direction);
+        EXPECT_TRUE(std::equal(rect.cbegin(), rect.cend(), flipped.cbegin()));
+    }
+
+    Channel<std::uint8_t> rect{ 3, 4 };
+    EXPECT_THROW(algorithm::TransposeInPlace(rect), std::invalid_argument);
+    EXPECT_THROW(algorithm::RotateInPlace(rect, algorithm::Rotation::Rotate90), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, warp)
+{
+    Image<std::uint8_t> img{ 41, 57, ColorSpace::RGB, 3 };
+    FillPattern(img, 6);
+
+    for (auto interpolation : { algorithm::Interpolation::Nearest, algorithm::Interpolation::Bilinear })
+    {
+        algorithm::WarpSettings settings{ interpolation, 3 };
+
+        // Identity, also when given as a scaled perspective matrix
+        for (const auto& transform : { algorithm::AffineTransform(1, 0, 0, 0, 1, 0), algorithm::Transform2D{ 2, 0, 0, 0, 2, 0, 0, 0, 2 } })
+        {
+            auto same = algorithm::Warp(img, transform, img.height(), img.width(), settings);
+            for (size_t t = 0; t < 3; t++)
+                EXPECT_TRUE(std::equal(same(t).cbegin(), same(t).cend(), img(t).cbegin()));
+        }
+
+        // Integer translation, uncovered pixels get the border value
+        auto shifted = algorithm::Warp(img, algorithm::AffineTransform(1, 0, 2, 0, 1, 3), img.height(), img.width(), settings, std::uint8_t{ 7 });
+        EXPECT_EQ(shifted(1)(10, 20), img(1)(7, 18));
+        EXPECT_EQ(shifted(2)(2, 20), 7);
+        EXPECT_EQ(shifted(0)(20, 1), 7);
+
+        // A quarter turn: x' = height - 1 - y, y' = x
+        auto turned = algorithm::Warp(img, algorithm::AffineTransform(0, -1, img.height() - 1.0, 1, 0, 0), img.width(), img.height(), settings);
+        auto rotated = algorithm::Rotate(img, algorithm::Rotation::Rotate90);
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_TRUE(std::equal(turned(t).cbegin(), turned(t).cend(), rotated(t).cbegin()));
+
+        // Cached maps give the same result as the direct warp
+        algorithm::Transform2D perspective{ 0.9, 0.1, 3.0, -0.05, 1.1, 2.0, 0.001, -0.0005, 1.0 };
+        algorithm::WarpMap map{ perspective, img.height(), img.width(), 50, 60, interpolation };
+        auto direct = algorithm::Warp(img, perspective, 50, 60, settings);
+        auto cached = algorithm::Warp(img, map);
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_TRUE(std::equal(direct(t).cbegin(), direct(t).cend(), cached(t).cbegin()));
+    }
+
+    // Bilinear sampling half way between two columns
+    Image<std::uint16_t> ramp{ 4, 8, ColorSpace::GrayScale, 1 };
+    for (size_t i = 0; i < ramp.size(); i++)
+        ramp(0)(i) = static_cast<std::uint16_t>((i % 8) * 1000);
+
+    auto half = algorithm::Warp(ramp, algorithm::AffineTransform(1, 0, -0.5, 0, 1, 0), 4, 8);
+    EXPECT_EQ(half(0)(1, 3), 3500);
+    EXPECT_EQ(half(0)(1, 7), 0);
+
+    EXPECT_THROW(algorithm::Warp(ramp, algorithm::AffineTransform(1, 2, 0, 2, 4, 0), 4, 8), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, remap)
+{
+    // Larger than a tile in both directions
+    Image<std::uint8_t> img{ 150, 130, ColorSpace::RGB, 3 };
+    FillPattern(img, 8);
+
+    for (auto interpolation : { algorithm::Interpolation::Nearest, algorithm::Interpolation::Bilinear })
+    {
+        // A half scale zoom centered on the image, the same as the equivalent warp
+        auto zoom = [](size_t row, size_t col) { return Point<double, 2u>{ row * 0.5 + 30.0, col * 0.5 + 25.25 }; };
+        algorithm::RemapMap rowMap{ img.height(), img.width(), 140, 135, zoom, interpolation, false, 2 };
+        algorithm::RemapMap tileMap{ img.height(), img.width(), 140, 135, zoom, interpolation, true, 2 };
+
+        auto remapped = algorithm::Remap(img, rowMap, std::uint8_t{ 3 });
+        auto tiled = algorithm::Remap(img, tileMap, std::uint8_t{ 3 }, 3);
+        auto warped = algorithm::Warp(img, algorithm::AffineTransform(2, 0, -50.5, 0, 2, -60), 140, 135, algorithm::WarpSettings{ interpolation, 1 }, std::uint8_t{ 3 });
+
+        for (size_t t = 0; t < 3; t++)
+        {
+            EXPECT_TRUE(std::equal(remapped(t).cbegin(), remapped(t).cend(), tiled(t).cbegin()));
+            EXPECT_TRUE(std::equal(remapped(t).cbegin(), remapped(t).cend(), warped(t).cbegin()));
+        }
+    }
+
+    // Without distortion coefficients the undistortion is the identity, the principal point never moves
+    algorithm::LensDistortion lens{ 400.0, 400.0, 64.0, 75.0 };
+    auto identity = algorithm::Remap(img, algorithm::UndistortionMap(lens, img.height(), img.width()));
+    for (size_t t = 0; t < 3; t++)
+        EXPECT_TRUE(std::equal(identity(t).cbegin(), identity(t).cend(), img(t).cbegin()));
+
+    lens.k1 = -0.2;
+    lens.p1 = 0.01;
+    auto undistorted = algorithm::Remap(img, algorithm::UndistortionMap(lens, img.height(), img.width(), algorithm::Interpolation::Nearest));
+    EXPECT_EQ(undistorted(1)(75, 64), img(1)(75, 64));
+
+    EXPECT_THROW(algorithm::Remap(Image<std::uint8_t>{ 10, 10, ColorSpace::GrayScale, 1 }, algorithm::UndistortionMap(lens, 20, 20)), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, premultiply_alpha)
+{
+    // Every color and alpha combination of 8-bit values
+    Image<std::uint8_t> img{ 256, 256, ColorSpace::GrayScaleAlpha, 2 };
+    for (size_t a = 0; a < 256; a++)
+        for (size_t c = 0; c < 256; c++)
+            img.set_pixel(a, c, static_cast<std::uint8_t>(c), static_cast<std::uint8_t>(a));
+
+    auto premultiplied = img;
+    algorithm::PremultiplyAlpha(premultiplied, 2);
+    for (size_t a = 0; a < 256; a++)
+    {
+        for (size_t c = 0; c < 256; c++)
+        {
+            EXPECT_EQ(premultiplied(0)(a, c), (c * a + 127) / 255);
+            EXPECT_EQ(premultiplied(1)(a, c), a);
+        }
+    }
+
+    // Division by alpha is exact as well, values above alpha saturate
+    algorithm::UnpremultiplyAlpha(img);
+    for (size_t a = 0; a < 256; a++)
+        for (size_t c = 0; c < 256; c++)
+            EXPECT_EQ(img(0)(a, c), a == 0 ? 0 : std::min<size_t>((c * 255 + a / 2) / a, 255));
+
+    Image<std::uint16_t> img16{ 2, 2, ColorSpace::RGBA, 4 };
+    img16.set_pixel(0, std::uint16_t{ 65535 }, std::uint16_t{ 1000 }, std::uint16_t{ 0 }, std::uint16_t{ 32768 });
+    algorithm::PremultiplyAlpha(img16);
+    EXPECT_EQ(img16(0)(0), 32768);
+    EXPECT_EQ(img16(1)(0), 500);
+    algorithm::UnpremultiplyAlpha(img16);
+    EXPECT_EQ(img16(0)(0), 65535);
+    EXPECT_EQ(img16(1)(0), 1000);
+
+    Image<std::uint8_t> rgb{ 2, 2, ColorSpace::RGB, 3 };
+    EXPECT_THROW(algorithm::PremultiplyAlpha(rgb), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, composite_over_and_blend)
+{
+    Image<std::uint8_t> src{ 3, 3, ColorSpace::RGBA, 4 };
+    for (size_t i = 0; i < src.size(); i++)
+        src.set_pixel(i, std::uint8_t{ 200 }, std::uint8_t{ 100 }, std::uint8_t{ 0 }, static_cast<std::uint8_t>(i * 30));
+
+    // Opaque destination, src partly outside on the top left
+    Image<std::uint8_t> dst{ 4, 5, ColorSpace::RGB, 3 };
+    for (size_t t = 0; t < 3; t++)
+        dst(t) = 50;
+
+    auto opaque = dst;
+    algorithm::CompositeOver(opaque, src, -1, -2);
+    for (size_t row = 0; row < dst.height(); row++)
+    {
+        for (size_t col = 0; col < dst.width(); col++)
+        {
+            std::uint8_t expected[3]{ 50, 50, 50 };
+            if (row < 2 && col < 1)
+            {
+                size_t a = src(3)(row + 1, col + 2);
+                for (size_t t = 0; t < 3; t++)
+                    expected[t] = static_cast<std::uint8_t>((src(t)(row + 1, col + 2) * a + 50 * (255 - a) + 127) / 255);
+            }
+
+            for (size_t t = 0; t < 3; t++)
+                EXPECT_EQ(opaque(t)(row, col), expected[t]);
+        }
+    }
+
+    // Transparent destination: the straight result is the source color, premultiplied the sum
+    Image<std::uint8_t> rgba{ 3, 3, ColorSpace::RGBA, 4 };
+    rgba(0) = 50;
+    rgba(1) = 50;
+    rgba(2) = 50;
+    rgba(3) = 0;
+    algorithm::CompositeOver(rgba, src, 0, 0);
+    for (size_t i = 1; i < rgba.size(); i++)
+        for (size_t t = 0; t < 4; t++)
+            EXPECT_EQ(rgba(t)(i), src(t)(i));
+
+    // Straight and premultiplied composition agree within rounding
+    Image<std::uint8_t> straight{ 3, 3, ColorSpace::RGBA, 4 };
+    for (size_t i = 0; i < straight.size(); i++)
+        straight.set_pixel(i, std::uint8_t{ 10 }, std::uint8_t{ 240 }, std::uint8_t{ 128 }, static_cast<std::uint8_t>(255 - i * 20));
+
+    auto premultiplied = straight;
+    auto premultipliedSrc = src;
+    algorithm::PremultiplyAlpha(premultiplied);
+    algorithm::PremultiplyAlpha(premultipliedSrc);
+    algorithm::CompositeOver(straight, src, 0, 0);
+    algorithm::CompositeOver(premultiplied, premultipliedSrc, 0, 0, algorithm::AlphaMode::Premultiplied);
+    algorithm::UnpremultiplyAlpha(premultiplied);
+    for (size_t i = 0; i < straight.size(); i++)
+    {
+        EXPECT_EQ(straight(3)(i), premultiplied(3)(i));
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_LE(std::abs(straight(t)(i) - premultiplied(t)(i)), 2);
+    }
+
+    EXPECT_THROW(algorithm::CompositeOver(dst, dst, 0, 0), std::invalid_argument);
+    Image<std::uint8_t> gray{ 2, 2, ColorSpace::GrayScale, 1 };
+    EXPECT_THROW(algorithm::CompositeOver(gray, src, 0, 0), std::invalid_argument);
+
+    auto blended = algorithm::Blend(dst, opaque, std::uint8_t{ 64 });
+    for (size_t t = 0; t < 3; t++)
+        for (size_t i = 0; i < dst.size(); i++)
+            EXPECT_EQ(blended(t)(i), (dst(t)(i) * 191 + opaque(t)(i) * 64 + 127) / 255);
+
+    EXPECT_THROW(algorithm::Blend(dst, gray, std::uint8_t{ 0 }), std::invalid_argument);
+}
+
+TEST(AlgorithmTests, half)
+{
+    EXPECT_EQ(half{ 1.0f }.bits, 0x3C00);
+    EXPECT_EQ(half{ -2.0f }.bits, 0xC000);
+    EXPECT_EQ(half{ 65504.0f }.bits, 0x7BFF);
+    EXPECT_EQ(half{ 65520.0f }.bits, 0x7C00);
+    EXPECT_EQ(half{ std::ldexp(1.0f, -24) }.bits, 0x0001);
+    EXPECT_EQ(half{ std::ldexp(1.0f, -26) }.bits, 0x0000);
+    EXPECT_EQ(half{ 1.0f + std::ldexp(1.0f, -11) }.bits, 0x3C00);
+    EXPECT_EQ(half{ 1.0f + 3.0f * std::ldexp(1.0f, -11) }.bits, 0x3C02);
+    EXPECT_TRUE(std::isnan(static_cast<float>(half{ std::numeric_limits<float>::quiet_NaN() })));
+    EXPECT_TRUE(std::isinf(static_cast<float>(half::from_bits(0xFC00))));
+
+    // Every finite half survives the round trip through float
+    for (std::uint32_t bits = 0; bits < 0x10000; bits++)
+    {
+        if ((bits & 0x7C00) == 0x7C00)
+            continue;
+
+        auto h = half::from_bits(static_cast<std::uint16_t>(bits));
+        EXPECT_EQ(half{ static_cast<float>(h) }.bits, bits);
+    }
+}
+
+TEST(AlgorithmTests, convert_bit_depth)
+{
+    Image<std::uint16_t> img16{ 256, 256, ColorSpace::GrayScale, 1 };
+    std::iota(img16(0).begin(), img16(0).end(), std::uint16_t{ 0 });
+
+    auto img8 = algorithm::convert<std::uint8_t>(img16);
+    for (size_t i = 0; i < img16.size(); i++)
+        EXPECT_EQ(img8(0)(i), (2 * i + 257) / 514);
+
+    auto back16 = algorithm::convert<std::uint16_t>(img8);
+    auto back8 = algorithm::convert<std::uint8_t>(back16);
+    for (size_t i = 0; i < img16.size(); i++)
+    {
+        EXPECT_EQ(back16(0)(i), img8(0)(i) * 257);
+        EXPECT_EQ(back8(0)(i), img8(0)(i));
+    }
+
+    auto fromFloat = algorithm::convert<std::uint8_t>(algorithm::convert<float>(img8));
+    auto fromHalf = algorithm::convert<std::uint8_t>(algorithm::convert<half>(img8));
+    EXPECT_TRUE(std::equal(fromFloat(0).cbegin(), fromFloat(0).cend(), img8(0).cbegin()));
+    EXPECT_TRUE(std::equal(fromHalf(0).cbegin(), fromHalf(0).cend(), img8(0).cbegin()));
+
+    auto half16 = algorithm::convert<std::uint16_t>(algorithm::convert<half>(img16));
+    for (size_t i = 0; i < img16.size(); i++)
+        EXPECT_LE(std::abs(half16(0)(i) - img16(0)(i)), 16);
+
+    Image<float> outOfRange{ 1, 3, ColorSpace::GrayScale, 1 };
+    outOfRange(0)(0) = -0.5f;
+    outOfRange(0)(1) = 2.0f;
+    outOfRange(0)(2) = std::numeric_limits<float>::quiet_NaN();
+    auto clamped = algorithm::convert<std::uint8_t>(outOfRange);
+    EXPECT_EQ(clamped(0)(0), 0);
+    EXPECT_EQ(clamped(0)(1), 255);
+    EXPECT_EQ(clamped(0)(2), 0);
+}
+
+TEST(AlgorithmTests, convert_dithering)
+{
+    // A level between two 8-bit values is reproduced on average
+    Image<std::uint16_t> flat{ 64, 96, ColorSpace::RGB, 3 };
+    for (size_t t = 0; t < 3; t++)
+        flat(t) = static_cast<std::uint16_t>(100.25 * 257);
+
+    for (auto dithering : { algorithm::Dithering::Ordered, algorithm::Dithering::FloydSteinberg })
+    {
+        auto dithered = algorithm::convert<std::uint8_t>(flat, dithering, 3);
+        EXPECT_EQ(dithered.color_space(), ColorSpace::RGB);
+        for (size_t t = 0; t < 3; t++)
+        {
+            double sum = 0.0;
+            for (size_t i = 0; i < dithered.size(); i++)
+            {
+                EXPECT_TRUE(dithered(t)(i) == 100 || dithered(t)(i) == 101);
+                sum += dithered(t)(i);
+            }
+            EXPECT_NEAR(sum / dithered.size(), 100.25, 0.01);
+        }
+    }
+
+    // Error diffusion gives the same result with any number of threads
+    Image<float> gradient{ 37, 300, ColorSpace::GrayScale, 1 };
+    for (size_t row = 0; row < gradient.height(); row++)
+        for (size_t col = 0; col < gradient.width(); col++)
+            gradient(0)(row, col) = static_cast<float>(col) / 300.0f + static_cast<float>(row) / 5000.0f;
+
+    auto single = algorithm::convert<std::uint8_t>(gradient, algorithm::Dithering::FloydSteinberg, 1);
+    auto multi = algorithm::convert<std::uint8_t>(gradient, algorithm::Dithering::FloydSteinberg, 8);
+    EXPECT_TRUE(std::equal(single(0).cbegin(), single(0).cend(), multi(0).cbegin()));
+    for (size_t i = 0; i < gradient.size(); i++)
+        EXPECT_LE(std::abs(single(0)(i) - gradient(0)(i) * 255.0f), 1.0f);
+
+    // Dithering does not apply when no levels are lost
+    Image<std::uint8_t> img8{ 8, 8, ColorSpace::GrayScale, 1, 77 };
+    auto img16 = algorithm::convert<std::uint16_t>(img8, algorithm::Dithering::FloydSteinberg);
+    EXPECT_TRUE(helpers::AllPixelsEqualTo<std::uint16_t>(img16(0).data(), img16.size(), 77 * 257));
+}
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "test_helpers.h"
 
+#include <filesystem>
 #include <numeric>
 
 #include <imglib/adaptors/jpeg_adaptor.hpp>
@@ -8,7 +9,10 @@
 #include <imglib/algorithms/image_generation.hpp>
 #include <imglib/algorithms/geometric_modifications.hpp>
 #include <imglib/algorithms/homogeneous_point_operations.hpp>
+#include <imglib/color/color_conversion.hpp>
 #include <imglib/image/image.hpp>
+#include <imglib/image/cimage.hpp>
+#include <imglib/image/pimage.hpp>
 
 using namespace imglib;
 
@@ -42,6 +46,32 @@ png::PngImg read_png(std::wstring_view name)
     return png::Read(inputImgPath);
 }
 
+std::vector<std::byte> read_bytes(std::wstring_view path)
+{
+    FILE* pFile = OpenFile(path, Mode::Read);
+    fseek(pFile, 0, SEEK_END);
+    std::vector<std::byte> bytes(static_cast<size_t>(ftell(pFile)));
+    fseek(pFile, 0, SEEK_SET);
+    size_t numRead = fread(bytes.data(), 1, bytes.size(), pFile);
+    fclose(pFile);
+    bytes.resize(numRead);
+    return bytes;
+}
+
+template <typename T>
+bool same_pixels(const Image<T>& img1, const Image<T>& img2)
+{
+    if (img1.height() != img2.height() || img1.width() != img2.width() || img1.num_channels() != img2.num_channels() ||
+        img1.color_space() != img2.color_space())
+        return false;
+
+    for (size_t t = 0; t < img1.num_channels(); t++)
+        if (!std::equal(img1(t).cbegin(), img1(t).cend(), img2(t).cbegin()))
+            return false;
+
+    return true;
+}
+
 TEST(AlgorithmTestsIO, image_block_grayscale)
 {
     size_t width{ 600 }, height{ 600 };
@@ -202,4 +232,574 @@ TEST(AlgorithmTestsIO, image_invert_rgb)
     algorithm::invert(img);
     write_jpeg(img, L"petit_prince_rgb_inverted.jpg");
     write_png(img, L"petit_prince_rgb_inverted.png");
-}
\ No newline at end of file
+}
+
+TEST(AlgorithmTestsIO, jpeg_cmyk_to_rgb)
+{
+    // libjpeg marks CMYK files with the Adobe marker, so the data is written in the inverted convention.
+    Color<jpeg::data_type, 3> start{ ColorSpace::RGB, 200, 30, 90 };
+    Color<jpeg::data_type, 3> end{ ColorSpace::RGB, 20, 180, 240 };
+    auto rgb = algorithm::horizontal_linear_gradient(64, 2, 32, start, end);
+    auto cmyk = rgb_to_cmyk(rgb, true);
+
+    std::wstring path{ helpers::output_img_path };
+    path += L"cmyk_gradient.jpg";
+    jpeg::Write(path, 100, cmyk);
+
+    auto asStored = jpeg::Read(path);
+    EXPECT_EQ(asStored.color_space(), ColorSpace::CMYK);
+
+    auto converted = jpeg::Read(path, jpeg::ReadSettings{ true });
+    ASSERT_EQ(converted.color_space(), ColorSpace::RGB);
+    ASSERT_EQ(converted.num_channels(), 3);
+
+    auto expected = cmyk_to_rgb(asStored, true);
+    for (size_t t = 0; t < 3; t++)
+    {
+        EXPECT_TRUE(std::equal(converted(t).cbegin(), converted(t).cend(), expected(t).cbegin()));
+        for (size_t i = 0; i < rgb.size(); i++)
+            EXPECT_LE(std::abs(converted(t)(i) - rgb(t)(i)), 8);
+    }
+}
+
+TEST(AlgorithmTestsIO, png_read_containers)
+{
+    // Interlaced (basi) and non-interlaced (basn) PngSuite images have the same pixels
+    for (std::wstring name : { L"0g01", L"0g16", L"2c08", L"2c16", L"3p04", L"4a08", L"4a16", L"6a08", L"6a16" })
+    {
+        auto interlaced = read_png(L"png/basi" + name + L".png");
+        auto progressive = read_png(L"png/basn" + name + L".png");
+        ASSERT_EQ(interlaced.index(), progressive.index());
+        if (auto img8 = std::get_if<png::ImgBitDepth8>(&interlaced))
+            EXPECT_TRUE(same_pixels(*img8, std::get<png::ImgBitDepth8>(progressive)));
+        else
+            EXPECT_TRUE(same_pixels(std::get<png::ImgBitDepth16>(interlaced), std::get<png::ImgBitDepth16>(progressive)));
+    }
+
+    std::wstring path{ helpers::input_img_path };
+    path += L"png/basn6a16.png";
+    auto planar = std::get<png::ImgBitDepth16>(png::Read(path));
+    EXPECT_EQ(planar.color_space(), ColorSpace::RGBA);
+    EXPECT_EQ(planar(0)(0), 0xFFFF);
+
+    CImage<std::uint16_t, 4> cimg;
+    PImage<std::uint16_t, 4> pimg;
+    png::Read(path, cimg);
+    png::Read(path, pimg);
+    ASSERT_EQ(cimg.size(), planar.size());
+    ASSERT_EQ(pimg.size(), planar.size());
+    EXPECT_EQ(cimg.color_space(), ColorSpace::RGBA);
+    for (size_t i = 0; i < planar.size(); i++)
+    {
+        for (size_t t = 0; t < 4; t++)
+        {
+            EXPECT_EQ(cimg(i, t), planar(t)(i));
+            EXPECT_EQ(pimg(i).p[t], planar(t)(i));
+        }
+    }
+
+    // Palette images are expanded to RGB
+    path = helpers::input_img_path;
+    path += L"png/basi3p08.png";
+    auto rgb = std::get<png::ImgBitDepth8>(png::Read(path));
+    CImage<std::uint8_t, 3> crgb;
+    png::Read(path, crgb);
+    for (size_t i = 0; i < rgb.size(); i++)
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_EQ(crgb(i, t), rgb(t)(i));
+
+    CImage<std::uint8_t, 4> wrongChannels;
+    PImage<std::uint16_t, 3> wrongDepth;
+    EXPECT_THROW(png::Read(path, wrongChannels), std::runtime_error);
+    EXPECT_THROW(png::Read(path, wrongDepth), std::runtime_error);
+}
+
+TEST(AlgorithmTestsIO, png_row_reader_writer)
+{
+    CImage<std::uint16_t, 4> cimg{ 45, 31, ColorSpace::RGBA };
+    for (size_t i = 0; i < cimg.size(); i++)
+        cimg.set_pixel(i, static_cast<std::uint16_t>(i * 1000), static_cast<std::uint16_t>(65535 - i), static_cast<std::uint16_t>(i * 7), std::uint16_t{ 40000 });
+
+    std::wstring path{ helpers::output_img_path };
+    path += L"row_writer_rgba16.png";
+
+    // Batches of 7 rows, the last one shorter
+    png::RowWriter writer{ path, ImageLayout{ cimg.height(), cimg.width(), ColorSpace::RGBA, 4, 16 } };
+    auto data = reinterpret_cast<std::uint8_t const*>(cimg.data());
+    while (writer.rows_written() < cimg.height())
+    {
+        size_t numRows = std::min<size_t>(7, cimg.height() - writer.rows_written());
+        writer.write_rows(data + writer.rows_written() * writer.row_bytes(), numRows);
+    }
+    EXPECT_THROW(writer.write_rows(data, 1), std::logic_error);
+    writer.finish();
+    EXPECT_NO_THROW(writer.finish());
+
+    auto planar = std::get<png::ImgBitDepth16>(png::Read(path));
+    for (size_t i = 0; i < cimg.size(); i++)
+        for (size_t t = 0; t < 4; t++)
+            EXPECT_EQ(planar(t)(i), cimg(i, t));
+
+    // Round trip through the planar writer
+    std::wstring path2{ helpers::output_img_path };
+    path2 += L"planar_rgba16.png";
+    png::Write(planar, path2);
+    EXPECT_TRUE(same_pixels(planar, std::get<png::ImgBitDepth16>(png::Read(path2))));
+
+    png::RowReader reader{ path };
+    EXPECT_EQ(reader.layout().height, cimg.height());
+    EXPECT_EQ(reader.layout().bit_depth, 16);
+    ASSERT_EQ(reader.row_bytes(), cimg.width() * 4 * sizeof(std::uint16_t));
+
+    std::vector<std::uint16_t> rows(5 * cimg.width() * 4);
+    size_t row = 0;
+    while (size_t numRows = reader.read_rows(reinterpret_cast<std::uint8_t*>(rows.data()), 5))
+    {
+        for (size_t i = 0; i < numRows * cimg.width(); i++)
+            for (size_t t = 0; t < 4; t++)
+                EXPECT_EQ(rows[i * 4 + t], cimg(row * cimg.width() + i, t));
+        row += numRows;
+    }
+    EXPECT_EQ(row, cimg.height());
+
+    // Interlaced files are handed out the same way
+    std::wstring interlaced{ helpers::input_img_path };
+    interlaced += L"png/basi2c08.png";
+    auto expected = std::get<png::ImgBitDepth8>(png::Read(interlaced));
+    png::RowReader interlacedReader{ interlaced };
+    std::vector<std::uint8_t> rgbRows(3 * interlacedReader.row_bytes());
+    for (size_t first = 0; first < expected.height(); first += 3)
+    {
+        size_t numRows = interlacedReader.read_rows(rgbRows.data(), 3);
+        for (size_t i = 0; i < numRows * expected.width(); i++)
+            for (size_t t = 0; t < 3; t++)
+                EXPECT_EQ(rgbRows[i * 3 + t], expected(t)(first * expected.width() + i));
+    }
+    EXPECT_EQ(interlacedReader.read_rows(rgbRows.data(), 3), 0);
+}
+
+TEST(AlgorithmTestsIO, png_write_options)
+{
+    auto img = read_jpeg(L"petit_prince.jpg");
+    std::wstring path{ helpers::output_img_path };
+    path += L"petit_prince_options.png";
+
+    png::PngWriteOptions store{ 0, png::CompressionStrategy::Default, 8, 15, png::RowFilter::None, 8192 };
+    png::Write(img, path, store);
+    auto storedSize = std::filesystem::file_size(path);
+    EXPECT_GT(storedSize, img.data_size());
+    EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(path))));
+
+    png::PngWriteOptions fast{ 1, png::CompressionStrategy::Rle, 9, 15, png::RowFilter::Up, 1 << 16 };
+    png::Write(img, path, fast);
+    EXPECT_LT(std::filesystem::file_size(path), storedSize);
+    EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(path))));
+
+    png::PngWriteOptions small{ 9, png::CompressionStrategy::Filtered, 9, 8, png::RowFilter::Adaptive, 512 };
+    png::Write(img, path, small);
+    EXPECT_LT(std::filesystem::file_size(path), storedSize);
+    EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(path))));
+
+    png::PngWriteOptions invalid{};
+    invalid.compression_level = 10;
+    EXPECT_THROW(png::Write(img, path, invalid), std::invalid_argument);
+    invalid = png::PngWriteOptions{};
+    invalid.window_bits = 16;
+    EXPECT_THROW(png::Write(img, path, invalid), std::invalid_argument);
+}
+
+TEST(AlgorithmTestsIO, png_parallel_write)
+{
+    auto img = read_jpeg(L"petit_prince.jpg");
+    std::wstring path{ helpers::output_img_path };
+    path += L"petit_prince_parallel.png";
+
+    png::PngWriteOptions options{};
+    png::Write(img, path, options);
+    auto singleSize = std::filesystem::file_size(path);
+
+    // The image spans several bands, every filter has to give back the same pixels.
+    options.num_threads = 4;
+    for (auto filter : { png::RowFilter::None, png::RowFilter::Sub, png::RowFilter::Up, png::RowFilter::Average, png::RowFilter::Paeth, png::RowFilter::Adaptive })
+    {
+        options.filter = filter;
+        png::Write(img, path, options);
+        EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(path))));
+    }
+
+    // The preset dictionaries keep the files close to the single threaded size.
+    EXPECT_LT(std::filesystem::file_size(path), singleSize + singleSize / 50);
+
+    png::PngWriteOptions small{ 9, png::CompressionStrategy::Default, 9, 8, png::RowFilter::Paeth, 512, 0 };
+    png::Write(img, path, small);
+    EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(path))));
+
+    png::PngWriteOptions store{ 0, png::CompressionStrategy::Default, 8, 15, png::RowFilter::None, 1 << 20, 3 };
+    png::Write(img, path, store);
+    EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(path))));
+
+    png::ImgBitDepth16 img16{ 300, 500, ColorSpace::RGBA, 4 };
+    for (size_t t = 0; t < img16.num_channels(); t++)
+        for (size_t i = 0; i < img16.size(); i++)
+            img16(t)(i) = static_cast<std::uint16_t>((i * (t + 1) * 40503u) >> (t * 3));
+
+    png::PngWriteOptions fast{ 1, png::CompressionStrategy::Rle, 8, 15, png::RowFilter::Adaptive, 8192, 8 };
+    png::Write(img16, path, fast);
+    EXPECT_TRUE(same_pixels(img16, std::get<png::ImgBitDepth16>(png::Read(path))));
+}
+
+TEST(AlgorithmTestsIO, png_in_memory)
+{
+    auto img = read_jpeg(L"petit_prince.jpg");
+    std::wstring path{ helpers::output_img_path };
+    path += L"petit_prince_memory.png";
+
+    // The encoded data is the content of the file, for both encoders.
+    for (size_t numThreads : { 1, 4 })
+    {
+        png::PngWriteOptions options{};
+        options.num_threads = numThreads;
+        png::Write(img, path, options);
+        auto encoded = png::Write(img, options);
+        EXPECT_EQ(encoded, read_bytes(path));
+        EXPECT_TRUE(same_pixels(img, std::get<png::ImgBitDepth8>(png::Read(encoded))));
+    }
+
+    std::wstring inputPath{ helpers::input_img_path };
+    inputPath += L"png/basi6a16.png";
+    auto interlaced = read_bytes(inputPath);
+
+    CImage<std::uint16_t, 4> cimg;
+    png::Read(interlaced, cimg);
+    PImage<std::uint16_t, 4> pimg;
+    png::Read(inputPath, pimg);
+    ASSERT_EQ(cimg.size(), pimg.size());
+    for (size_t i = 0; i < cimg.size(); i++)
+        for (size_t k = 0; k < 4; k++)
+            EXPECT_EQ(cimg(i, k), pimg(i).p[k]);
+
+    EXPECT_THROW(png::Read(std::span<const std::byte>{ interlaced.data(), 7 }), std::runtime_error);
+    EXPECT_THROW(png::Read(std::span<const std::byte>{ interlaced.data(), interlaced.size() / 2 }), std::runtime_error);
+}
+
+TEST(AlgorithmTestsIO, jpeg_in_memory)
+{
+    auto img = read_jpeg(L"petit_prince.jpg");
+    std::wstring path{ helpers::output_img_path };
+    path += L"petit_prince_memory.jpg";
+
+    jpeg::Write(path, 80, img);
+    auto encoded = jpeg::Write(80, img);
+    EXPECT_EQ(encoded, read_bytes(path));
+
+    auto decoded = jpeg::Read(encoded);
+    EXPECT_TRUE(same_pixels(jpeg::Read(path), decoded));
+
+    // Files of a few bytes make the output buffer grow.
+    jpeg::JpegImg tiny{ 2, 3, ColorSpace::GrayScale, 1 };
+    EXPECT_TRUE(same_pixels(tiny, jpeg::Read(jpeg::Write(100, tiny))));
+
+    std::vector<std::byte> garbage(encoded.begin(), encoded.begin() + 2);
+    garbage.resize(100, std::byte{ 0x55 });
+    EXPECT_THROW(jpeg::Read(garbage), std::runtime_error);
+}
+
+TEST(AlgorithmTestsIO, probe)
+{
+    static_assert(std::is_same_v<decltype(png::Probe(std::wstring_view{})), decltype(jpeg::Probe(std::wstring_view{}))>);
+
+    std::wstring folder{ helpers::input_img_path };
+    folder += L"png/";
+
+    // Palette, low bit depth grayscale and transparency chunks change the decoded layout.
+    for (auto name : { L"basn0g01.png", L"basn0g16.png", L"basn2c08.png", L"basn3p04.png", L"basn4a16.png", L"basn6a08.png",
+        L"basi3p08.png", L"tbbn0g04.png", L"tbbn3p08.png", L"tbrn2c08.png", L"tbwn0g16.png" })
+    {
+        std::wstring path{ folder };
+        path += name;
+
+        png::RowReader reader{ path };
+        auto expected = reader.layout();
+        for (const auto& layout : { png::Probe(path), png::Probe(read_bytes(path)) })
+        {
+            EXPECT_EQ(layout.height, expected.height);
+            EXPECT_EQ(layout.width, expected.width);
+            EXPECT_EQ(layout.color_space, expected.color_space);
+            EXPECT_EQ(layout.num_channels, expected.num_channels);
+            EXPECT_EQ(layout.bit_depth, expected.bit_depth);
+        }
+    }
+
+    std::wstring jpegPath{ helpers::input_img_path };
+    jpegPath += L"petit_prince.jpg";
+    auto img = jpeg::Read(jpegPath);
+    auto layout = jpeg::Probe(read_bytes(jpegPath));
+    EXPECT_EQ(layout.height, img.height());
+    EXPECT_EQ(layout.width, img.width());
+    EXPECT_EQ(layout.color_space, img.color_space());
+    EXPECT_EQ(layout.num_channels, img.num_channels());
+    EXPECT_EQ(layout.bit_depth, 8);
+
+    Color<jpeg::data_type, 3> start{ ColorSpace::RGB, 200, 30, 90 };
+    Color<jpeg::data_type, 3> end{ ColorSpace::RGB, 20, 180, 240 };
+    auto cmyk = rgb_to_cmyk(algorithm::horizontal_linear_gradient(64, 2, 32, start, end), true);
+    std::wstring cmykPath{ helpers::output_img_path };
+    cmykPath += L"cmyk_probe.jpg";
+    jpeg::Write(cmykPath, 90, cmyk);
+
+    layout = jpeg::Probe(cmykPath);
+    EXPECT_EQ(layout.color_space, ColorSpace::CMYK);
+    EXPECT_EQ(layout.num_channels, 4);
+    layout = jpeg::Probe(cmykPath, jpeg::ReadSettings{ true });
+    EXPECT_EQ(layout.color_space, ColorSpace::RGB);
+    EXPECT_EQ(layout.num_channels, 3);
+
+    std::wstring pngPath{ folder };
+    pngPath += L"basn2c08.png";
+    EXPECT_THROW(jpeg::Probe(pngPath), std::runtime_error);
+    EXPECT_THROW(png::Probe(jpegPath), std::runtime_error);
+}
+
+TEST(AlgorithmTestsIO, jpeg_read_containers)
+{
+    std::wstring path{ helpers::input_img_path };
+    path += L"petit_prince.jpg";
+    auto planar = jpeg::Read(path);
+
+    CImage<jpeg::data_type, 3> cimg;
+    jpeg::Read(path, cimg);
+    PImage<jpeg::data_type, 3> pimg;
+    jpeg::Read(read_bytes(path), pimg);
+
+    ASSERT_EQ(cimg.height(), planar.height());
+    ASSERT_EQ(cimg.width(), planar.width());
+    ASSERT_EQ(pimg.size(), planar.size());
+    for (size_t i = 0; i < planar.size(); i++)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            EXPECT_EQ(cimg(i, k), planar(k)(i));
+            EXPECT_EQ(pimg(i).p[k], planar(k)(i));
+        }
+    }
+
+    std::wstring grayPath{ helpers::input_img_path };
+    grayPath += L"petit_prince_grayscale.jpg";
+    auto gray = jpeg::Read(grayPath);
+    CImage<jpeg::data_type, 1> cgray;
+    jpeg::Read(grayPath, cgray);
+    EXPECT_TRUE(std::equal(gray(0).cbegin(), gray(0).cend(), &cgray(0, 0)));
+    EXPECT_THROW(jpeg::Read(grayPath, cimg), std::runtime_error);
+
+    // CMYK is converted to RGB while the rows are copied into the image.
+    Color<jpeg::data_type, 3> start{ ColorSpace::RGB, 200, 30, 90 };
+    Color<jpeg::data_type, 3> end{ ColorSpace::RGB, 20, 180, 240 };
+    auto cmyk = rgb_to_cmyk(algorithm::horizontal_linear_gradient(64, 2, 32, start, end), true);
+    std::wstring cmykPath{ helpers::output_img_path };
+    cmykPath += L"cmyk_containers.jpg";
+    jpeg::Write(cmykPath, 90, cmyk);
+
+    auto converted = jpeg::Read(cmykPath, jpeg::ReadSettings{ true });
+    jpeg::Read(cmykPath, cimg, jpeg::ReadSettings{ true });
+    EXPECT_EQ(cimg.color_space(), ColorSpace::RGB);
+    ASSERT_EQ(cimg.size(), converted.size());
+    for (size_t i = 0; i < converted.size(); i++)
+        for (size_t k = 0; k < 3; k++)
+            EXPECT_EQ(cimg(i, k), converted(k)(i));
+}
+
+TEST(AlgorithmTestsIO, jpeg_shrink_on_decode)
+{
+    auto differences = [](const jpeg::JpegImg& img1, const jpeg::JpegImg& img2)
+        {
+            double sum{ 0 };
+            int max{ 0 };
+            for (size_t t = 0; t < img1.num_channels(); t++)
+            {
+                for (size_t i = 0; i < img1.size(); i++)
+                {
+                    int diff = std::abs(img1(t)(i) - img2(t)(i));
+                    sum += diff;
+                    max = std::max(max, diff);
+                }
+            }
+
+            return std::make_pair(sum / (img1.size() * img1.num_channels()), max);
+        };
+
+    for (auto name : { L"petit_prince.jpg", L"petit_prince_grayscale.jpg" })
+    {
+        std::wstring path{ helpers::input_img_path };
+        path += name;
+        auto full = jpeg::Read(path);
+
+        for (size_t shrink : { 2, 3, 4, 6, 8, 16 })
+        {
+            auto expected = algorithm::Shrink(full, shrink);
+            auto img = jpeg::Read(path, jpeg::ReadSettings{ false, shrink });
+            ASSERT_EQ(img.height(), expected.height());
+            ASSERT_EQ(img.width(), expected.width());
+            EXPECT_EQ(img.color_space(), expected.color_space());
+
+            auto layout = jpeg::Probe(path, jpeg::ReadSettings{ false, shrink });
+            EXPECT_EQ(layout.height, img.height());
+            EXPECT_EQ(layout.width, img.width());
+
+            auto [mean, max] = differences(img, expected);
+            if (shrink == 3)
+                EXPECT_EQ(max, 0);
+            else if (full.num_channels() == 1)
+                EXPECT_LE(max, 1);
+            else
+                EXPECT_LT(mean, 1.0);
+        }
+
+        CImage<jpeg::data_type, 1> cgray;
+        if (full.num_channels() == 1)
+        {
+            jpeg::Read(path, cgray, jpeg::ReadSettings{ false, 4 });
+            auto planar = jpeg::Read(path, jpeg::ReadSettings{ false, 4 });
+            ASSERT_EQ(cgray.size(), planar.size());
+            EXPECT_TRUE(std::equal(planar(0).cbegin(), planar(0).cend(), &cgray(0, 0)));
+        }
+
+        EXPECT_THROW(jpeg::Read(path, jpeg::ReadSettings{ false, 0 }), std::invalid_argument);
+        EXPECT_THROW(jpeg::Read(path, jpeg::ReadSettings{ false, full.height() + 1 }), std::invalid_argument);
+    }
+}
+
+TEST(AlgorithmTestsIO, jpeg_raw_components)
+{
+    std::wstring path{ helpers::input_img_path };
+    path += L"petit_prince.jpg";
+    auto rgb = jpeg::Read(path);
+
+    jpeg::ReadSettings stored{ false, 1, jpeg::Components::Stored };
+    auto ycbcr = jpeg::Read(path, stored);
+    EXPECT_EQ(ycbcr.color_space(), ColorSpace::YCbCr);
+    ASSERT_EQ(ycbcr.num_channels(), 3);
+    ASSERT_EQ(ycbcr.size(), rgb.size());
+
+    auto layout = jpeg::Probe(path, stored);
+    EXPECT_EQ(layout.color_space, ColorSpace::YCbCr);
+    EXPECT_EQ(layout.num_channels, 3);
+
+    // A JFXX extension after the JFIF marker keeps the file YCbCr, also next to an Adobe marker with transform 0.
+    auto bytes = read_bytes(path);
+    ASSERT_EQ(std::to_integer<int>(bytes[3]), 0xE0);
+    const size_t jfifEnd = 4 + ((std::to_integer<size_t>(bytes[4]) << 8) | std::to_integer<size_t>(bytes[5]));
+    const unsigned char markers[] = {
+        0xFF, 0xE0, 0x00, 0x08, 'J', 'F', 'X', 'X', 0x00, 0x13,
+        0xFF, 0xEE, 0x00, 0x0E, 'A', 'd', 'o', 'b', 'e', 0x00, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    bytes.insert(bytes.begin() + jfifEnd, reinterpret_cast<std::byte const*>(markers), reinterpret_cast<std::byte const*>(markers) + sizeof(markers));
+    EXPECT_EQ(jpeg::Read(bytes, stored).color_space(), ColorSpace::YCbCr);
+    EXPECT_EQ(jpeg::Probe(bytes, stored).color_space, ColorSpace::YCbCr);
+
+    // Luma is the Y component, without the chroma upsampling the full decode does.
+    jpeg::ReadSettings luma{ false, 1, jpeg::Components::Luma };
+    auto gray = jpeg::Read(path, luma);
+    EXPECT_EQ(gray.color_space(), ColorSpace::GrayScale);
+    ASSERT_EQ(gray.num_channels(), 1);
+    EXPECT_TRUE(std::equal(gray(0).cbegin(), gray(0).cend(), ycbcr(0).cbegin()));
+
+    layout = jpeg::Probe(path, luma);
+    EXPECT_EQ(layout.color_space, ColorSpace::GrayScale);
+    EXPECT_EQ(layout.num_channels, 1);
+
+    CImage<jpeg::data_type, 1> cgray;
+    jpeg::Read(read_bytes(path), cgray, luma);
+    EXPECT_TRUE(std::equal(gray(0).cbegin(), gray(0).cend(), &cgray(0, 0)));
+
+    // The components as they are stored, the chroma of petit_prince.jpg is subsampled in both directions.
+    auto raw = jpeg::ReadRaw(path);
+    EXPECT_EQ(raw.color_space, ColorSpace::YCbCr);
+    ASSERT_EQ(raw.components.size(), 3);
+    EXPECT_EQ(raw.components[0].num_rows(), rgb.height());
+    EXPECT_EQ(raw.components[0].num_columns(), rgb.width());
+    EXPECT_TRUE(std::equal(raw.components[0].cbegin(), raw.components[0].cend(), gray(0).cbegin()));
+    for (size_t c : { 1, 2 })
+    {
+        EXPECT_EQ(raw.components[c].num_rows(), (rgb.height() + 1) / 2);
+        EXPECT_EQ(raw.components[c].num_columns(), (rgb.width() + 1) / 2);
+    }
+
+    // Writing the components back needs no color conversion or downsampling.
+    auto written = jpeg::WriteRaw(100, raw);
+    auto reread = jpeg::ReadRaw(written);
+    EXPECT_EQ(reread.color_space, ColorSpace::YCbCr);
+    ASSERT_EQ(reread.components.size(), 3);
+    for (size_t c = 0; c < 3; c++)
+    {
+        ASSERT_EQ(reread.components[c].num_rows(), raw.components[c].num_rows());
+        ASSERT_EQ(reread.components[c].num_columns(), raw.components[c].num_columns());
+        int max{ 0 };
+        for (size_t i = 0; i < raw.components[c].size(); i++)
+            max = std::max(max, std::abs(reread.components[c](i) - raw.components[c](i)));
+
+        EXPECT_LE(max, 3);
+    }
+
+    std::wstring outPath{ helpers::output_img_path };
+    outPath += L"petit_prince_raw.jpg";
+    jpeg::WriteRaw(outPath, 90, raw);
+    EXPECT_EQ(jpeg::Read(outPath).size(), rgb.size());
+
+    raw.components[1] = Channel<jpeg::data_type>(3, 3);
+    EXPECT_THROW(jpeg::WriteRaw(90, raw), std::invalid_argument);
+
+    Color<jpeg::data_type, 3> start{ ColorSpace::RGB, 200, 30, 90 };
+    Color<jpeg::data_type, 3> end{ ColorSpace::RGB, 20, 180, 240 };
+    auto cmyk = rgb_to_cmyk(algorithm::horizontal_linear_gradient(64, 2, 32, start, end), true);
+    std::wstring cmykPath{ helpers::output_img_path };
+    cmykPath += L"cmyk_components.jpg";
+    jpeg::Write(cmykPath, 90, cmyk);
+    EXPECT_THROW(jpeg::Read(cmykPath, luma), std::runtime_error);
+    EXPECT_THROW(jpeg::Probe(cmykPath, luma), std::runtime_error);
+    EXPECT_EQ(jpeg::Probe(cmykPath, stored).color_space, ColorSpace::CMYK);
+}
+
+TEST(AlgorithmTestsIO, jpeg_write_settings)
+{
+    std::wstring path{ helpers::input_img_path };
+    path += L"petit_prince.jpg";
+    auto img = jpeg::Read(path);
+    CImage<jpeg::data_type, 3> cimg;
+    jpeg::Read(path, cimg);
+    PImage<jpeg::data_type, 3> pimg;
+    jpeg::Read(path, pimg);
+
+    // Planar images are interleaved a few rows at a time, interleaved ones are encoded in place: the files are the same.
+    auto planar = jpeg::Write(90, img);
+    EXPECT_EQ(jpeg::Write(90, cimg), planar);
+    EXPECT_EQ(jpeg::Write(90, pimg), planar);
+
+    std::wstring outPath{ helpers::output_img_path };
+    outPath += L"petit_prince_cimage.jpg";
+    jpeg::Write(outPath, 90, cimg);
+    EXPECT_EQ(read_bytes(outPath), planar);
+
+    auto optimized = jpeg::Write(90, img, jpeg::WriteSettings{ jpeg::DctMethod::Integer, true });
+    EXPECT_LT(optimized.size(), planar.size());
+
+    // Optimized tables and progressive scans change the coding only, the decoded image stays the same.
+    auto expected = jpeg::Read(planar);
+    for (const auto& data : { optimized, jpeg::Write(90, img, jpeg::WriteSettings{ jpeg::DctMethod::Integer, false, true }) })
+    {
+        auto decoded = jpeg::Read(data);
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_TRUE(std::equal(decoded(t).cbegin(), decoded(t).cend(), expected(t).cbegin()));
+    }
+
+    for (auto method : { jpeg::DctMethod::Fast, jpeg::DctMethod::Float })
+    {
+        auto decoded = jpeg::Read(jpeg::Write(90, cimg, jpeg::WriteSettings{ method }));
+        double sum{ 0 };
+        for (size_t t = 0; t < 3; t++)
+            for (size_t i = 0; i < decoded.size(); i++)
+                sum += std::abs(decoded(t)(i) - expected(t)(i));
+
+        EXPECT_LT(sum / (3 * decoded.size()), 1.0);
+    }
+
+    EXPECT_THROW(jpeg::Write(90, PImage<jpeg::data_type, 3>{}), std::invalid_argument);
+}
@@ -0,0 +1,369 @@
+#include "pch.h"
+#include "test_helpers.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+#include <imglib/color/color_conversion.hpp>
+#include <imglib/image/image.hpp>
+#include <imglib/image/cimage.hpp>
+#include <imglib/image/pimage.hpp>
+
+using namespace imglib;
+
+namespace
+{
+    template <typename T>
+    Image<T> MakeRgbPattern(size_t height, size_t width)
+    {
+        Image<T> img{ height, width, ColorSpace::RGB, 3 };
+        for (size_t t = 0; t < 3; t++)
+            for (size_t i = 0; i < img.size(); i++)
+                img(t)(i) = static_cast<T>((i * 2654435761u + t * 40503u) % (static_cast<size_t>(std::numeric_limits<T>::max()) + 1));
+
+        return img;
+    }
+
+    template <typename T>
+    CImage<T, 3> ToCImage(const Image<T>& img)
+    {
+        CImage<T, 3> cimg{ img.height(), img.width(), img.color_space() };
+        for (size_t i = 0; i < img.size(); i++)
+            cimg.set_pixel(i, img(0)(i), img(1)(i), img(2)(i));
+
+        return cimg;
+    }
+
+    template <typename T>
+    PImage<T, 3> ToPImage(const Image<T>& img)
+    {
+        PImage<T, 3> pimg{ img.height(), img.width(), img.color_space() };
+        for (size_t i = 0; i < img.size(); i++)
+            pimg(i) = Pixel<T, 3>{ img(0)(i), img(1)(i), img(2)(i) };
+
+        return pimg;
+    }
+}
+
+TEST(ColorTests, rgb_to_ycbcr_values)
+{
+    Image<std::uint8_t> img{ 1, 3, ColorSpace::RGB, 3 };
+    img.set_pixel(0, std::uint8_t{ 255 }, std::uint8_t{ 0 }, std::uint8_t{ 0 });
+    img.set_pixel(1, std::uint8_t{ 90 }, std::uint8_t{ 90 }, std::uint8_t{ 90 });
+    img.set_pixel(2, std::uint8_t{ 0 }, std::uint8_t{ 0 }, std::uint8_t{ 255 });
+
+    auto ycbcr = rgb_to_ycbcr(img);
+    EXPECT_EQ(ycbcr.color_space(), ColorSpace::YCbCr);
+
+    // Pure red: Y = 0.299 * 255, Cb = 128 - 0.1687 * 255, Cr saturates
+    EXPECT_EQ(ycbcr(0)(0), 76);
+    EXPECT_EQ(ycbcr(1)(0), 85);
+    EXPECT_EQ(ycbcr(2)(0), 255);
+
+    // Gray has no chroma
+    EXPECT_EQ(ycbcr(0)(1), 90);
+    EXPECT_EQ(ycbcr(1)(1), 128);
+    EXPECT_EQ(ycbcr(2)(1), 128);
+
+    auto luma709 = rgb_to_luma(img, LumaStandard::Rec709);
+    EXPECT_EQ(luma709(0)(0), 54);
+    EXPECT_EQ(luma709(0)(1), 90);
+    EXPECT_EQ(luma709(0)(2), 18);
+
+    auto gray = rgb_to_grayscale(img);
+    EXPECT_EQ(gray.color_space(), ColorSpace::GrayScale);
+    EXPECT_EQ(gray(0)(0), ycbcr(0)(0));
+    EXPECT_EQ(gray(0)(2), ycbcr(0)(2));
+
+    // The other sample types are weighted in floating point
+    Image<float> imgf{ 1, 2, ColorSpace::RGB, 3 };
+    imgf(0)(0) = 1.0f;
+    imgf(1)(1) = 1.0f;
+    auto grayf = rgb_to_grayscale(imgf);
+    EXPECT_NEAR(grayf(0)(0), 0.299f, 1e-6f);
+    EXPECT_NEAR(grayf(0)(1), 0.587f, 1e-6f);
+
+    Image<int> imgi{ 1, 1, ColorSpace::RGB, 3 };
+    imgi(0)(0) = imgi(1)(0) = imgi(2)(0) = 1000;
+    EXPECT_EQ(rgb_to_grayscale(imgi)(0)(0), 1000);
+
+    auto img16 = MakeRgbPattern<std::uint16_t>(20, 30);
+    auto gray16 = rgb_to_grayscale(img16);
+    auto luma16 = rgb_to_luma(img16);
+    EXPECT_TRUE(std::equal(gray16(0).cbegin(), gray16(0).cend(), luma16(0).cbegin()));
+
+    EXPECT_THROW(ycbcr_to_rgb(img), std::invalid_argument);
+}
+
+TEST(ColorTests, ycbcr_round_trip)
+{
+    for (auto standard : { LumaStandard::Rec601, LumaStandard::Rec709 })
+    {
+        auto img8 = MakeRgbPattern<std::uint8_t>(61, 83);
+        auto back8 = ycbcr_to_rgb(rgb_to_ycbcr(img8, standard, 2), standard, 2);
+        for (size_t t = 0; t < 3; t++)
+            for (size_t i = 0; i < img8.size(); i++)
+                EXPECT_LE(std::abs(back8(t)(i) - img8(t)(i)), 3);
+
+        auto img16 = MakeRgbPattern<std::uint16_t>(20, 30);
+        auto back16 = ycbcr_to_rgb(rgb_to_ycbcr(img16, standard), standard);
+        for (size_t t = 0; t < 3; t++)
+            for (size_t i = 0; i < img16.size(); i++)
+                EXPECT_LE(std::abs(back16(t)(i) - img16(t)(i)), 3);
+    }
+}
+
+TEST(ColorTests, ycbcr_containers_and_in_place)
+{
+    auto img = MakeRgbPattern<std::uint8_t>(33, 47);
+    auto cimg = ToCImage(img);
+    auto pimg = ToPImage(img);
+
+    auto ycbcr = rgb_to_ycbcr(img, LumaStandard::Rec709);
+    auto cycbcr = rgb_to_ycbcr(cimg, LumaStandard::Rec709);
+    auto pycbcr = rgb_to_ycbcr(pimg, LumaStandard::Rec709);
+    auto luma = rgb_to_luma(img);
+    auto cluma = rgb_to_luma(cimg);
+    auto pluma = rgb_to_luma(pimg);
+    EXPECT_EQ(cycbcr.color_space(), ColorSpace::YCbCr);
+    EXPECT_EQ(pluma.color_space(), ColorSpace::GrayScale);
+
+    for (size_t i = 0; i < img.size(); i++)
+    {
+        for (size_t t = 0; t < 3; t++)
+        {
+            EXPECT_EQ(ycbcr(t)(i), cycbcr(i, t));
+            EXPECT_EQ(ycbcr(t)(i), pycbcr(i).p[t]);
+        }
+        EXPECT_EQ(luma(0)(i), cluma(i, 0));
+        EXPECT_EQ(luma(0)(i), pluma(i).p[0]);
+    }
+
+    rgb_to_ycbcr_in_place(img, LumaStandard::Rec709);
+    rgb_to_ycbcr_in_place(cimg, LumaStandard::Rec709);
+    EXPECT_EQ(img.color_space(), ColorSpace::YCbCr);
+    for (size_t i = 0; i < img.size(); i++)
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_EQ(img(t)(i), cimg(i, t));
+
+    auto rgb = ycbcr_to_rgb(ycbcr, LumaStandard::Rec709);
+    ycbcr_to_rgb_in_place(img, LumaStandard::Rec709);
+    ycbcr_to_rgb_in_place(pycbcr, LumaStandard::Rec709);
+    EXPECT_EQ(pycbcr.color_space(), ColorSpace::RGB);
+    for (size_t i = 0; i < img.size(); i++)
+    {
+        for (size_t t = 0; t < 3; t++)
+        {
+            EXPECT_EQ(img(t)(i), rgb(t)(i));
+            EXPECT_EQ(pycbcr(i).p[t], rgb(t)(i));
+        }
+    }
+
+    auto expectedLuma = rgb_to_luma(img);
+    rgb_to_luma_in_place(img);
+    EXPECT_EQ(img.num_channels(), 1);
+    EXPECT_EQ(img.color_space(), ColorSpace::GrayScale);
+    EXPECT_TRUE(std::equal(img(0).cbegin(), img(0).cend(), expectedLuma(0).cbegin()));
+}
+
+TEST(ColorTests, cmyk_to_rgb)
+{
+    // Normalized products are exactly rounded
+    Image<std::uint8_t> cmyk{ 256, 256, ColorSpace::CMYK, 4 };
+    for (size_t i = 0; i < 256; i++)
+    {
+        for (size_t j = 0; j < 256; j++)
+        {
+            auto c = static_cast<std::uint8_t>(255 - i);
+            auto k = static_cast<std::uint8_t>(255 - j);
+            cmyk.set_pixel(i, j, c, std::uint8_t{ 0 }, std::uint8_t{ 255 }, k);
+        }
+    }
+
+    auto rgb = cmyk_to_rgb(cmyk);
+    for (size_t i = 0; i < 256; i++)
+    {
+        for (size_t j = 0; j < 256; j++)
+        {
+            EXPECT_EQ(rgb(0)(i, j), static_cast<std::uint8_t>(std::floor(i * j / 255.0 + 0.5)));
+            EXPECT_EQ(rgb(1)(i, j), j);
+            EXPECT_EQ(rgb(2)(i, j), 0);
+        }
+    }
+
+    // Round trip through both conventions, 16-bit as well
+    auto img = MakeRgbPattern<std::uint8_t>(40, 50);
+    for (bool inverted : { false, true })
+    {
+        auto back = cmyk_to_rgb(rgb_to_cmyk(img, inverted), inverted);
+        for (size_t t = 0; t < 3; t++)
+            for (size_t i = 0; i < img.size(); i++)
+                EXPECT_LE(std::abs(back(t)(i) - img(t)(i)), 1);
+    }
+
+    auto img16 = MakeRgbPattern<std::uint16_t>(20, 30);
+    auto back16 = cmyk_to_rgb(rgb_to_cmyk(img16));
+    for (size_t t = 0; t < 3; t++)
+        for (size_t i = 0; i < img16.size(); i++)
+            EXPECT_LE(std::abs(back16(t)(i) - img16(t)(i)), 1);
+
+    // Inverted CMYK stores the remaining light
+    auto inverted = rgb_to_cmyk(img, true);
+    auto regular = rgb_to_cmyk(img);
+    for (size_t t = 0; t < 4; t++)
+        for (size_t i = 0; i < img.size(); i++)
+            EXPECT_EQ(inverted(t)(i), 255 - regular(t)(i));
+
+    // Interleaved images give the same result
+    CImage<std::uint8_t, 4> ccmyk{ regular.height(), regular.width(), ColorSpace::CMYK };
+    for (size_t i = 0; i < regular.size(); i++)
+        ccmyk.set_pixel(i, regular(0)(i), regular(1)(i), regular(2)(i), regular(3)(i));
+
+    auto crgb = cmyk_to_rgb(ccmyk);
+    auto prgb = cmyk_to_rgb(regular);
+    for (size_t t = 0; t < 3; t++)
+        for (size_t i = 0; i < img.size(); i++)
+            EXPECT_EQ(crgb(i, t), prgb(t)(i));
+}
+
+TEST(ColorTests, ycck_to_rgb)
+{
+    // With no black, YCCK is the YCbCr of the remaining light
+    auto img = MakeRgbPattern<std::uint8_t>(30, 40);
+    auto ycbcr = rgb_to_ycbcr(img);
+
+    Image<std::uint8_t> ycck{ img.height(), img.width(), ColorSpace::YCCK, 4 };
+    for (size_t t = 0; t < 3; t++)
+        ycck(t) = ycbcr(t);
+    ycck(3) = 0;
+
+    auto expected = ycbcr_to_rgb(ycbcr);
+    auto rgb = ycck_to_rgb(ycck);
+    for (size_t t = 0; t < 3; t++)
+        EXPECT_TRUE(std::equal(rgb(t).cbegin(), rgb(t).cend(), expected(t).cbegin()));
+
+    // Inverted files store max - ink, full black is then 0
+    ycck(3) = 0;
+    auto black = ycck_to_rgb(ycck, true);
+    for (size_t t = 0; t < 3; t++)
+        EXPECT_TRUE(helpers::AllPixelsEqualTo<std::uint8_t>(black(t).data(), black.size(), 0));
+
+    // 16-bit values are converted without the tables, with the same results as ycbcr_to_rgb
+    auto img16 = MakeRgbPattern<std::uint16_t>(20, 30);
+    auto ycbcr16 = rgb_to_ycbcr(img16);
+    Image<std::uint16_t> ycck16{ img16.height(), img16.width(), ColorSpace::YCCK, 4 };
+    for (size_t t = 0; t < 3; t++)
+        ycck16(t) = ycbcr16(t);
+    ycck16(3) = 0;
+
+    auto expected16 = ycbcr_to_rgb(ycbcr16);
+    auto rgb16 = ycck_to_rgb(ycck16, false, 2);
+    for (size_t t = 0; t < 3; t++)
+        EXPECT_TRUE(std::equal(rgb16(t).cbegin(), rgb16(t).cend(), expected16(t).cbegin()));
+
+    // Half black halves the light
+    ycck16(3) = 32768;
+    auto dimmed16 = ycck_to_rgb(ycck16);
+    for (size_t t = 0; t < 3; t++)
+        for (size_t i = 0; i < dimmed16.size(); i++)
+            EXPECT_LE(std::abs(2 * dimmed16(t)(i) - expected16(t)(i)), 2);
+}
+
+TEST(ColorTests, hsv_hsl)
+{
+    Image<std::uint8_t> img{ 1, 5, ColorSpace::RGB, 3 };
+    img.set_pixel(0, std::uint8_t{ 255 }, std::uint8_t{ 0 }, std::uint8_t{ 0 });
+    img.set_pixel(1, std::uint8_t{ 0 }, std::uint8_t{ 255 }, std::uint8_t{ 0 });
+    img.set_pixel(2, std::uint8_t{ 0 }, std::uint8_t{ 0 }, std::uint8_t{ 255 });
+    img.set_pixel(3, std::uint8_t{ 90 }, std::uint8_t{ 90 }, std::uint8_t{ 90 });
+    img.set_pixel(4, std::uint8_t{ 255 }, std::uint8_t{ 0 }, std::uint8_t{ 1 });
+
+    auto hsv = rgb_to_hsv(img);
+    EXPECT_EQ(hsv.color_space(), ColorSpace::HSV);
+    std::uint8_t expectedHsv[5][3]{ { 0, 255, 255 }, { 85, 255, 255 }, { 171, 255, 255 }, { 0, 0, 90 }, { 0, 255, 255 } };
+    for (size_t i = 0; i < 5; i++)
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_EQ(hsv(t)(i), expectedHsv[i][t]);
+
+    auto hsl = rgb_to_hsl(img);
+    EXPECT_EQ(hsl.color_space(), ColorSpace::HSL);
+    std::uint8_t expectedHsl[5][3]{ { 0, 255, 128 }, { 85, 255, 128 }, { 171, 255, 128 }, { 0, 0, 90 }, { 0, 255, 128 } };
+    for (size_t i = 0; i < 5; i++)
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_EQ(hsl(t)(i), expectedHsl[i][t]);
+
+    // 16-bit hue uses the same fractions of the range
+    Image<std::uint16_t> img16{ 1, 1, ColorSpace::RGB, 3 };
+    img16.set_pixel(0, std::uint16_t{ 0 }, std::uint16_t{ 65535 }, std::uint16_t{ 0 });
+    EXPECT_EQ(rgb_to_hsv(img16)(0)(0), 21845);
+
+    auto pattern = MakeRgbPattern<std::uint8_t>(20, 30);
+    auto chsv = rgb_to_hsv(ToCImage(pattern));
+    auto phsl = rgb_to_hsl(ToPImage(pattern));
+    auto phsv = rgb_to_hsv(pattern);
+    auto plhsl = rgb_to_hsl(pattern);
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        for (size_t t = 0; t < 3; t++)
+        {
+            EXPECT_EQ(chsv(i, t), phsv(t)(i));
+            EXPECT_EQ(phsl(i).p[t], plhsl(t)(i));
+        }
+    }
+
+    EXPECT_THROW(rgb_to_hsv(hsv), std::invalid_argument);
+}
+
+TEST(ColorTests, lab)
+{
+    auto reference = [](double r, double g, double b, double max)
+        {
+            auto linear = [max](double v) { v /= max; return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4); };
+            auto f = [](double t) { return t > 216.0 / 24389.0 ? std::cbrt(t) : (24389.0 / 27.0 * t + 16.0) / 116.0; };
+            double R = linear(r), G = linear(g), B = linear(b);
+            double fx = f((0.412453 * R + 0.357580 * G + 0.180423 * B) / 0.950456);
+            double fy = f(0.212671 * R + 0.715160 * G + 0.072169 * B);
+            double fz = f((0.019334 * R + 0.119193 * G + 0.950227 * B) / 1.088754);
+            double range = max + 1.0;
+            return std::array<double, 3>{ (116.0 * fy - 16.0) * max / 100.0, 500.0 * (fx - fy) * range / 256.0 + range / 2.0,
+                200.0 * (fy - fz) * range / 256.0 + range / 2.0 };
+        };
+
+    Image<std::uint8_t> img{ 1, 3, ColorSpace::RGB, 3 };
+    img.set_pixel(0, std::uint8_t{ 255 }, std::uint8_t{ 255 }, std::uint8_t{ 255 });
+    img.set_pixel(1, std::uint8_t{ 0 }, std::uint8_t{ 0 }, std::uint8_t{ 0 });
+    img.set_pixel(2, std::uint8_t{ 255 }, std::uint8_t{ 0 }, std::uint8_t{ 0 });
+
+    auto lab = rgb_to_lab(img);
+    EXPECT_EQ(lab.color_space(), ColorSpace::Lab);
+    std::uint8_t expected[3][3]{ { 255, 128, 128 }, { 0, 128, 128 }, { 136, 208, 195 } };
+    for (size_t i = 0; i < 3; i++)
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_EQ(lab(t)(i), expected[i][t]);
+
+    auto img8 = MakeRgbPattern<std::uint8_t>(40, 50);
+    auto lab8 = rgb_to_lab(img8, 2);
+    for (size_t i = 0; i < img8.size(); i++)
+    {
+        auto ref = reference(img8(0)(i), img8(1)(i), img8(2)(i), 255.0);
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_LE(std::abs(lab8(t)(i) - ref[t]), 0.51);
+    }
+
+    auto img16 = MakeRgbPattern<std::uint16_t>(40, 50);
+    auto lab16 = rgb_to_lab(img16);
+    for (size_t i = 0; i < img16.size(); i++)
+    {
+        auto ref = reference(img16(0)(i), img16(1)(i), img16(2)(i), 65535.0);
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_LE(std::abs(lab16(t)(i) - ref[t]), 4.0);
+    }
+
+    auto clab = rgb_to_lab(ToCImage(img8));
+    for (size_t i = 0; i < img8.size(); i++)
+        for (size_t t = 0; t < 3; t++)
+            EXPECT_EQ(clab(i, t), lab8(t)(i));
+}
@@ -30,6 +30,10 @@ TEST(ImageTests, Constructor_test1)
 	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::YCbCr, 4), std::invalid_argument);
 	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::YCCK, 1), std::invalid_argument);
 	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::YCCK, 6), std::invalid_argument);
+	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::YCCK, 3), std::invalid_argument);
+	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::HSV, 4), std::invalid_argument);
+	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::HSL, 1), std::invalid_argument);
+	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::Lab, 4), std::invalid_argument);
 	EXPECT_THROW(Image<uint8_t>(2, 4, ColorSpace::Unspecified, 0), std::invalid_argument);
 
 	EXPECT_THROW(Image<uint8_t>(0, 4, ColorSpace::GrayScale, 1), std::invalid_argument);
@@ -38,8 +42,11 @@ TEST(ImageTests, Constructor_test1)
 	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::GrayScale, 1));
 	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::RGB, 3));
 	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::YCbCr, 3));
-	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::YCCK, 3));
+	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::YCCK, 4));
 	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::CMYK, 4));
+	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::HSV, 3));
+	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::HSL, 3));
+	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::Lab, 3));
 	EXPECT_NO_THROW(Image<uint8_t>(2, 4, ColorSpace::Unspecified, 15));
 }
 
@@ -1,7 +1,20 @@
 #include <imglib/adaptors/jpeg_adaptor.hpp>
+#include <imglib/algorithms/geometric_modifications.hpp>
+#include <imglib/color/color_conversion.hpp>
+#include <imglib/utility/byte_reader.hpp>
+#include <imglib/utility/interleave.hpp>
 
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 #include <format>
+#include <utility>
+#include <vector>
+
+#include <jerror.h>
 
 namespace imglib::jpeg 
 {
@@ -48,121 +61,978 @@ namespace imglib::jpeg
                 return ColorSpace::Unspecified;
             }
         }
-    }
-    
-    void Write(std::wstring_view fileName, int quality, const Image<data_type>& img)
-    {
-        // Open the file for writing the jpeg image.
-        FILE* outFile = OpenFile(fileName, Mode::Write);
 
-        bool success{ false };
-        jpeg_compress_struct cinfo{};
+        // Color space and number of channels of the decoded image, as StartRead sets them up.
+        std::pair<ColorSpace, size_t> GetOutputColorSpace(J_COLOR_SPACE jpegColorSpace, size_t numComponents, const ReadSettings& settings)
+        {
+            if (settings.components == Components::Stored)
+                return { Convert(jpegColorSpace), numComponents };
+
+            if (settings.components == Components::Luma)
+            {
+                if (jpegColorSpace != JCS_YCbCr && jpegColorSpace != JCS_GRAYSCALE)
+                    throw std::runtime_error("Image has no luma component.");
+
+                return { ColorSpace::GrayScale, 1 };
+            }
+
+            switch (jpegColorSpace)
+            {
+            case JCS_GRAYSCALE:
+                return { ColorSpace::GrayScale, 1 };
+            case JCS_RGB:
+            case JCS_YCbCr:
+                return { ColorSpace::RGB, 3 };
+            case JCS_CMYK:
+            case JCS_YCCK:
+                return settings.cmyk_to_rgb ? std::pair{ ColorSpace::RGB, size_t{ 3 } } : std::pair{ ColorSpace::CMYK, size_t{ 4 } };
+            default:
+                return { ColorSpace::Unspecified, numComponents };
+            }
+        }
 
-        try 
+        // Layout from the frame header, the segments before it are skipped over. The color space of the file is guessed
+        // from the JFIF and Adobe markers and the component ids the way libjpeg does.
+        ImageLayout ProbeLayout(imglib::detail::ByteReader& reader, const ReadSettings& settings)
         {
-            // Allocate and initialize JPEG compression object
-            jpeg_error_mgr jerr{};
-            cinfo.err = jpeg_std_error(&jerr);
-            jpeg_create_compress(&cinfo);
-            cinfo.image_height = static_cast<int>(img.height());
-            cinfo.image_width = static_cast<int>(img.width());
-            cinfo.input_components = static_cast<int>(img.num_channels());
-            cinfo.in_color_space = Convert(img.color_space());
+            std::uint8_t bytes[12];
+            if (!reader.read(bytes, 2) || bytes[0] != 0xFF || bytes[1] != 0xD8)     // start of image
+                throw std::runtime_error("Data is not a jpeg file.");
 
-            jpeg_set_defaults(&cinfo);
-            jpeg_set_quality(&cinfo, quality, TRUE);
-            jpeg_stdio_dest(&cinfo, outFile);
-            jpeg_start_compress(&cinfo, TRUE);
+            bool sawJfif{ false };
+            int adobeTransform{ -1 };
 
-            int rowStride = cinfo.image_width * cinfo.input_components;
-            data_type* rowPointer[1];
-            auto buffer = img.data();
-            while (cinfo.next_scanline < cinfo.image_height)
+            while (true)
             {
-                rowPointer[0] = &(buffer[cinfo.next_scanline * rowStride]);
-                jpeg_write_scanlines(&cinfo, rowPointer, 1);
+                // Markers may be preceded by fill bytes, anything else in between is skipped as libjpeg does.
+                do
+                {
+                    if (!reader.read(bytes, 1))
+                        throw std::runtime_error("JPEG frame header is missing.");
+                } while (bytes[0] != 0xFF);
+
+                do
+                {
+                    if (!reader.read(bytes, 1))
+                        throw std::runtime_error("JPEG frame header is missing.");
+                } while (bytes[0] == 0xFF);
+
+                // Markers without a segment: TEM and the restart markers.
+                const std::uint8_t marker = bytes[0];
+                if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+                    continue;
+
+                // End of image or start of scan.
+                if (marker == 0xD9 || marker == 0xDA)
+                    throw std::runtime_error("JPEG frame header is missing.");
+
+                if (!reader.read(bytes, 2))
+                    throw std::runtime_error("JPEG frame header is missing.");
+
+                size_t length = (size_t{ bytes[0] } << 8) | bytes[1];
+                if (length < 2)
+                    throw std::runtime_error("Invalid jpeg marker.");
+
+                length -= 2;
+
+                // APP0 with a JFIF identifier and APP14 with an Adobe one. Like libjpeg, a later APP0 such as a JFXX
+                // extension does not clear the JFIF flag.
+                if (marker == 0xE0 && length >= 5)
+                {
+                    if (!reader.read(bytes, 5))
+                        throw std::runtime_error("JPEG frame header is missing.");
+
+                    sawJfif = sawJfif || std::memcmp(bytes, "JFIF", 5) == 0;
+                    length -= 5;
+                }
+                else if (marker == 0xEE && length >= 12)
+                {
+                    if (!reader.read(bytes, 12))
+                        throw std::runtime_error("JPEG frame header is missing.");
+
+                    if (std::memcmp(bytes, "Adobe", 5) == 0)
+                        adobeTransform = bytes[11];
+
+                    length -= 12;
+                }
+
+                // Start of frame markers, without DHT, JPG and DAC which share the range.
+                const bool isFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+                if (!isFrame)
+                {
+                    if (!reader.skip(length))
+                        throw std::runtime_error("JPEG frame header is missing.");
+
+                    continue;
+                }
+
+                if (length < 6 || !reader.read(bytes, 6))
+                    throw std::runtime_error("Invalid jpeg frame header.");
+
+                const int precision = bytes[0];
+                const size_t height = (size_t{ bytes[1] } << 8) | bytes[2];
+                const size_t width = (size_t{ bytes[3] } << 8) | bytes[4];
+                const size_t numComponents = bytes[5];
+                if (height == 0 || width == 0 || numComponents == 0)
+                    throw std::runtime_error("Invalid jpeg frame header.");
+
+                if (settings.shrink == 0 || settings.shrink > height || settings.shrink > width)
+                    throw std::invalid_argument("Invalid shrink factor.");
+
+                // Component ids of three component files without a JFIF or Adobe marker.
+                std::uint8_t ids[3]{};
+                for (size_t i = 0; i < std::min(numComponents, size_t{ 3 }); i++)
+                {
+                    if (!reader.read(bytes, 3))
+                        throw std::runtime_error("Invalid jpeg frame header.");
+
+                    ids[i] = bytes[0];
+                }
+
+                J_COLOR_SPACE jpegColorSpace{ JCS_UNKNOWN };
+                if (numComponents == 1)
+                    jpegColorSpace = JCS_GRAYSCALE;
+                else if (numComponents == 3 && sawJfif)
+                    jpegColorSpace = JCS_YCbCr;
+                else if (numComponents == 3 && adobeTransform >= 0)
+                    jpegColorSpace = adobeTransform == 0 ? JCS_RGB : JCS_YCbCr;
+                else if (numComponents == 3)
+                    jpegColorSpace = ids[0] == 'R' && ids[1] == 'G' && ids[2] == 'B' ? JCS_RGB : JCS_YCbCr;
+                else if (numComponents == 4)
+                    jpegColorSpace = adobeTransform > 0 ? JCS_YCCK : JCS_CMYK;
+
+                auto [cspace, numChannels] = GetOutputColorSpace(jpegColorSpace, numComponents, settings);
+                return ImageLayout{ height / settings.shrink, width / settings.shrink, cspace, numChannels, precision };
             }
+        }
 
-            jpeg_finish_compress(&cinfo);
+        // Error manager that jumps back into the failing call instead of exiting the process.
+        struct ErrorManager
+        {
+            jpeg_error_mgr pub{};
+            std::jmp_buf jump{};
+            char message[JMSG_LENGTH_MAX]{};
+        };
 
-            // Close the file and release the JPEG compression object
-            fclose(outFile);
-            outFile = nullptr;
+        [[noreturn]] void ErrorExit(j_common_ptr cinfo)
+        {
+            auto* err = reinterpret_cast<ErrorManager*>(cinfo->err);
+            (*cinfo->err->format_message)(cinfo, err->message);
+            std::longjmp(err->jump, 1);
+        }
 
-            jpeg_destroy_compress(&cinfo);
-            success = true;
+        // Exceptions must not unwind through libjpeg. Callbacks report them as an out of memory error of libjpeg, which
+        // ends up in the same jump as its own errors.
+        [[noreturn]] void ExitOutOfMemory(j_common_ptr cinfo)
+        {
+            cinfo->err->msg_code = JERR_OUT_OF_MEMORY;
+            cinfo->err->msg_parm.i[0] = 0;
+            (*cinfo->err->error_exit)(cinfo);
+            std::abort();   // error_exit does not return
         }
-        catch (...) 
+
+        // The creation allocates the memory manager and fails through error_exit like the other calls. Destroying an
+        // object whose creation failed is a no-op for libjpeg.
+        void CreateDecompress(jpeg_decompress_struct& cinfo, ErrorManager& err)
         {
-            if (!success)
+            if (setjmp(err.jump))
+            {
+                jpeg_destroy_decompress(&cinfo);
+                throw std::runtime_error(err.message);
+            }
+
+            jpeg_create_decompress(&cinfo);
+        }
+
+        void CreateCompress(jpeg_compress_struct& cinfo, ErrorManager& err)
+        {
+            if (setjmp(err.jump))
             {
-                if (outFile)
-                    fclose(outFile);
-                
                 jpeg_destroy_compress(&cinfo);
+                throw std::runtime_error(err.message);
             }
 
-            throw std::runtime_error("Something went wrong while writing the image to a jpeg file.");
+            jpeg_create_compress(&cinfo);
         }
-    }
 
-    Image<data_type> Read(std::wstring_view fileName)
-    {
-        // Open the jpeg file for reading.
-        FILE* inFile = OpenFile(fileName, Mode::Read);
+        // Open file and libjpeg decompression object, released in the destructor.
+        struct DecompressContext
+        {
+            FILE* file{ nullptr };
+            jpeg_decompress_struct cinfo{};
+            ErrorManager err;
+            bool cmykToRgb{ false };
+            bool inverted{ false };
+
+            DecompressContext()
+            {
+                cinfo.err = jpeg_std_error(&err.pub);
+                err.pub.error_exit = ErrorExit;
+                CreateDecompress(cinfo, err);
+            }
 
-        bool success{ false };
-        jpeg_decompress_struct cinfo{};
+            DecompressContext(const DecompressContext&) = delete;
+            DecompressContext& operator=(const DecompressContext&) = delete;
 
-        try 
+            ~DecompressContext()
+            {
+                jpeg_destroy_decompress(&cinfo);
+                if (file)
+                    fclose(file);
+            }
+        };
+
+        // Open file and libjpeg compression object, released in the destructor.
+        struct CompressContext
         {
-            jpeg_error_mgr jerr{};
-            cinfo.err = jpeg_std_error(&jerr);
-            jpeg_create_decompress(&cinfo);
-            jpeg_stdio_src(&cinfo, inFile);
-            jpeg_read_header(&cinfo, true);
-            jpeg_start_decompress(&cinfo);
+            FILE* file{ nullptr };
+            jpeg_compress_struct cinfo{};
+            ErrorManager err;
+
+            CompressContext()
+            {
+                cinfo.err = jpeg_std_error(&err.pub);
+                err.pub.error_exit = ErrorExit;
+                CreateCompress(cinfo, err);
+            }
+
+            CompressContext(const CompressContext&) = delete;
+            CompressContext& operator=(const CompressContext&) = delete;
+
+            ~CompressContext()
+            {
+                jpeg_destroy_compress(&cinfo);
+                if (file)
+                    fclose(file);
+            }
+        };
+
+        // Destination manager which encodes straight into a vector, grown by doubling.
+        struct VectorDestination
+        {
+            jpeg_destination_mgr pub{};
+            std::vector<std::byte>* output{ nullptr };
+            size_t initialSize{ 0 };
+        };
+
+        void InitDestination(j_compress_ptr cinfo)
+        {
+            auto* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+
+            // The handler has to end before the jump, otherwise the caught exception is never released.
+            bool failed = false;
+            try
+            {
+                dest->output->resize(dest->initialSize);
+            }
+            catch (const std::exception&)
+            {
+                failed = true;
+            }
+
+            if (failed)
+                ExitOutOfMemory(reinterpret_cast<j_common_ptr>(cinfo));
+
+            dest->pub.next_output_byte = reinterpret_cast<JOCTET*>(dest->output->data());
+            dest->pub.free_in_buffer = dest->output->size();
+        }
+
+        boolean EmptyOutputBuffer(j_compress_ptr cinfo)
+        {
+            auto* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+            const size_t used = dest->output->size();
+
+            // The handler has to end before the jump, otherwise the caught exception is never released.
+            bool failed = false;
+            try
+            {
+                dest->output->resize(2 * used);
+            }
+            catch (const std::exception&)
+            {
+                failed = true;
+            }
+
+            if (failed)
+                ExitOutOfMemory(reinterpret_cast<j_common_ptr>(cinfo));
+
+            dest->pub.next_output_byte = reinterpret_cast<JOCTET*>(dest->output->data() + used);
+            dest->pub.free_in_buffer = dest->output->size() - used;
+            return TRUE;
+        }
+
+        void TermDestination(j_compress_ptr cinfo)
+        {
+            auto* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+            dest->output->resize(dest->output->size() - dest->pub.free_in_buffer);
+        }
+
+        // The destination has to outlive the compression.
+        void SetVectorDestination(j_compress_ptr cinfo, VectorDestination& dest, std::vector<std::byte>& output, size_t initialSize)
+        {
+            dest.output = &output;
+            dest.initialSize = std::max(initialSize, size_t{ 4096 });
+            dest.pub.init_destination = InitDestination;
+            dest.pub.empty_output_buffer = EmptyOutputBuffer;
+            dest.pub.term_destination = TermDestination;
+            cinfo->dest = &dest.pub;
+        }
+
+        // libjpeg calls which may fail, each one turns a jump of the error manager into an exception.
+
+        void ReadHeader(DecompressContext& ctx)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_read_header(&ctx.cinfo, TRUE);
+        }
+
+        void StartDecompress(DecompressContext& ctx)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_start_decompress(&ctx.cinfo);
+        }
+
+        JDIMENSION ReadScanlines(DecompressContext& ctx, JSAMPARRAY rows, JDIMENSION numRows)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            return jpeg_read_scanlines(&ctx.cinfo, rows, numRows);
+        }
+
+        void FinishDecompress(DecompressContext& ctx)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_finish_decompress(&ctx.cinfo);
+        }
+
+        J_DCT_METHOD Convert(DctMethod method) noexcept
+        {
+            switch (method)
+            {
+            case DctMethod::Fast:
+                return JDCT_IFAST;
+            case DctMethod::Float:
+                return JDCT_FLOAT;
+            default:
+                return JDCT_ISLOW;
+            }
+        }
+
+        void StartCompress(CompressContext& ctx, int quality, const WriteSettings& settings)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_set_defaults(&ctx.cinfo);
+            jpeg_set_quality(&ctx.cinfo, quality, TRUE);
+            ctx.cinfo.dct_method = Convert(settings.dct_method);
+            ctx.cinfo.optimize_coding = settings.optimize_coding ? TRUE : FALSE;
+            if (settings.progressive)
+                jpeg_simple_progression(&ctx.cinfo);
+
+            jpeg_start_compress(&ctx.cinfo, TRUE);
+        }
+
+        // The components are stored in the color space they are given in, with the given horizontal and vertical sampling factors.
+        void StartRawCompress(CompressContext& ctx, int quality, const std::vector<std::pair<int, int>>& samplingFactors)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_set_defaults(&ctx.cinfo);
+            jpeg_set_colorspace(&ctx.cinfo, ctx.cinfo.in_color_space);
+            jpeg_set_quality(&ctx.cinfo, quality, TRUE);
+
+            for (size_t i = 0; i < samplingFactors.size(); i++)
+            {
+                ctx.cinfo.comp_info[i].h_samp_factor = samplingFactors[i].first;
+                ctx.cinfo.comp_info[i].v_samp_factor = samplingFactors[i].second;
+            }
+
+            ctx.cinfo.raw_data_in = TRUE;
+            jpeg_start_compress(&ctx.cinfo, TRUE);
+        }
+
+        void WriteRawData(CompressContext& ctx, JSAMPIMAGE data, JDIMENSION numRows)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_write_raw_data(&ctx.cinfo, data, numRows);
+        }
+
+        void ReadRawData(DecompressContext& ctx, JSAMPIMAGE data, JDIMENSION numRows)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_read_raw_data(&ctx.cinfo, data, numRows);
+        }
+
+        void WriteScanlines(CompressContext& ctx, JSAMPARRAY rows, JDIMENSION numRows)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            // The destinations never suspend, all rows are taken.
+            jpeg_write_scanlines(&ctx.cinfo, rows, numRows);
+        }
+
+        void FinishCompress(CompressContext& ctx)
+        {
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_finish_compress(&ctx.cinfo);
+        }
+
+        void SetImageInfo(CompressContext& ctx, const ImageLayout& layout)
+        {
+            ctx.cinfo.image_height = static_cast<JDIMENSION>(layout.height);
+            ctx.cinfo.image_width = static_cast<JDIMENSION>(layout.width);
+            ctx.cinfo.input_components = static_cast<int>(layout.num_channels);
+            ctx.cinfo.in_color_space = Convert(layout.color_space);
+        }
+
+        // A quarter of the raw size covers most photographs at the usual qualities without growing.
+        size_t GetOutputReserve(const ImageLayout& layout) noexcept
+        {
+            return layout.height * layout.width * layout.num_channels / 4;
+        }
+
+        // Rows decoded or encoded per batch. jpeg_read_scanlines returns at most max_v_samp_factor rows per call, it is
+        // called until the batch is full, jpeg_write_scanlines takes any number.
+        constexpr JDIMENSION batchRows{ 16 };
+
+        // Image info and destination are set, the rest of the compression is the same for files and memory. The channels
+        // are interleaved a batch of rows at a time into a buffer that is reused.
+        void Compress(CompressContext& ctx, int quality, const Image<data_type>& img, const WriteSettings& settings)
+        {
+            StartCompress(ctx, quality, settings);
+
+            const size_t width = img.width();
+            const size_t numChannels = img.num_channels();
+            std::vector<data_type> buffer(batchRows * width * numChannels);
+            JSAMPROW rows[batchRows];
+            for (size_t i = 0; i < batchRows; i++)
+                rows[i] = buffer.data() + i * width * numChannels;
+
+            std::vector<data_type const*> planes(numChannels);
+            while (ctx.cinfo.next_scanline < ctx.cinfo.image_height)
+            {
+                const size_t first = ctx.cinfo.next_scanline;
+                const auto numRows = static_cast<JDIMENSION>(std::min<size_t>(batchRows, img.height() - first));
+                for (size_t i = 0; i < numRows; i++)
+                {
+                    for (size_t t = 0; t < numChannels; t++)
+                        planes[t] = img(t).data() + (first + i) * width;
+
+                    interleave_row(planes.data(), numChannels, rows[i], width);
+                }
+
+                WriteScanlines(ctx, rows, numRows);
+            }
+
+            FinishCompress(ctx);
+        }
+
+        // Interleaved rows are handed to libjpeg in place, it does not write to its input.
+        void Compress(CompressContext& ctx, int quality, data_type const* data, const WriteSettings& settings)
+        {
+            StartCompress(ctx, quality, settings);
+
+            const size_t rowStride = size_t{ ctx.cinfo.image_width } * ctx.cinfo.input_components;
+            JSAMPROW rows[batchRows];
+            while (ctx.cinfo.next_scanline < ctx.cinfo.image_height)
+            {
+                const size_t first = ctx.cinfo.next_scanline;
+                const auto numRows = std::min<JDIMENSION>(batchRows, ctx.cinfo.image_height - ctx.cinfo.next_scanline);
+                for (size_t i = 0; i < numRows; i++)
+                    rows[i] = const_cast<data_type*>(data + (first + i) * rowStride);
+
+                WriteScanlines(ctx, rows, numRows);
+            }
+
+            FinishCompress(ctx);
+        }
+
+        void CheckInterleaved(data_type const* data, const ImageLayout& layout)
+        {
+            if (data == nullptr || layout.height == 0 || layout.width == 0)
+                throw std::invalid_argument("Image is empty.");
+        }
+
+        // Part of a shrink factor done by libjpeg while decoding.
+        unsigned int DctDenominator(size_t shrink) noexcept
+        {
+            for (unsigned int denom : { 8u, 4u, 2u })
+            {
+                if (shrink % denom == 0)
+                    return denom;
+            }
 
-            auto rowStride = cinfo.output_width * cinfo.output_components;   
-            data_type** buffer = (*cinfo.mem->alloc_sarray) ((j_common_ptr)&cinfo, JPOOL_IMAGE, rowStride, 1);
+            return 1;
+        }
+
+        // The source is set, reads the header and starts the decompression. The rest of it is the same for files and memory.
+        // The layout is the one of the result, the decoded image is larger if the shrink factor is not only done by libjpeg.
+        ImageLayout StartRead(DecompressContext& ctx, const ReadSettings& settings)
+        {
+            auto& cinfo = ctx.cinfo;
+            ReadHeader(ctx);
 
-            auto img = Image<data_type>(cinfo.output_height, cinfo.output_width, Convert(cinfo.out_color_space), cinfo.output_components);
-            
-            size_t rowNo{ 0 };
-            while (cinfo.output_scanline < cinfo.output_height)
+            if (settings.shrink == 0 || settings.shrink > cinfo.image_height || settings.shrink > cinfo.image_width)
+                throw std::invalid_argument("Invalid shrink factor.");
+
+            cinfo.scale_num = 1;
+            cinfo.scale_denom = DctDenominator(settings.shrink);
+
+            // YCCK is decoded as it is stored, its conversion to RGB is done in the same pass as the one of the K channel.
+            ctx.cmykToRgb = settings.components == Components::Converted && settings.cmyk_to_rgb &&
+                (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK);
+
+            if (ctx.cmykToRgb || settings.components == Components::Stored)
+                cinfo.out_color_space = cinfo.jpeg_color_space;
+
+            // With grayscale output libjpeg skips the inverse DCT and the upsampling of the chroma components.
+            if (settings.components == Components::Luma)
             {
-                jpeg_read_scanlines(&cinfo, buffer, 1);
+                if (cinfo.jpeg_color_space != JCS_YCbCr && cinfo.jpeg_color_space != JCS_GRAYSCALE)
+                    throw std::runtime_error("Image has no luma component.");
+
+                cinfo.out_color_space = JCS_GRAYSCALE;
+            }
+
+            ctx.inverted = cinfo.saw_Adobe_marker;
+
+            StartDecompress(ctx);
+
+            // libjpeg rounds the scaled size up, Shrink drops partial blocks.
+            const size_t height = cinfo.image_height / settings.shrink;
+            const size_t width = cinfo.image_width / settings.shrink;
+
+            if (ctx.cmykToRgb)
+                return ImageLayout{ height, width, ColorSpace::RGB, 3, BITS_IN_JSAMPLE };
+
+            return ImageLayout{ height, width, Convert(cinfo.out_color_space), static_cast<size_t>(cinfo.output_components), BITS_IN_JSAMPLE };
+        }
+
+        void ConvertCmykRow(const DecompressContext& ctx, data_type const* in, data_type* r, data_type* g, data_type* b, size_t outStep, size_t count)
+        {
+            if (ctx.cinfo.out_color_space == JCS_YCCK)
+                imglib::detail::ycck_to_rgb_kernel(in, in + 1, in + 2, in + 3, 4, r, g, b, outStep, count, ctx.inverted);
+            else
+                imglib::detail::cmyk_to_rgb_kernel(in, in + 1, in + 2, in + 3, 4, r, g, b, outStep, count, ctx.inverted);
+        }
+
+        // Decodes the remaining rows in batches into a small buffer and calls process(row, rowIndex) for each row of a
+        // batch while it is still in the cache. Only the last batch may be shorter than batchRows.
+        template <typename Func>
+        void ReadBatches(DecompressContext& ctx, Func&& process)
+        {
+            const size_t rowStride = static_cast<size_t>(ctx.cinfo.output_width) * ctx.cinfo.output_components;
+            std::vector<data_type> buffer(batchRows * rowStride);
+            JSAMPROW rows[batchRows];
+            for (size_t i = 0; i < batchRows; i++)
+                rows[i] = buffer.data() + i * rowStride;
+
+            while (ctx.cinfo.output_scanline < ctx.cinfo.output_height)
+            {
+                const size_t first = ctx.cinfo.output_scanline;
+                JDIMENSION numRows = 0;
+                while (numRows < batchRows && ctx.cinfo.output_scanline < ctx.cinfo.output_height)
+                    numRows += ReadScanlines(ctx, rows + numRows, batchRows - numRows);
+
+                for (size_t i = 0; i < numRows; i++)
+                    process(rows[i], first + i);
+            }
+        }
+
+        Image<data_type> ReadPlanar(DecompressContext& ctx, const ReadSettings& settings)
+        {
+            const ImageLayout layout = StartRead(ctx, settings);
+
+            // Rows and columns beyond whole blocks of the remaining factor are decoded and dropped.
+            const size_t remaining = settings.shrink / ctx.cinfo.scale_denom;
+            const size_t height = layout.height * remaining;
+            const size_t width = layout.width * remaining;
+
+            Image<data_type> img(height, width, layout.color_space, layout.num_channels);
+            std::vector<data_type*> planes(layout.num_channels);
 
-                for (auto i = 0; i < cinfo.out_color_components; i++) 
+            ReadBatches(ctx, [&](data_type const* row, size_t i)
                 {
-                    size_t pixel{ cinfo.output_width * rowNo };
-                    for (unsigned int j = i; j < rowStride; j += cinfo.out_color_components)
-                        img(i)(pixel++) = buffer[0][j];
-                }                  
-                rowNo++;
+                    if (i >= height)
+                        return;
+
+                    for (size_t k = 0; k < layout.num_channels; k++)
+                        planes[k] = &img(k)(i, 0);
+
+                    if (ctx.cmykToRgb)
+                        ConvertCmykRow(ctx, row, planes[0], planes[1], planes[2], 1, width);
+                    else
+                        deinterleave_row(row, layout.num_channels, planes.data(), width);
+                });
+
+            FinishDecompress(ctx);
+
+            if (remaining > 1)
+                return algorithm::Shrink(img, remaining);
+
+            return img;
+        }
+
+        void ReadInterleaved(DecompressContext& ctx, const ReadSettings& settings, const std::function<data_type*(const ImageLayout&)>& allocate)
+        {
+            // Shrunk images are small, they are interleaved after decoding.
+            if (settings.shrink != 1)
+            {
+                Image<data_type> img = ReadPlanar(ctx, settings);
+                data_type* data = allocate(detail::GetLayout(img));
+                std::vector<data_type const*> planes(img.num_channels());
+
+                for (size_t i = 0; i < img.height(); i++)
+                {
+                    for (size_t k = 0; k < img.num_channels(); k++)
+                        planes[k] = &img(k)(i, 0);
+
+                    interleave_row(planes.data(), img.num_channels(), data + i * img.width() * img.num_channels(), img.width());
+                }
+
+                return;
+            }
+
+            const ImageLayout layout = StartRead(ctx, settings);
+            data_type* data = allocate(layout);
+            const size_t rowStride = layout.width * layout.num_channels;
+
+            if (ctx.cmykToRgb)
+            {
+                ReadBatches(ctx, [&](data_type const* row, size_t i)
+                    {
+                        data_type* out = data + i * rowStride;
+                        ConvertCmykRow(ctx, row, out, out + 1, out + 2, 3, layout.width);
+                    });
+            }
+            else
+            {
+                // Decoded in place, libjpeg fills as many of the rows as it has at once.
+                std::vector<JSAMPROW> rows(layout.height);
+                for (size_t i = 0; i < layout.height; i++)
+                    rows[i] = data + i * rowStride;
+
+                while (ctx.cinfo.output_scanline < ctx.cinfo.output_height)
+                    ReadScanlines(ctx, rows.data() + ctx.cinfo.output_scanline, ctx.cinfo.output_height - ctx.cinfo.output_scanline);
             }
 
-            jpeg_finish_decompress(&cinfo);
-            
-            fclose(inFile);
-            inFile = nullptr;
+            FinishDecompress(ctx);
+        }
+
+        // Each call of jpeg_read_raw_data returns one row of MCUs, v_samp_factor * DCTSIZE rows of every component padded
+        // to whole blocks. The rows inside the image are copied into the components.
+        RawImage ReadRaw(DecompressContext& ctx)
+        {
+            auto& cinfo = ctx.cinfo;
+            ReadHeader(ctx);
 
-            jpeg_destroy_decompress(&cinfo);
-            success = true;
+            cinfo.raw_data_out = TRUE;
+            cinfo.out_color_space = cinfo.jpeg_color_space;
+            StartDecompress(ctx);
+
+            const size_t numComponents = cinfo.num_components;
+            RawImage img{ Convert(cinfo.jpeg_color_space), {} };
+            std::vector<std::vector<data_type>> buffers(numComponents);
+            std::vector<std::vector<JSAMPROW>> rows(numComponents);
+            std::vector<JSAMPARRAY> planes(numComponents);
+
+            for (size_t c = 0; c < numComponents; c++)
+            {
+                const auto& comp = cinfo.comp_info[c];
+                img.components.emplace_back(comp.downsampled_height, comp.downsampled_width);
+
+                const size_t stride = comp.width_in_blocks * DCTSIZE;
+                buffers[c].resize(comp.v_samp_factor * DCTSIZE * stride);
+                for (size_t i = 0; i < static_cast<size_t>(comp.v_samp_factor * DCTSIZE); i++)
+                    rows[c].push_back(buffers[c].data() + i * stride);
+
+                planes[c] = rows[c].data();
+            }
+
+            for (size_t mcuRow = 0; cinfo.output_scanline < cinfo.output_height; mcuRow++)
+            {
+                ReadRawData(ctx, planes.data(), cinfo.max_v_samp_factor * DCTSIZE);
 
+                for (size_t c = 0; c < numComponents; c++)
+                {
+                    auto& component = img.components[c];
+                    const size_t rowsPerMcu = rows[c].size();
+                    const size_t first = mcuRow * rowsPerMcu;
+                    for (size_t i = first; i < std::min(first + rowsPerMcu, component.num_rows()); i++)
+                        std::copy_n(rows[c][i - first], component.num_columns(), &component(i, 0));
+                }
+            }
+
+            FinishDecompress(ctx);
             return img;
         }
-        catch (...) 
+
+        // Subsampling of a component relative to the full size.
+        int GetSubsamplingFactor(size_t fullSize, size_t size)
+        {
+            for (int factor : { 1, 2, 4 })
+            {
+                if ((fullSize + factor - 1) / factor == size)
+                    return factor;
+            }
+
+            throw std::invalid_argument("Component size does not match a subsampling factor.");
+        }
+
+        // The destination is set. Rows and columns past the components are filled with copies of the last ones, the
+        // padding libjpeg expects up to whole blocks and MCU rows.
+        void CompressRaw(CompressContext& ctx, int quality, const RawImage& img)
         {
-            if (!success)
+            const size_t numComponents = img.components.size();
+            if (numComponents == 0 || !IsValid(img.color_space, numComponents) || img.components[0].size() == 0)
+                throw std::invalid_argument("Invalid raw image.");
+
+            auto& cinfo = ctx.cinfo;
+            cinfo.image_height = static_cast<JDIMENSION>(img.components[0].num_rows());
+            cinfo.image_width = static_cast<JDIMENSION>(img.components[0].num_columns());
+            cinfo.input_components = static_cast<int>(numComponents);
+            cinfo.in_color_space = Convert(img.color_space);
+
+            // A component subsampled by f has the sampling factor max f / f.
+            std::vector<std::pair<int, int>> factors(numComponents);
+            int maxHorizontal{ 1 };
+            int maxVertical{ 1 };
+            for (size_t c = 0; c < numComponents; c++)
+            {
+                factors[c] = { GetSubsamplingFactor(cinfo.image_width, img.components[c].num_columns()), GetSubsamplingFactor(cinfo.image_height, img.components[c].num_rows()) };
+                maxHorizontal = std::max(maxHorizontal, factors[c].first);
+                maxVertical = std::max(maxVertical, factors[c].second);
+            }
+
+            for (auto& [horizontal, vertical] : factors)
+            {
+                horizontal = maxHorizontal / horizontal;
+                vertical = maxVertical / vertical;
+            }
+
+            StartRawCompress(ctx, quality, factors);
+
+            std::vector<std::vector<data_type>> buffers(numComponents);
+            std::vector<std::vector<JSAMPROW>> rows(numComponents);
+            std::vector<JSAMPARRAY> planes(numComponents);
+            for (size_t c = 0; c < numComponents; c++)
+            {
+                const auto& comp = cinfo.comp_info[c];
+                const size_t stride = comp.width_in_blocks * DCTSIZE;
+                buffers[c].resize(comp.v_samp_factor * DCTSIZE * stride);
+                for (size_t i = 0; i < static_cast<size_t>(comp.v_samp_factor * DCTSIZE); i++)
+                    rows[c].push_back(buffers[c].data() + i * stride);
+
+                planes[c] = rows[c].data();
+            }
+
+            for (size_t mcuRow = 0; cinfo.next_scanline < cinfo.image_height; mcuRow++)
             {
-                if (inFile)
-                    fclose(inFile);
+                for (size_t c = 0; c < numComponents; c++)
+                {
+                    const auto& component = img.components[c];
+                    const size_t width = component.num_columns();
+                    const size_t stride = cinfo.comp_info[c].width_in_blocks * DCTSIZE;
+                    for (size_t i = 0; i < rows[c].size(); i++)
+                    {
+                        data_type const* src = component.data() + std::min(mcuRow * rows[c].size() + i, component.num_rows() - 1) * width;
+                        std::copy_n(src, width, rows[c][i]);
+                        std::fill(rows[c][i] + width, rows[c][i] + stride, src[width - 1]);
+                    }
+                }
 
-                jpeg_finish_decompress(&cinfo);
+                WriteRawData(ctx, planes.data(), cinfo.max_v_samp_factor * DCTSIZE);
             }
 
-            throw std::runtime_error("Something went wrong while reading the image from a jpeg file.");
+            FinishCompress(ctx);
+        }
+
+        void SetFileDestination(CompressContext& ctx, std::wstring_view fileName)
+        {
+            // Open the file for writing the jpeg image.
+            ctx.file = OpenFile(fileName, Mode::Write);
+
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_stdio_dest(&ctx.cinfo, ctx.file);
+        }
+
+        // Errors while flushing the file are only reported by fclose.
+        void CloseFile(CompressContext& ctx)
+        {
+            if (fclose(std::exchange(ctx.file, nullptr)) != 0)
+                throw std::runtime_error("File cannot be written.");
         }
+
+        // The data is read in place, it has to outlive the context.
+        void SetMemorySource(DecompressContext& ctx, std::span<const std::byte> data)
+        {
+            if (data.empty())
+                throw std::runtime_error("Data is not a jpeg file.");
+
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            // Older libjpeg versions take a non-const pointer without writing through it.
+            jpeg_mem_src(&ctx.cinfo, const_cast<unsigned char*>(reinterpret_cast<unsigned char const*>(data.data())), static_cast<unsigned long>(data.size()));
+        }
+
+        void SetFileSource(DecompressContext& ctx, std::wstring_view fileName)
+        {
+            // Open the jpeg file for reading.
+            ctx.file = OpenFile(fileName, Mode::Read);
+
+            if (setjmp(ctx.err.jump))
+                throw std::runtime_error(ctx.err.message);
+
+            jpeg_stdio_src(&ctx.cinfo, ctx.file);
+        }
+    }
+
+    namespace detail
+    {
+        void ReadInterleaved(std::wstring_view fileName, const ReadSettings& settings, const std::function<data_type*(const ImageLayout&)>& allocate)
+        {
+            DecompressContext ctx;
+            SetFileSource(ctx, fileName);
+            ReadInterleaved(ctx, settings, allocate);
+        }
+
+        void ReadInterleaved(std::span<const std::byte> data, const ReadSettings& settings, const std::function<data_type*(const ImageLayout&)>& allocate)
+        {
+            DecompressContext ctx;
+            SetMemorySource(ctx, data);
+            ReadInterleaved(ctx, settings, allocate);
+        }
+
+        void WriteInterleaved(std::wstring_view fileName, int quality, data_type const* data, const ImageLayout& layout, const WriteSettings& settings)
+        {
+            CheckInterleaved(data, layout);
+
+            CompressContext ctx;
+            SetImageInfo(ctx, layout);
+            SetFileDestination(ctx, fileName);
+            Compress(ctx, quality, data, settings);
+            CloseFile(ctx);
+        }
+
+        std::vector<std::byte> WriteInterleaved(int quality, data_type const* data, const ImageLayout& layout, const WriteSettings& settings)
+        {
+            CheckInterleaved(data, layout);
+
+            std::vector<std::byte> output;
+            CompressContext ctx;
+            SetImageInfo(ctx, layout);
+
+            VectorDestination dest;
+            SetVectorDestination(&ctx.cinfo, dest, output, GetOutputReserve(layout));
+
+            Compress(ctx, quality, data, settings);
+            return output;
+        }
+    }
+
+    void Write(std::wstring_view fileName, int quality, const Image<data_type>& img, const WriteSettings& settings)
+    {
+        CompressContext ctx;
+        SetImageInfo(ctx, detail::GetLayout(img));
+        SetFileDestination(ctx, fileName);
+        Compress(ctx, quality, img, settings);
+        CloseFile(ctx);
+    }
+
+    std::vector<std::byte> Write(int quality, const Image<data_type>& img, const WriteSettings& settings)
+    {
+        std::vector<std::byte> output;
+        CompressContext ctx;
+        SetImageInfo(ctx, detail::GetLayout(img));
+
+        VectorDestination dest;
+        SetVectorDestination(&ctx.cinfo, dest, output, GetOutputReserve(detail::GetLayout(img)));
+
+        Compress(ctx, quality, img, settings);
+        return output;
+    }
+
+    RawImage ReadRaw(std::wstring_view fileName)
+    {
+        DecompressContext ctx;
+        SetFileSource(ctx, fileName);
+        return ReadRaw(ctx);
+    }
+
+    RawImage ReadRaw(std::span<const std::byte> data)
+    {
+        DecompressContext ctx;
+        SetMemorySource(ctx, data);
+        return ReadRaw(ctx);
+    }
+
+    void WriteRaw(std::wstring_view fileName, int quality, const RawImage& img)
+    {
+        CompressContext ctx;
+        SetFileDestination(ctx, fileName);
+        CompressRaw(ctx, quality, img);
+        CloseFile(ctx);
+    }
+
+    std::vector<std::byte> WriteRaw(int quality, const RawImage& img)
+    {
+        std::vector<std::byte> output;
+        CompressContext ctx;
+
+        size_t rawSize{ 0 };
+        for (const auto& component : img.components)
+            rawSize += component.size();
+
+        VectorDestination dest;
+        SetVectorDestination(&ctx.cinfo, dest, output, rawSize / 4);
+
+        CompressRaw(ctx, quality, img);
+        return output;
+    }
+
+    ImageLayout Probe(std::wstring_view fileName, const ReadSettings& settings)
+    {
+        std::unique_ptr<FILE, int(*)(FILE*)> file{ OpenFile(fileName, Mode::Read), fclose };
+        imglib::detail::ByteReader reader{ file.get() };
+        return ProbeLayout(reader, settings);
+    }
+
+    ImageLayout Probe(std::span<const std::byte> data, const ReadSettings& settings)
+    {
+        imglib::detail::ByteReader reader{ data };
+        return ProbeLayout(reader, settings);
+    }
+
+    Image<data_type> Read(std::wstring_view fileName, const ReadSettings& settings)
+    {
+        DecompressContext ctx;
+        SetFileSource(ctx, fileName);
+        return ReadPlanar(ctx, settings);
+    }
+
+    Image<data_type> Read(std::span<const std::byte> data, const ReadSettings& settings)
+    {
+        DecompressContext ctx;
+        SetMemorySource(ctx, data);
+        return ReadPlanar(ctx, settings);
     }
 }
@@ -1,16 +1,23 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdio>
 #include <iostream>
 #include <new>
 #include <memory>
 #include <string>
 #include <cstdlib>
+#include <functional>
+#include <span>
 #include <string_view>
+#include <vector>
 
 #include <jpeglib.h>
 
 #include <imglib/image/image.hpp>
+#include <imglib/image/cimage.hpp>
+#include <imglib/image/pimage.hpp>
+#include <imglib/image/image_layout.hpp>
 #include <imglib/color/color.hpp>
 
 namespace imglib::jpeg
@@ -18,9 +25,209 @@ namespace imglib::jpeg
     using data_type = JSAMPLE;
     using JpegImg = Image<jpeg::data_type>;
 
+    // Forward DCT of the encoder, in decreasing order of accuracy: Float and Integer give nearly the same files, Fast
+    // is quicker but loses precision at qualities above about 90.
+    enum class DctMethod
+    {
+        Integer,    // JDCT_ISLOW
+        Fast,       // JDCT_IFAST
+        Float       // JDCT_FLOAT
+    };
+
+    struct WriteSettings
+    {
+        DctMethod dct_method{ DctMethod::Integer };
+
+        // Huffman tables computed for the image instead of the standard ones, a few percent smaller files for an extra
+        // pass over the coefficients.
+        bool optimize_coding{ false };
+
+        // Progressive scans, usually smaller than baseline and always with optimized tables. The coefficients of the
+        // whole image are held in memory until the end.
+        bool progressive{ false };
+    };
+
     // Saves the given image to a jpeg file
-    void Write(std::wstring_view fileName, int quality, const Image<data_type>& img);
+    void Write(std::wstring_view fileName, int quality, const Image<data_type>& img, const WriteSettings& settings = WriteSettings{});
+
+    // Encodes the given image into memory, the result is the content the file would have
+    std::vector<std::byte> Write(int quality, const Image<data_type>& img, const WriteSettings& settings = WriteSettings{});
     
+    // Components an image is decoded into
+    enum class Components
+    {
+        Converted,  // RGB, grayscale or CMYK
+        Stored,     // as stored in the file, for example YCbCr, upsampled to full size but not color converted
+        Luma        // only the luma of YCbCr or grayscale files, the inverse DCT and upsampling of chroma are skipped
+    };
+
+    struct ReadSettings
+    {
+        // CMYK and YCCK files are converted to RGB row by row while decoding. Files with an Adobe marker are taken to store
+        // inverted CMYK, as the ones written by Adobe applications do.
+        bool cmyk_to_rgb{ false };
+
+        // Reduces the image by an integer factor while decoding, the result has the size of Shrink(Read(file), shrink).
+        // Factors with 2, 4 or 8 in them are decoded at that reduced scale in the DCT domain, which is several times
+        // faster, and the rest of the factor is done with Shrink. Grayscale images and luma then differ from Shrink of the
+        // full decode by at most 1. Subsampled chroma is upsampled differently: color samples differ by less than 1 on
+        // average on photographs and by up to 3 on saturated graphics, where single samples at color edges can be off by 64.
+        size_t shrink{ 1 };
+
+        // cmyk_to_rgb only applies to converted components.
+        Components components{ Components::Converted };
+    };
+
+    // Reads only the markers up to the frame header, the result is the layout Read decodes the file into with the same
+    // settings. The image data is not checked.
+    ImageLayout Probe(std::wstring_view fileName, const ReadSettings& settings = ReadSettings{});
+
+    ImageLayout Probe(std::span<const std::byte> data, const ReadSettings& settings = ReadSettings{});
+
     // Reads the given jpeg file
-    Image<data_type> Read(std::wstring_view fileName);
-}
\ No newline at end of file
+    Image<data_type> Read(std::wstring_view fileName, const ReadSettings& settings = ReadSettings{});
+
+    // Reads a jpeg file held in memory, the data is read in place
+    Image<data_type> Read(std::span<const std::byte> data, const ReadSettings& settings = ReadSettings{});
+
+    // Components of a jpeg file as stored in it, YCbCr, GrayScale, RGB, CMYK or YCCK, each at its own resolution. The first
+    // component has the size of the image, subsampled ones are smaller: 2 x 2 subsampled chroma has half the rows and
+    // columns of luma, rounded up.
+    struct RawImage
+    {
+        ColorSpace color_space{ ColorSpace::Unspecified };
+        std::vector<Channel<data_type>> components;
+    };
+
+    // Reads the components with jpeg_read_raw_data, without upsampling and color conversion
+    RawImage ReadRaw(std::wstring_view fileName);
+
+    RawImage ReadRaw(std::span<const std::byte> data);
+
+    // Encodes the components with jpeg_write_raw_data as they are. The sampling factors follow from the sizes of the
+    // components, which may be 1, 2 or 4 times smaller than the first one in each direction.
+    void WriteRaw(std::wstring_view fileName, int quality, const RawImage& img);
+
+    std::vector<std::byte> WriteRaw(int quality, const RawImage& img);
+
+    namespace detail
+    {
+        // Decodes into interleaved rows. allocate is called once the layout is known and returns the first row of the
+        // destination, the rows follow each other without padding.
+        void ReadInterleaved(std::wstring_view fileName, const ReadSettings& settings, const std::function<data_type*(const ImageLayout&)>& allocate);
+
+        void ReadInterleaved(std::span<const std::byte> data, const ReadSettings& settings, const std::function<data_type*(const ImageLayout&)>& allocate);
+
+        // Encodes interleaved rows that follow each other without padding, they are handed to libjpeg as they are.
+        void WriteInterleaved(std::wstring_view fileName, int quality, data_type const* data, const ImageLayout& layout, const WriteSettings& settings);
+
+        std::vector<std::byte> WriteInterleaved(int quality, data_type const* data, const ImageLayout& layout, const WriteSettings& settings);
+
+        // Layout of an image as libjpeg encodes it, every image type is written with BITS_IN_JSAMPLE bits per sample.
+        inline ImageLayout GetLayout(const Image<data_type>& img) noexcept
+        {
+            return ImageLayout{ img.height(), img.width(), img.color_space(), img.num_channels(), BITS_IN_JSAMPLE };
+        }
+
+        template <size_t NumChannels>
+        ImageLayout GetLayout(const CImage<data_type, NumChannels>& img) noexcept
+        {
+            return ImageLayout{ img.height(), img.width(), img.color_space(), NumChannels, BITS_IN_JSAMPLE };
+        }
+
+        template <size_t NumChannels>
+        ImageLayout GetLayout(const PImage<data_type, NumChannels>& img) noexcept
+        {
+            return ImageLayout{ img.height(), img.width(), img.color_space(), NumChannels, BITS_IN_JSAMPLE };
+        }
+
+        // First sample of an interleaved image, null for an empty one.
+        template <size_t NumChannels>
+        data_type const* GetSamples(const PImage<data_type, NumChannels>& img) noexcept
+        {
+            static_assert(sizeof(Pixel<data_type, NumChannels>) == NumChannels * sizeof(data_type), "Pixels are expected to be tightly packed.");
+            return img.size() == 0 ? nullptr : &img(0).p[0];
+        }
+
+        template <size_t NumChannels>
+        void CheckLayout(const ImageLayout& layout)
+        {
+            if (layout.num_channels != NumChannels)
+                throw std::runtime_error("Image type does not match the file.");
+        }
+
+        template <size_t NumChannels>
+        auto Allocator(CImage<data_type, NumChannels>& img)
+        {
+            return [&img](const ImageLayout& layout)
+                {
+                    CheckLayout<NumChannels>(layout);
+                    img = CImage<data_type, NumChannels>{ layout.height, layout.width, layout.color_space };
+                    return &img(0, 0);
+                };
+        }
+
+        template <size_t NumChannels>
+        auto Allocator(PImage<data_type, NumChannels>& img)
+        {
+            static_assert(sizeof(Pixel<data_type, NumChannels>) == NumChannels * sizeof(data_type), "Pixels are expected to be tightly packed.");
+
+            return [&img](const ImageLayout& layout)
+                {
+                    CheckLayout<NumChannels>(layout);
+                    img = PImage<data_type, NumChannels>{ layout.height, layout.width, layout.color_space };
+                    return &img(0).p[0];
+                };
+        }
+    }
+
+    // Decodes straight into the storage of an interleaved image, NumChannels has to match the decoded number of channels.
+    template <size_t NumChannels>
+    void Read(std::wstring_view fileName, CImage<data_type, NumChannels>& img, const ReadSettings& settings = ReadSettings{})
+    {
+        detail::ReadInterleaved(fileName, settings, detail::Allocator(img));
+    }
+
+    template <size_t NumChannels>
+    void Read(std::wstring_view fileName, PImage<data_type, NumChannels>& img, const ReadSettings& settings = ReadSettings{})
+    {
+        detail::ReadInterleaved(fileName, settings, detail::Allocator(img));
+    }
+
+    template <size_t NumChannels>
+    void Read(std::span<const std::byte> data, CImage<data_type, NumChannels>& img, const ReadSettings& settings = ReadSettings{})
+    {
+        detail::ReadInterleaved(data, settings, detail::Allocator(img));
+    }
+
+    template <size_t NumChannels>
+    void Read(std::span<const std::byte> data, PImage<data_type, NumChannels>& img, const ReadSettings& settings = ReadSettings{})
+    {
+        detail::ReadInterleaved(data, settings, detail::Allocator(img));
+    }
+
+    // Encodes straight from the storage of an interleaved image, without copying it.
+    template <size_t NumChannels>
+    void Write(std::wstring_view fileName, int quality, const CImage<data_type, NumChannels>& img, const WriteSettings& settings = WriteSettings{})
+    {
+        detail::WriteInterleaved(fileName, quality, img.data(), detail::GetLayout(img), settings);
+    }
+
+    template <size_t NumChannels>
+    void Write(std::wstring_view fileName, int quality, const PImage<data_type, NumChannels>& img, const WriteSettings& settings = WriteSettings{})
+    {
+        detail::WriteInterleaved(fileName, quality, detail::GetSamples(img), detail::GetLayout(img), settings);
+    }
+
+    template <size_t NumChannels>
+    std::vector<std::byte> Write(int quality, const CImage<data_type, NumChannels>& img, const WriteSettings& settings = WriteSettings{})
+    {
+        return detail::WriteInterleaved(quality, img.data(), detail::GetLayout(img), settings);
+    }
+
+    template <size_t NumChannels>
+    std::vector<std::byte> Write(int quality, const PImage<data_type, NumChannels>& img, const WriteSettings& settings = WriteSettings{})
+    {
+        return detail::WriteInterleaved(quality, detail::GetSamples(img), detail::GetLayout(img), settings);
+    }
+}
@@ -1,7 +1,21 @@
 
 #include <imglib/adaptors/png_adaptor.hpp>
+#include <imglib/utility/byte_reader.hpp>
+#include <imglib/utility/interleave.hpp>
+#include <imglib/utility/parallel.hpp>
 #include <imglib/utility/utility.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
 namespace imglib::png
 {
 	namespace 
@@ -16,42 +30,6 @@ namespace imglib::png
 			return png_sig_cmp(buf.get(), 0, numBytesToRead) == 0;
 		}
 
-		void CloseRead(FILE* pFile, png_struct* pReadStruct = nullptr, png_info* pInfoStruct = nullptr, png_byte** ppRowPointers = nullptr, size_t numRows = 0)
-		{
-			if (pFile)
-				fclose(pFile);
-
-			if (pReadStruct && pInfoStruct)
-				png_destroy_read_struct(&pReadStruct, &pInfoStruct, nullptr);
-			else if (pReadStruct)
-				png_destroy_read_struct(&pReadStruct, nullptr, nullptr);
-			else if (pInfoStruct)
-				png_destroy_read_struct(nullptr, &pInfoStruct, nullptr);			
-
-			if (ppRowPointers && numRows > 0)
-				for (size_t i = 0; i < numRows; i++)
-					if (ppRowPointers[i])
-						delete[] ppRowPointers[i];
-		}
-
-		void CloseWrite(FILE* pFile, png_struct* pWriteStruct = nullptr, png_info* pInfoStruct = nullptr, png_byte** ppRowPointers = nullptr, size_t numRows = 0)
-		{
-			if (pFile)
-				fclose(pFile);
-
-			if (pWriteStruct && pInfoStruct)
-				png_destroy_write_struct(&pWriteStruct, &pInfoStruct);
-			else if (pWriteStruct)
-				png_destroy_write_struct(&pWriteStruct, nullptr);
-			else if (pInfoStruct)
-				png_destroy_write_struct(nullptr, &pInfoStruct);
-
-			if (ppRowPointers && numRows > 0)
-				for (size_t i = 0; i < numRows; i++)
-					if (ppRowPointers[i])
-						delete[] ppRowPointers[i];
-		}
-
 		std::pair<ColorSpace, int> GetColorSpaceAndNumChannels(int cspace) 
 		{
 			switch (cspace) 
@@ -86,285 +64,1014 @@ namespace imglib::png
 				throw std::logic_error("Invalid color space for a png file");
 			}
 		}
-	}
 
-	PngImg Read(std::wstring_view fileName)
-	{
-		// Open the image file for reading.
-		auto pFile = OpenFile(fileName, Mode::Read);
+		// Encoded data decoded from memory, position is the next byte to read.
+		struct MemoryReader
+		{
+			png_byte const* data{ nullptr };
+			size_t size{ 0 };
+			size_t position{ 0 };
+		};
 
-		int numBytesToCheck{ 8 };
-		if (!IsPng(pFile, numBytesToCheck))
+		void ReadFromMemory(png_struct* png, png_byte* out, size_t length)
 		{
-			CloseRead(pFile);
-			throw std::runtime_error("File is not a png file.");
+			auto* reader = static_cast<MemoryReader*>(png_get_io_ptr(png));
+			if (length > reader->size - reader->position)
+				png_error(png, "Read past the end of the data.");
+
+			std::copy_n(reader->data + reader->position, length, out);
+			reader->position += length;
 		}
 
-		// Create and initialize the png_struct.
-		auto my_png_read_struct = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-		if (!my_png_read_struct)
+		// Open file, or data in memory, and libpng structures of a decoding, released in the destructor.
+		struct ReadContext
 		{
-			CloseRead(pFile);
-			throw std::runtime_error("PNG read struct could not be created.");
-		}
+			FILE* file{ nullptr };
+			MemoryReader memory;
+			png_struct* png{ nullptr };
+			png_info* info{ nullptr };
+			ImageLayout layout;
+			bool interlaced{ false };
+
+			ReadContext() = default;
+			ReadContext(const ReadContext&) = delete;
+			ReadContext& operator=(const ReadContext&) = delete;
 
-		// Allocate / initialize the memory for image information.
-		auto my_png_info_struct = png_create_info_struct(my_png_read_struct);
-		if (!my_png_info_struct)
+			~ReadContext()
+			{
+				if (png)
+					png_destroy_read_struct(&png, info ? &info : nullptr, nullptr);
+
+				if (file)
+					fclose(file);
+			}
+		};
+
+		constexpr int numSignatureBytes{ 8 };
+
+		void CreateRead(ReadContext& ctx)
 		{
-			CloseRead(pFile, my_png_read_struct);
-			throw std::runtime_error("PNG image info struct could not be created.");
+			// Create and initialize the png_struct.
+			ctx.png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+			if (!ctx.png)
+				throw std::runtime_error("PNG read struct could not be created.");
+
+			// Allocate / initialize the memory for image information.
+			ctx.info = png_create_info_struct(ctx.png);
+			if (!ctx.info)
+				throw std::runtime_error("PNG image info struct could not be created.");
 		}
 
-		if (setjmp(png_jmpbuf(my_png_read_struct)))
+		// Reads the header and sets up the transformations so that each sample is either 8-bit or 16-bit in native byte order.
+		void ReadInfo(ReadContext& ctx)
 		{
-			// libpng jumps here if it encounters an error.
-			CloseRead(pFile, my_png_read_struct, my_png_info_struct);
-			throw std::runtime_error("PNG error!");
-		}
+			if (setjmp(png_jmpbuf(ctx.png)))
+			{
+				// libpng jumps here if it encounters an error.
+				throw std::runtime_error("PNG error!");
+			}
+
+			// Let the libpng know how many bytes are read to verify that the given data is a png file.
+			png_set_sig_bytes(ctx.png, numSignatureBytes);
 
-		// Initialize the input/output for the PNG file to the default functions.
-		png_init_io(my_png_read_struct, pFile);
+			// Read the information before the actual image data.
+			png_read_info(ctx.png, ctx.info);
 
-		// Let the libpng know how many bytes are read to verify that the given file is a png file.
-		png_set_sig_bytes(my_png_read_struct, numBytesToCheck);
+			// Read image information.
+			PngInfo inImgProp{};
+			png_get_IHDR(ctx.png, ctx.info, &inImgProp.width, &inImgProp.height, &inImgProp.bit_depth,
+				&inImgProp.color_type, &inImgProp.interlace_type, &inImgProp.compression_type, &inImgProp.filter_method);
 
-		// Read the information before the actual image data.
-		png_read_info(my_png_read_struct, my_png_info_struct);
+			// Color types: 
+			// PNG_COLOR_TYPE_GRAY		 -> bit depths 1, 2, 4, 8, 16
+			// PNG_COLOR_TYPE_GRAY_ALPHA -> bit depths 8, 16
+			// PNG_COLOR_TYPE_PALETTE	 -> bit depths 1, 2, 4, 8
+			// PNG_COLOR_TYPE_RGB		 -> bit_depths 8, 16
+			// PNG_COLOR_TYPE_RGB_ALPHA  -> bit_depths 8, 16
 
-		// Read image information.
-		PngInfo inImgProp{};
-		png_get_IHDR(my_png_read_struct, my_png_info_struct, &inImgProp.width, &inImgProp.height, &inImgProp.bit_depth,
-			&inImgProp.color_type, &inImgProp.interlace_type, &inImgProp.compression_type, &inImgProp.filter_method);
+			// Grayscale images with bith-depth less than 8, will be read into a single byte.
+			if (inImgProp.color_type == PNG_COLOR_TYPE_GRAY && inImgProp.bit_depth < 8)
+				png_set_expand_gray_1_2_4_to_8(ctx.png);
 
-		// Color types: 
-		// PNG_COLOR_TYPE_GRAY		 -> bit depths 1, 2, 4, 8, 16
-		// PNG_COLOR_TYPE_GRAY_ALPHA -> bit depths 8, 16
-		// PNG_COLOR_TYPE_PALETTE	 -> bit depths 1, 2, 4, 8
-		// PNG_COLOR_TYPE_RGB		 -> bit_depths 8, 16
-		// PNG_COLOR_TYPE_RGB_ALPHA  -> bit_depths 8, 16
+			// Palette images are read as RGB images.
+			if (inImgProp.color_type == PNG_COLOR_TYPE_PALETTE)
+				png_set_palette_to_rgb(ctx.png);
 
-		// Set-up the transformations so that each color component is either 8-bit or 16-bit depth.
+			// If there exists a transparency chunk (tRNS chunk), convert it to an alpha channel.
+			bool hasTransparency = png_get_valid(ctx.png, ctx.info, PNG_INFO_tRNS) != 0;
+			if (hasTransparency)
+				png_set_tRNS_to_alpha(ctx.png);
 
-		// Grayscale images with bith-depth less than 8, will be read into a single byte.
-		if (inImgProp.color_type == PNG_COLOR_TYPE_GRAY && inImgProp.bit_depth < 8)
-			png_set_expand_gray_1_2_4_to_8(my_png_read_struct);
+			// 16-bit samples are stored big endian in the file.
+			if (inImgProp.bit_depth == 16 && std::endian::native == std::endian::little)
+				png_set_swap(ctx.png);
 
-		// Palette images are read as RGB images.
-		if (inImgProp.color_type == PNG_COLOR_TYPE_PALETTE)
-			png_set_palette_to_rgb(my_png_read_struct);
+			ctx.interlaced = inImgProp.interlace_type != PNG_INTERLACE_NONE;
+			if (ctx.interlaced)
+				png_set_interlace_handling(ctx.png);
 
-		// If there exists a transparency chunk (tRNS chunk), convert it to an alpha channel.
-		if (png_get_valid(my_png_read_struct, my_png_info_struct, PNG_INFO_tRNS))
-			png_set_tRNS_to_alpha(my_png_read_struct);
+			// Update the info structure to reflect the applied transformations.
+			png_read_update_info(ctx.png, ctx.info);
 
-		// Update the info structure to reflect the applied transformations.
-		png_read_update_info(my_png_read_struct, my_png_info_struct);
+			auto [cspace, numChannels] = GetColorSpaceAndNumChannels(png_get_color_type(ctx.png, ctx.info));
+			if (cspace == ColorSpace::Unspecified || numChannels == 0)
+				throw std::runtime_error("Color space or number of channels cannot be detected.");
 
-		PngImg img;
+			int bitDepth = png_get_bit_depth(ctx.png, ctx.info);
+			if (bitDepth != 8 && bitDepth != 16)
+				throw std::runtime_error("Bit-depth error, add support for bith-depths greater than 16.");
 
-		// Allocate memory for the image.
-		png_byte** row_pointers{ nullptr };
-		try
+			ctx.layout = ImageLayout{ inImgProp.height, inImgProp.width, cspace, static_cast<size_t>(numChannels), bitDepth };
+		}
+
+		bool IsValidBitDepth(int colorType, int bitDepth) noexcept
 		{
-			row_pointers = new png_byte * [inImgProp.height];
-			for (size_t i = 0; i < inImgProp.height; i++)
+			switch (colorType)
 			{
-				void* row_bytes = png_malloc(my_png_read_struct, png_get_rowbytes(my_png_read_struct, my_png_info_struct));
-				row_pointers[i] = static_cast<png_byte*>(row_bytes);
+			case PNG_COLOR_TYPE_GRAY:
+				return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+			case PNG_COLOR_TYPE_PALETTE:
+				return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+			case PNG_COLOR_TYPE_GRAY_ALPHA:
+			case PNG_COLOR_TYPE_RGB:
+			case PNG_COLOR_TYPE_RGB_ALPHA:
+				return bitDepth == 8 || bitDepth == 16;
+			default:
+				return false;
 			}
 		}
-		catch (...)
+
+		// The layout OpenRead arrives at, from the header chunk and a transparency chunk if there is one. Both come before
+		// the image data, so the chunks are read until the first IDAT chunk or up to a transparency chunk.
+		ImageLayout ProbeLayout(imglib::detail::ByteReader& reader)
 		{
-			CloseRead(pFile, my_png_read_struct, my_png_info_struct, row_pointers, inImgProp.height);
-			throw std::runtime_error("Something went wrong when allocating memory for reading the image.");
+			png_byte header[numSignatureBytes + 8 + 13];
+			if (!reader.read(header, sizeof(header)) || png_sig_cmp(header, 0, numSignatureBytes) != 0)
+				throw std::runtime_error("Data is not a png file.");
+
+			png_byte const* ihdr = header + numSignatureBytes;
+			if (png_get_uint_32(ihdr) != 13 || std::memcmp(ihdr + 4, "IHDR", 4) != 0)
+				throw std::runtime_error("PNG header chunk is missing.");
+
+			const png_uint_32 width = png_get_uint_32(ihdr + 8);
+			const png_uint_32 height = png_get_uint_32(ihdr + 12);
+			const int bitDepth = ihdr[16];
+			const int colorType = ihdr[17];
+			if (width == 0 || height == 0 || width > PNG_UINT_31_MAX || height > PNG_UINT_31_MAX || !IsValidBitDepth(colorType, bitDepth))
+				throw std::runtime_error("Invalid png header.");
+
+			// Alpha channels make a transparency chunk invalid, libpng ignores it then.
+			bool hasTransparency{ false };
+			if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_RGB || colorType == PNG_COLOR_TYPE_PALETTE)
+			{
+				// Skip the checksum of the header chunk.
+				png_byte chunk[8];
+				bool ok = reader.skip(4);
+				while (ok && reader.read(chunk, sizeof(chunk)))
+				{
+					if (std::memcmp(chunk + 4, "IDAT", 4) == 0)
+						break;
+
+					if (std::memcmp(chunk + 4, "tRNS", 4) == 0)
+					{
+						hasTransparency = true;
+						break;
+					}
+
+					ok = reader.skip(static_cast<size_t>(png_get_uint_32(chunk)) + 4);
+				}
+			}
+
+			auto [cspace, numChannels] = GetColorSpaceAndNumChannels(colorType);
+			if (hasTransparency)
+			{
+				cspace = cspace == ColorSpace::GrayScale ? ColorSpace::GrayScaleAlpha : ColorSpace::RGBA;
+				numChannels++;
+			}
+
+			return ImageLayout{ height, width, cspace, static_cast<size_t>(numChannels), bitDepth == 16 ? 16 : 8 };
 		}
 
-		// Read image data into the allocated memory.
-		png_read_image(my_png_read_struct, row_pointers);
+		void OpenRead(ReadContext& ctx, std::wstring_view fileName)
+		{
+			// Open the image file for reading.
+			ctx.file = OpenFile(fileName, Mode::Read);
+
+			if (!IsPng(ctx.file, numSignatureBytes))
+				throw std::runtime_error("File is not a png file.");
 
-		// End reading the image data.
-		png_read_end(my_png_read_struct, nullptr);
+			CreateRead(ctx);
 
-		// Create the image
-		auto [cspace, numChannels] = GetColorSpaceAndNumChannels(inImgProp.color_type);
-		if (cspace == ColorSpace::Unspecified || numChannels == 0) 
+			// Initialize the input/output for the PNG file to the default functions.
+			png_init_io(ctx.png, ctx.file);
+			ReadInfo(ctx);
+		}
+
+		// The data is read in place, it has to outlive the context.
+		void OpenRead(ReadContext& ctx, std::span<const std::byte> data)
 		{
-			CloseRead(pFile, my_png_read_struct, my_png_info_struct, row_pointers, inImgProp.height);
-			throw std::runtime_error("Color space or number of channels cannot be detected.");
+			auto bytes = reinterpret_cast<png_byte const*>(data.data());
+			if (data.size() < numSignatureBytes || png_sig_cmp(bytes, 0, numSignatureBytes) != 0)
+				throw std::runtime_error("Data is not a png file.");
+
+			CreateRead(ctx);
+
+			ctx.memory = MemoryReader{ bytes, data.size(), numSignatureBytes };
+			png_set_read_fn(ctx.png, &ctx.memory, ReadFromMemory);
+			ReadInfo(ctx);
 		}
-			
-		if (inImgProp.bit_depth <= 8)
+
+		void ReadImage(ReadContext& ctx, png_byte** rows)
 		{
-			auto im = ImgBitDepth8(inImgProp.height, inImgProp.width, cspace, numChannels);
-			for (size_t i = 0; i < inImgProp.height; i++)
+			if (setjmp(png_jmpbuf(ctx.png)))
+				throw std::runtime_error("PNG error!");
+
+			png_read_image(ctx.png, rows);
+			png_read_end(ctx.png, nullptr);
+		}
+
+		void ReadRow(ReadContext& ctx, png_byte* row)
+		{
+			if (setjmp(png_jmpbuf(ctx.png)))
+				throw std::runtime_error("PNG error!");
+
+			png_read_row(ctx.png, row, nullptr);
+		}
+
+		void ReadEnd(ReadContext& ctx)
+		{
+			if (setjmp(png_jmpbuf(ctx.png)))
+				throw std::runtime_error("PNG error!");
+
+			png_read_end(ctx.png, nullptr);
+		}
+
+		int GetZlibStrategy(CompressionStrategy strategy)
+		{
+			switch (strategy)
 			{
-				size_t byte_index{ 0 };
-				for (size_t j = 0; j < inImgProp.width; j++)
-					for (size_t k = 0; k < numChannels; k++)
-						im(k)(i, j) = row_pointers[i][byte_index++];
+			case CompressionStrategy::Filtered:
+				return Z_FILTERED;
+			case CompressionStrategy::HuffmanOnly:
+				return Z_HUFFMAN_ONLY;
+			case CompressionStrategy::Rle:
+				return Z_RLE;
+			case CompressionStrategy::Fixed:
+				return Z_FIXED;
+			default:
+				return Z_DEFAULT_STRATEGY;
 			}
-
-			img = std::move(im);
 		}
-		else if (inImgProp.bit_depth <= 16)
+
+		int GetPngFilters(RowFilter filter)
 		{
-			auto im = ImgBitDepth16(inImgProp.height, inImgProp.width, cspace, numChannels);
-			for (size_t i = 0; i < inImgProp.height; i++)
+			switch (filter)
 			{
-				size_t byte_index{ 0 };
-				for (size_t j = 0; j < inImgProp.width; j++)
-				{
-					for (size_t k = 0; k < numChannels; k++)
-					{
-						std::uint16_t val{ row_pointers[i][byte_index++] };
-						val <<= 8;
-						val += row_pointers[i][byte_index++];
-						im(k)(i, j) = val;
-					}
-				}
+			case RowFilter::None:
+				return PNG_FILTER_NONE;
+			case RowFilter::Sub:
+				return PNG_FILTER_SUB;
+			case RowFilter::Up:
+				return PNG_FILTER_UP;
+			case RowFilter::Average:
+				return PNG_FILTER_AVG;
+			case RowFilter::Paeth:
+				return PNG_FILTER_PAETH;
+			default:
+				return PNG_ALL_FILTERS;
 			}
+		}
 
-			img = std::move(im);
+		void CheckOptions(const PngWriteOptions& options)
+		{
+			if (options.compression_level < 0 || options.compression_level > 9 || options.memory_level < 1 || options.memory_level > 9 ||
+				options.window_bits < 8 || options.window_bits > 15 || options.buffer_size == 0 || options.buffer_size > PNG_UINT_31_MAX)
+				throw std::invalid_argument("Invalid png write options.");
 		}
-		else 
+
+		void CheckLayout(const ImageLayout& layout)
 		{
-			CloseRead(pFile, my_png_read_struct, my_png_info_struct, row_pointers, inImgProp.height);
-			throw std::runtime_error("Bit-depth error, add support for bith-depths greater than 16.");
+			if (layout.height == 0 || layout.width == 0 || (layout.bit_depth != 8 && layout.bit_depth != 16) || !IsValid(layout.color_space, layout.num_channels))
+				throw std::invalid_argument("Invalid image layout.");
+
+			if (layout.height > PNG_UINT_31_MAX || layout.width > PNG_UINT_31_MAX)
+				throw std::logic_error("Image size is too big");
 		}
-		
-		// do the memory clean-up and return the image.
-		CloseRead(pFile, my_png_read_struct, my_png_info_struct, row_pointers, inImgProp.height);
-		return img;
-	}
 
-	void Write(const PngImg& img, std::wstring_view fileName) 
-	{
-		const ImgBitDepth8* pImg8 = std::get_if<ImgBitDepth8>(&img);
-		const ImgBitDepth16* pImg16 = std::get_if<ImgBitDepth16>(&img);
+		// Exceptions must not unwind through libpng, a failed allocation goes through its error handling instead.
+		void WriteToMemory(png_struct* png, png_byte* data, size_t length)
+		{
+			auto* output = static_cast<std::vector<std::byte>*>(png_get_io_ptr(png));
+			auto bytes = reinterpret_cast<std::byte const*>(data);
 
-		if (pImg8 == nullptr && pImg16 == nullptr)
-			throw std::logic_error("Image type error.");
+			// The handler has to end before the jump, otherwise the caught exception is never released.
+			bool failed = false;
+			try
+			{
+				output->insert(output->end(), bytes, bytes + length);
+			}
+			catch (const std::exception&)
+			{
+				failed = true;
+			}
+
+			if (failed)
+				png_error(png, "Insufficient memory for the encoded data.");
+		}
 
-		// Open the image file for writing.
-		auto pFile = OpenFile(fileName, Mode::Write);
+		void FlushMemory(png_struct*) { }
 
-		// Create and initialize the png_struct.
-		auto my_png_write_struct = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-		if (!my_png_write_struct)
+		// Open file and libpng structures of an encoding, released in the destructor. With an output buffer the encoded
+		// data is appended to it instead of written to a file.
+		struct WriteContext
 		{
-			CloseWrite(pFile);
-			throw std::runtime_error("PNG write struct could not be created.");
-		}
+			FILE* file{ nullptr };
+			std::vector<std::byte>* output{ nullptr };
+			png_struct* png{ nullptr };
+			png_info* info{ nullptr };
+			ImageLayout layout;
+
+			WriteContext() = default;
+			WriteContext(const WriteContext&) = delete;
+			WriteContext& operator=(const WriteContext&) = delete;
+
+			~WriteContext()
+			{
+				if (png)
+					png_destroy_write_struct(&png, info ? &info : nullptr);
+
+				if (file)
+					fclose(file);
+			}
+		};
 
-		// Allocate / initialize the memory for image information.
-		auto my_png_info_struct = png_create_info_struct(my_png_write_struct);
-		if (!my_png_info_struct)
+		// Writes the header, the rows are then expected in native byte order. fileName is not used with an output buffer.
+		void OpenWrite(WriteContext& ctx, std::wstring_view fileName, const ImageLayout& layout, const PngWriteOptions& options)
 		{
-			CloseWrite(pFile, my_png_write_struct);
-			throw std::runtime_error("PNG image info struct could not be created.");
+			CheckOptions(options);
+			CheckLayout(layout);
+
+			int color_type = GetPngColorSpace(layout.color_space);
+			ctx.layout = layout;
+
+			// Open the image file for writing.
+			if (!ctx.output)
+				ctx.file = OpenFile(fileName, Mode::Write);
+
+			// Create and initialize the png_struct.
+			ctx.png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+			if (!ctx.png)
+				throw std::runtime_error("PNG write struct could not be created.");
+
+			// Allocate / initialize the memory for image information.
+			ctx.info = png_create_info_struct(ctx.png);
+			if (!ctx.info)
+				throw std::runtime_error("PNG image info struct could not be created.");
+
+			if (setjmp(png_jmpbuf(ctx.png)))
+			{
+				// libpng jumps here if it encounters an error.
+				throw std::runtime_error("PNG error!");
+			}
+
+			// Initialize the input/output for the PNG file to the default functions, or to the output buffer.
+			if (ctx.output)
+				png_set_write_fn(ctx.png, ctx.output, WriteToMemory, FlushMemory);
+			else
+				png_init_io(ctx.png, ctx.file);
+
+			// Set the compression and filtering before any image data is written.
+			png_set_compression_level(ctx.png, options.compression_level);
+			png_set_compression_strategy(ctx.png, GetZlibStrategy(options.strategy));
+			png_set_compression_mem_level(ctx.png, options.memory_level);
+			png_set_compression_window_bits(ctx.png, options.window_bits);
+			png_set_compression_buffer_size(ctx.png, options.buffer_size);
+			png_set_filter(ctx.png, PNG_FILTER_TYPE_BASE, GetPngFilters(options.filter));
+
+			// Set image info.
+			png_set_IHDR(ctx.png, ctx.info, static_cast<png_uint_32>(layout.width), static_cast<png_uint_32>(layout.height), layout.bit_depth,
+				color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+			// Write the file header information.
+			png_write_info(ctx.png, ctx.info);
+
+			// 16-bit samples are stored big endian in the file.
+			if (layout.bit_depth == 16 && std::endian::native == std::endian::little)
+				png_set_swap(ctx.png);
 		}
 
-		if (setjmp(png_jmpbuf(my_png_write_struct)))
+		void WriteRow(WriteContext& ctx, png_byte const* row)
 		{
-			// libpng jumps here if it encounters an error.
-			CloseWrite(pFile, my_png_write_struct, my_png_info_struct);
-			throw std::runtime_error("PNG error!");
+			if (setjmp(png_jmpbuf(ctx.png)))
+				throw std::runtime_error("PNG error!");
+
+			png_write_row(ctx.png, row);
 		}
 
-		// Initialize the input/output for the PNG file to the default functions.
-		png_init_io(my_png_write_struct, pFile);
+		void WriteEnd(WriteContext& ctx)
+		{
+			if (setjmp(png_jmpbuf(ctx.png)))
+				throw std::runtime_error("PNG error!");
 
-		png_uint_32 width{ 0 }, height{ 0 };
-		int bit_depth{ 0 };
-		int color_type{ -1 };
-		size_t maxHeight{ 0 };
-		bool validSize{ false };
-		size_t rowDataSize{ 0 };
-		size_t numChannels{ 0 };
+			png_write_end(ctx.png, ctx.info);
+		}
 
-		if (pImg8) 
+		template <typename T>
+		void WritePlanar(WriteContext& ctx, const Image<T>& img)
 		{
-			width = static_cast<png_uint_32>(pImg8->width());
-			height = static_cast<png_uint_32>(pImg8->height());
-			bit_depth = 8;
-			color_type = GetPngColorSpace(pImg8->color_space());
-			validSize = pImg8->data_size() <= PNG_SIZE_MAX;
-			numChannels = pImg8->num_channels();
-			rowDataSize = width * numChannels;
+			const auto& layout = ctx.layout;
+			std::vector<T> row(layout.width * layout.num_channels);
+			std::vector<T const*> planes(layout.num_channels);
+
+			for (size_t i = 0; i < layout.height; i++)
+			{
+				for (size_t k = 0; k < layout.num_channels; k++)
+					planes[k] = &img(k)(i, 0);
+
+				interleave_row(planes.data(), layout.num_channels, row.data(), layout.width);
+				WriteRow(ctx, reinterpret_cast<png_byte const*>(row.data()));
+			}
+
+			WriteEnd(ctx);
 		}
-		else 
+
+		// Parallel encoding: the image is cut into bands of rows which are filtered and deflated on their own. A band is
+		// deflated with the end of the data before it as preset dictionary and ends with a sync flush on a byte boundary
+		// without the final block flag, so the compressed bands one after the other form a single deflate stream.
+		constexpr size_t bandBytes{ 1 << 18 };
+
+		// Lengths passed to zlib are uInt, which has 32 bits. Larger buffers are handed over in steps of 1 GiB.
+		constexpr size_t maxZlibBytes{ 1 << 30 };
+		static_assert(maxZlibBytes <= std::numeric_limits<uInt>::max(), "zlib lengths do not fit into uInt.");
+
+		png_byte PaethPredictor(int a, int b, int c) noexcept
 		{
-			width = static_cast<png_uint_32>(pImg16->width());
-			height = static_cast<png_uint_32>(pImg16->height());
-			bit_depth = 16;
-			color_type = GetPngColorSpace(pImg16->color_space());
-			validSize = pImg16->data_size() <= PNG_SIZE_MAX;
-			numChannels = pImg16->num_channels();
-			rowDataSize = width * numChannels * 2;
+			int p = a + b - c;
+			int pa = std::abs(p - a);
+			int pb = std::abs(p - b);
+			int pc = std::abs(p - c);
+
+			if (pa <= pb && pa <= pc)
+				return static_cast<png_byte>(a);
+
+			return static_cast<png_byte>(pb <= pc ? b : c);
 		}
 
-		if (!validSize)
-			throw std::logic_error("Image size is too big");
+		// Filters a row with one of the filter types of the PNG specification. out starts with the filter type byte, prev
+		// is the unfiltered row above and all zeros for the first row, bpp the number of bytes per pixel.
+		void FilterRow(png_byte type, png_byte const* row, png_byte const* prev, size_t rowBytes, size_t bpp, png_byte* out) noexcept
+		{
+			*out++ = type;
 
-		// Set image info.
-		png_set_IHDR(my_png_write_struct, my_png_info_struct, width, height, bit_depth, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+			switch (type)
+			{
+			case PNG_FILTER_VALUE_SUB:
+				std::copy_n(row, bpp, out);
+				for (size_t i = bpp; i < rowBytes; i++)
+					out[i] = static_cast<png_byte>(row[i] - row[i - bpp]);
+				break;
+			case PNG_FILTER_VALUE_UP:
+				for (size_t i = 0; i < rowBytes; i++)
+					out[i] = static_cast<png_byte>(row[i] - prev[i]);
+				break;
+			case PNG_FILTER_VALUE_AVG:
+				for (size_t i = 0; i < bpp; i++)
+					out[i] = static_cast<png_byte>(row[i] - prev[i] / 2);
+				for (size_t i = bpp; i < rowBytes; i++)
+					out[i] = static_cast<png_byte>(row[i] - (row[i - bpp] + prev[i]) / 2);
+				break;
+			case PNG_FILTER_VALUE_PAETH:
+				for (size_t i = 0; i < bpp; i++)
+					out[i] = static_cast<png_byte>(row[i] - prev[i]);
+				for (size_t i = bpp; i < rowBytes; i++)
+					out[i] = static_cast<png_byte>(row[i] - PaethPredictor(row[i - bpp], prev[i], prev[i - bpp]));
+				break;
+			default:
+				std::copy_n(row, rowBytes, out);
+			}
+		}
 
-		// Write the file header information.
-		png_write_info(my_png_write_struct, my_png_info_struct);
+		// Sum of the filtered bytes taken as signed values, the heuristic of libpng for the adaptive filter choice.
+		size_t FilterCost(png_byte const* filtered, size_t rowBytes) noexcept
+		{
+			size_t cost{ 0 };
+			for (size_t i = 1; i <= rowBytes; i++)
+				cost += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
 
-		// Set transformations if needed - no transformations.
-		
-		// Allocate memory for the image.
-		png_byte** row_pointers{ nullptr };
-		try
+			return cost;
+		}
+
+		void FilterRow(RowFilter filter, png_byte const* row, png_byte const* prev, size_t rowBytes, size_t bpp, png_byte* out, png_byte* scratch) noexcept
 		{
-			row_pointers = new png_byte * [height];
-			for (size_t i = 0; i < height; i++)
-				row_pointers[i] = new png_byte[rowDataSize];
+			if (filter != RowFilter::Adaptive)
+			{
+				FilterRow(static_cast<png_byte>(filter), row, prev, rowBytes, bpp, out);
+				return;
+			}
+
+			FilterRow(PNG_FILTER_VALUE_NONE, row, prev, rowBytes, bpp, out);
+			size_t bestCost = FilterCost(out, rowBytes);
+
+			for (png_byte type = PNG_FILTER_VALUE_SUB; type <= PNG_FILTER_VALUE_PAETH; type++)
+			{
+				FilterRow(type, row, prev, rowBytes, bpp, scratch);
+				size_t cost = FilterCost(scratch, rowBytes);
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					std::copy_n(scratch, rowBytes + 1, out);
+				}
+			}
 		}
-		catch (...)
+
+		// Interleaves a row into the byte order of the file.
+		template <typename T>
+		void GetFileRow(const Image<T>& img, size_t i, std::vector<T const*>& planes, T* row)
 		{
-			CloseWrite(pFile, my_png_write_struct, my_png_info_struct, row_pointers, height);
-			throw std::runtime_error("Something went wrong when allocating memory for writing the image.");
+			for (size_t k = 0; k < img.num_channels(); k++)
+				planes[k] = &img(k)(i, 0);
+
+			interleave_row(planes.data(), img.num_channels(), row, img.width());
+
+			if constexpr (sizeof(T) == 2)
+			{
+				if constexpr (std::endian::native == std::endian::little)
+				{
+					for (size_t k = 0; k < img.width() * img.num_channels(); k++)
+						row[k] = static_cast<T>((row[k] >> 8) | (row[k] << 8));
+				}
+			}
 		}
 
-		// Fill the allocated memory with image data.
+		uLong Adler32(png_byte const* data, size_t length) noexcept
+		{
+			uLong adler = adler32(0, nullptr, 0);
+			for (size_t first = 0; first < length; first += maxZlibBytes)
+				adler = adler32(adler, data + first, static_cast<uInt>(std::min(maxZlibBytes, length - first)));
 
-		if (pImg8) 
+			return adler;
+		}
+
+		// Raw deflate of length bytes at data, primed with the dictLength bytes before data. The last band finishes the stream,
+		// the others end with a sync flush. Returns false on zlib errors.
+		bool DeflateBand(png_byte const* data, size_t length, size_t dictLength, bool last, const PngWriteOptions& options, int windowBits, std::vector<png_byte>& out)
 		{
-			for (size_t i = 0; i < height; i++)
+			z_stream strm{};
+			if (deflateInit2(&strm, options.compression_level, Z_DEFLATED, -windowBits, options.memory_level, GetZlibStrategy(options.strategy)) != Z_OK)
+				return false;
+
+			bool ok = dictLength == 0 || deflateSetDictionary(&strm, data - dictLength, static_cast<uInt>(dictLength)) == Z_OK;
+
+			// The bound is for a single Z_FINISH call, a sync flush adds at most an empty stored block.
+			out.resize(deflateBound(&strm, static_cast<uLong>(std::min(length, maxZlibBytes))) + 16);
+			size_t written{ 0 };
+
+			for (size_t first = 0; ok && first < length; first += maxZlibBytes)
 			{
-				size_t byte_index{ 0 };
-				for (size_t j = 0; j < width; j++)
-					for (size_t k = 0; k < numChannels; k++) 
-						row_pointers[i][byte_index++] = (*pImg8)(k)(i, j);
+				size_t count = std::min(maxZlibBytes, length - first);
+				strm.next_in = const_cast<png_byte*>(data + first);
+				strm.avail_in = static_cast<uInt>(count);
+				int flush = first + count < length ? Z_NO_FLUSH : (last ? Z_FINISH : Z_SYNC_FLUSH);
+
+				// Done once deflate leaves some of the output space unused.
+				do
+				{
+					if (out.size() - written < 64)
+						out.resize(2 * out.size());
+
+					strm.next_out = out.data() + written;
+					strm.avail_out = static_cast<uInt>(std::min(maxZlibBytes, out.size() - written));
+					size_t available = strm.avail_out;
+
+					if (deflate(&strm, flush) == Z_STREAM_ERROR)
+						ok = false;
+
+					written += available - strm.avail_out;
+				} while (ok && strm.avail_out == 0);
 			}
+
+			deflateEnd(&strm);
+			out.resize(written);
+			return ok;
 		}
-		else 
+
+		void WriteBytes(WriteContext& ctx, png_byte const* data, size_t length)
 		{
-			for (size_t i = 0; i < height; i++)
+			if (ctx.output)
 			{
-				size_t byte_index{ 0 };
-				for (size_t j = 0; j < width; j++) 
+				auto bytes = reinterpret_cast<std::byte const*>(data);
+				ctx.output->insert(ctx.output->end(), bytes, bytes + length);
+			}
+			else if (length > 0 && fwrite(data, 1, length, ctx.file) != length)
+			{
+				throw std::runtime_error("File cannot be written.");
+			}
+		}
+
+		void WriteChunk(WriteContext& ctx, const char* type, png_byte const* data, size_t length)
+		{
+			png_byte header[8];
+			png_save_uint_32(header, static_cast<png_uint_32>(length));
+			std::copy_n(type, 4, header + 4);
+
+			uLong crc = crc32(0, nullptr, 0);
+			crc = crc32(crc, header + 4, 4);
+			if (length > 0)
+				crc = crc32(crc, data, static_cast<uInt>(length));
+
+			png_byte trailer[4];
+			png_save_uint_32(trailer, static_cast<png_uint_32>(crc));
+
+			WriteBytes(ctx, header, sizeof(header));
+			WriteBytes(ctx, data, length);
+			WriteBytes(ctx, trailer, sizeof(trailer));
+		}
+
+		// Only the file and output members of the context are used, libpng does not take part.
+		template <typename T>
+		void WriteParallel(WriteContext& ctx, std::wstring_view fileName, const Image<T>& img, const PngWriteOptions& options)
+		{
+			const ImageLayout layout{ img.height(), img.width(), img.color_space(), img.num_channels(), static_cast<int>(8 * sizeof(T)) };
+			CheckOptions(options);
+			CheckLayout(layout);
+
+			const size_t bpp = layout.num_channels * sizeof(T);
+			const size_t rowBytes = layout.width * bpp;
+			const size_t rowsPerBand = std::max(bandBytes / (rowBytes + 1), size_t{ 1 });
+			const size_t numBands = (layout.height + rowsPerBand - 1) / rowsPerBand;
+			const size_t numThreads = std::min(GetNumThreads(options.num_threads), numBands);
+
+			// zlib does not make raw deflate streams with a window of 256 bytes, 512 bytes are valid for any decoder.
+			const int windowBits = std::max(options.window_bits, 9);
+
+			// Filtered rows of the whole image, each starting with its filter type.
+			std::vector<png_byte> filtered(layout.height * (rowBytes + 1));
+
+			parallel_for(0, layout.height, [&](size_t, size_t first, size_t last)
+				{
+					std::vector<T> rows(2 * layout.width * layout.num_channels, T{ 0 });
+					std::vector<T const*> planes(layout.num_channels);
+					std::vector<png_byte> scratch(rowBytes + 1);
+					T* prev = rows.data();
+					T* row = prev + layout.width * layout.num_channels;
+
+					if (first > 0)
+						GetFileRow(img, first - 1, planes, prev);
+
+					for (size_t i = first; i < last; i++)
+					{
+						GetFileRow(img, i, planes, row);
+						FilterRow(options.filter, reinterpret_cast<png_byte const*>(row), reinterpret_cast<png_byte const*>(prev), rowBytes, bpp,
+							filtered.data() + i * (rowBytes + 1), scratch.data());
+						std::swap(prev, row);
+					}
+				}, numThreads);
+
+			std::vector<std::vector<png_byte>> compressed(numBands);
+			std::vector<uLong> checksums(numBands);
+			std::atomic<bool> failed{ false };
+
+			parallel_for(0, numBands, [&](size_t, size_t first, size_t last)
 				{
-					for (size_t k = 0; k < numChannels; k++) 
+					for (size_t band = first; band < last; band++)
 					{
-						std::uint16_t val = (*pImg16)(k)(i, j);
-						row_pointers[i][byte_index++] = (val >> 8);
-						row_pointers[i][byte_index++] = static_cast<uint8_t>(val);
+						const size_t begin = band * rowsPerBand * (rowBytes + 1);
+						const size_t end = std::min((band + 1) * rowsPerBand, layout.height) * (rowBytes + 1);
+						const size_t dictLength = std::min(begin, size_t{ 1 } << windowBits);
+
+						checksums[band] = Adler32(filtered.data() + begin, end - begin);
+						if (!DeflateBand(filtered.data() + begin, end - begin, dictLength, band + 1 == numBands, options, windowBits, compressed[band]))
+							failed = true;
 					}
+				}, numThreads);
+
+			if (failed)
+				throw std::runtime_error("Deflate error!");
+
+			// zlib stream: the header, the deflate stream of the bands and the adler32 of all filtered rows.
+			std::vector<png_byte> stream;
+			size_t streamSize{ 6 };
+			for (const auto& band : compressed)
+				streamSize += band.size();
+
+			stream.reserve(streamSize);
+
+			const int level = options.compression_level;
+			const auto cmf = static_cast<png_byte>(((windowBits - 8) << 4) | Z_DEFLATED);
+			auto flg = static_cast<png_byte>((level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6);
+			flg = static_cast<png_byte>(flg + 31 - (cmf * 256 + flg) % 31);
+			stream.push_back(cmf);
+			stream.push_back(flg);
+
+			uLong adler = checksums[0];
+			stream.insert(stream.end(), compressed[0].begin(), compressed[0].end());
+			for (size_t band = 1; band < numBands; band++)
+			{
+				const size_t length = std::min((band + 1) * rowsPerBand, layout.height) * (rowBytes + 1) - band * rowsPerBand * (rowBytes + 1);
+				adler = adler32_combine(adler, checksums[band], static_cast<z_off_t>(length));
+				stream.insert(stream.end(), compressed[band].begin(), compressed[band].end());
+			}
+
+			png_byte trailer[4];
+			png_save_uint_32(trailer, static_cast<png_uint_32>(adler));
+			stream.insert(stream.end(), trailer, trailer + 4);
+
+			png_byte header[13];
+			png_save_uint_32(header, static_cast<png_uint_32>(layout.width));
+			png_save_uint_32(header + 4, static_cast<png_uint_32>(layout.height));
+			header[8] = static_cast<png_byte>(layout.bit_depth);
+			header[9] = static_cast<png_byte>(GetPngColorSpace(layout.color_space));
+			header[10] = PNG_COMPRESSION_TYPE_DEFAULT;
+			header[11] = PNG_FILTER_TYPE_DEFAULT;
+			header[12] = PNG_INTERLACE_NONE;
+
+			if (ctx.output)
+				ctx.output->reserve(ctx.output->size() + stream.size() + 64 + 12 * (stream.size() / options.buffer_size));
+			else
+				ctx.file = OpenFile(fileName, Mode::Write);
+
+			constexpr png_byte signature[numSignatureBytes]{ 137, 80, 78, 71, 13, 10, 26, 10 };
+			WriteBytes(ctx, signature, sizeof(signature));
+			WriteChunk(ctx, "IHDR", header, sizeof(header));
+
+			for (size_t first = 0; first < stream.size(); first += options.buffer_size)
+				WriteChunk(ctx, "IDAT", stream.data() + first, std::min(options.buffer_size, stream.size() - first));
+
+			WriteChunk(ctx, "IEND", nullptr, 0);
+		}
+
+		template <typename T>
+		Image<T> ReadPlanar(ReadContext& ctx)
+		{
+			const auto& layout = ctx.layout;
+			Image<T> img(layout.height, layout.width, layout.color_space, layout.num_channels);
+			std::vector<T*> planes(layout.num_channels);
+
+			auto deinterleave = [&](T const* row, size_t i)
+				{
+					for (size_t k = 0; k < layout.num_channels; k++)
+						planes[k] = &img(k)(i, 0);
+
+					deinterleave_row(row, layout.num_channels, planes.data(), layout.width);
+				};
+
+			// Interlaced images arrive in several passes over the whole image, they are decoded into one interleaved buffer.
+			// Otherwise every row is split into the channels right after decoding, while it is still in the cache.
+			if (ctx.interlaced)
+			{
+				std::vector<T> buffer(layout.height * layout.width * layout.num_channels);
+				std::vector<png_byte*> rows(layout.height);
+				for (size_t i = 0; i < layout.height; i++)
+					rows[i] = reinterpret_cast<png_byte*>(buffer.data() + i * layout.width * layout.num_channels);
+
+				ReadImage(ctx, rows.data());
+				for (size_t i = 0; i < layout.height; i++)
+					deinterleave(buffer.data() + i * layout.width * layout.num_channels, i);
+			}
+			else
+			{
+				std::vector<T> row(layout.width * layout.num_channels);
+				for (size_t i = 0; i < layout.height; i++)
+				{
+					ReadRow(ctx, reinterpret_cast<png_byte*>(row.data()));
+					deinterleave(row.data(), i);
 				}
+
+				ReadEnd(ctx);
+			}
+
+			return img;
+		}
+
+		void ReadInterleaved(ReadContext& ctx, const std::function<std::uint8_t*(const ImageLayout&)>& allocate)
+		{
+			const size_t rowBytes = png_get_rowbytes(ctx.png, ctx.info);
+			png_byte* data = allocate(ctx.layout);
+
+			std::vector<png_byte*> rows(ctx.layout.height);
+			for (size_t i = 0; i < rows.size(); i++)
+				rows[i] = data + i * rowBytes;
+
+			ReadImage(ctx, rows.data());
+		}
+
+		PngImg ReadPlanar(ReadContext& ctx)
+		{
+			if (ctx.layout.bit_depth == 8)
+				return ReadPlanar<std::uint8_t>(ctx);
+
+			return ReadPlanar<std::uint16_t>(ctx);
+		}
+
+		void Write(WriteContext& ctx, const PngImg& img, std::wstring_view fileName, const PngWriteOptions& options)
+		{
+			const ImgBitDepth8* pImg8 = std::get_if<ImgBitDepth8>(&img);
+			const ImgBitDepth16* pImg16 = std::get_if<ImgBitDepth16>(&img);
+
+			if (pImg8 == nullptr && pImg16 == nullptr)
+				throw std::logic_error("Image type error.");
+
+			if (options.num_threads != 1)
+			{
+				if (pImg8)
+					WriteParallel(ctx, fileName, *pImg8, options);
+				else
+					WriteParallel(ctx, fileName, *pImg16, options);
+
+				return;
+			}
+
+			// Rows are interleaved one at a time into a single buffer.
+			if (pImg8)
+			{
+				OpenWrite(ctx, fileName, ImageLayout{ pImg8->height(), pImg8->width(), pImg8->color_space(), pImg8->num_channels(), 8 }, options);
+				WritePlanar(ctx, *pImg8);
+			}
+			else
+			{
+				OpenWrite(ctx, fileName, ImageLayout{ pImg16->height(), pImg16->width(), pImg16->color_space(), pImg16->num_channels(), 16 }, options);
+				WritePlanar(ctx, *pImg16);
 			}
 		}
+	}
+
+	namespace detail
+	{
+		void ReadInterleaved(std::wstring_view fileName, const std::function<std::uint8_t*(const ImageLayout&)>& allocate)
+		{
+			ReadContext ctx;
+			OpenRead(ctx, fileName);
+			ReadInterleaved(ctx, allocate);
+		}
+
+		void ReadInterleaved(std::span<const std::byte> data, const std::function<std::uint8_t*(const ImageLayout&)>& allocate)
+		{
+			ReadContext ctx;
+			OpenRead(ctx, data);
+			ReadInterleaved(ctx, allocate);
+		}
+	}
+
+	PngImg Read(std::wstring_view fileName)
+	{
+		ReadContext ctx;
+		OpenRead(ctx, fileName);
+		return ReadPlanar(ctx);
+	}
+
+	PngImg Read(std::span<const std::byte> data)
+	{
+		ReadContext ctx;
+		OpenRead(ctx, data);
+		return ReadPlanar(ctx);
+	}
+
+	ImageLayout Probe(std::wstring_view fileName)
+	{
+		std::unique_ptr<FILE, int(*)(FILE*)> file{ OpenFile(fileName, Mode::Read), fclose };
+		imglib::detail::ByteReader reader{ file.get() };
+		return ProbeLayout(reader);
+	}
+
+	ImageLayout Probe(std::span<const std::byte> data)
+	{
+		imglib::detail::ByteReader reader{ data };
+		return ProbeLayout(reader);
+	}
+
+	void Write(const PngImg& img, std::wstring_view fileName, const PngWriteOptions& options)
+	{
+		WriteContext ctx;
+		Write(ctx, img, fileName, options);
+
+		// Errors while flushing the file are only reported by fclose.
+		if (ctx.file && fclose(std::exchange(ctx.file, nullptr)) != 0)
+			throw std::runtime_error("File cannot be written.");
+	}
+
+	std::vector<std::byte> Write(const PngImg& img, const PngWriteOptions& options)
+	{
+		std::vector<std::byte> output;
+		WriteContext ctx;
+		ctx.output = &output;
+		Write(ctx, img, {}, options);
+		return output;
+	}
+
+	struct RowReader::State
+	{
+		ReadContext ctx;
+		size_t rowBytes{ 0 };
+		size_t rowsRead{ 0 };
+		std::vector<png_byte> image;     // interlaced files only
+	};
+
+	RowReader::RowReader(std::wstring_view fileName) : m_state{ std::make_unique<State>() }
+	{
+		OpenRead(m_state->ctx, fileName);
+		m_state->rowBytes = png_get_rowbytes(m_state->ctx.png, m_state->ctx.info);
+	}
+
+	RowReader::~RowReader() = default;
 
-		// write the image.
-		png_write_image(my_png_write_struct, row_pointers);
+	const ImageLayout& RowReader::layout() const noexcept { return m_state->ctx.layout; }
 
-		// Finish the writing.
-		png_write_end(my_png_write_struct, my_png_info_struct);
+	size_t RowReader::row_bytes() const noexcept { return m_state->rowBytes; }
 
-		// Do the memory clean-up.
-		CloseWrite(pFile, my_png_write_struct, my_png_info_struct, row_pointers, height);
+	size_t RowReader::rows_read() const noexcept { return m_state->rowsRead; }
+
+	size_t RowReader::read_rows(std::uint8_t* rows, size_t numRows)
+	{
+		auto& state = *m_state;
+		const size_t height = state.ctx.layout.height;
+		numRows = std::min(numRows, height - state.rowsRead);
+		if (numRows == 0)
+			return 0;
+
+		if (state.ctx.interlaced)
+		{
+			if (state.image.empty())
+			{
+				state.image.resize(height * state.rowBytes);
+				std::vector<png_byte*> rowPointers(height);
+				for (size_t i = 0; i < height; i++)
+					rowPointers[i] = state.image.data() + i * state.rowBytes;
+
+				ReadImage(state.ctx, rowPointers.data());
+			}
+
+			std::copy_n(state.image.data() + state.rowsRead * state.rowBytes, numRows * state.rowBytes, rows);
+		}
+		else
+		{
+			for (size_t i = 0; i < numRows; i++)
+				ReadRow(state.ctx, rows + i * state.rowBytes);
+		}
+
+		state.rowsRead += numRows;
+		if (state.rowsRead == height)
+		{
+			if (state.ctx.interlaced)
+				std::vector<png_byte>{}.swap(state.image);
+			else
+				ReadEnd(state.ctx);
+		}
+
+		return numRows;
+	}
+
+	struct RowWriter::State
+	{
+		WriteContext ctx;
+		size_t rowBytes{ 0 };
+		size_t rowsWritten{ 0 };
+		bool finished{ false };
+	};
+
+	RowWriter::RowWriter(std::wstring_view fileName, const ImageLayout& layout, const PngWriteOptions& options) : m_state{ std::make_unique<State>() }
+	{
+		OpenWrite(m_state->ctx, fileName, layout, options);
+		m_state->rowBytes = layout.width * layout.num_channels * (layout.bit_depth / 8);
+	}
+
+	RowWriter::~RowWriter() = default;
+
+	const ImageLayout& RowWriter::layout() const noexcept { return m_state->ctx.layout; }
+
+	size_t RowWriter::row_bytes() const noexcept { return m_state->rowBytes; }
+
+	size_t RowWriter::rows_written() const noexcept { return m_state->rowsWritten; }
+
+	void RowWriter::write_rows(std::uint8_t const* rows, size_t numRows)
+	{
+		auto& state = *m_state;
+		if (state.finished || numRows > state.ctx.layout.height - state.rowsWritten)
+			throw std::logic_error("More rows than the image has.");
+
+		for (size_t i = 0; i < numRows; i++)
+			WriteRow(state.ctx, rows + i * state.rowBytes);
+
+		state.rowsWritten += numRows;
+	}
+
+	void RowWriter::finish()
+	{
+		auto& state = *m_state;
+		if (state.finished)
+			return;
+
+		if (state.rowsWritten != state.ctx.layout.height)
+			throw std::logic_error("Not all rows are written.");
+
+		WriteEnd(state.ctx);
+		state.finished = true;
+
+		// The file is complete, close it so that it can be opened again while the writer still exists.
+		if (fclose(state.ctx.file) != 0)
+		{
+			state.ctx.file = nullptr;
+			throw std::runtime_error("File cannot be written.");
+		}
+		state.ctx.file = nullptr;
 	}
-}
\ No newline at end of file
+}
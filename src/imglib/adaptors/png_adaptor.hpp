@@ -1,9 +1,19 @@
 #pragma once
 
 #include <png.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <variant>
+#include <vector>
 
 #include <imglib/image/image.hpp>
+#include <imglib/image/cimage.hpp>
+#include <imglib/image/pimage.hpp>
+#include <imglib/image/image_layout.hpp>
 
 namespace imglib::png 
 {
@@ -22,7 +32,182 @@ namespace imglib::png
 		int filter_method{ -1 };
 	};
 
+	namespace detail
+	{
+		// Decodes into interleaved rows of native endian samples. allocate is called once the layout is known and returns
+		// the first row of the destination, the rows follow each other without padding.
+		void ReadInterleaved(std::wstring_view fileName, const std::function<std::uint8_t*(const ImageLayout&)>& allocate);
+
+		void ReadInterleaved(std::span<const std::byte> data, const std::function<std::uint8_t*(const ImageLayout&)>& allocate);
+
+		template <typename T, size_t NumChannels>
+		void CheckLayout(const ImageLayout& layout)
+		{
+			if (layout.num_channels != NumChannels || layout.bit_depth != static_cast<int>(8 * sizeof(T)))
+				throw std::runtime_error("Image type does not match the file.");
+		}
+
+		template <typename T, size_t NumChannels>
+		auto Allocator(CImage<T, NumChannels>& img)
+		{
+			return [&img](const ImageLayout& layout)
+				{
+					CheckLayout<T, NumChannels>(layout);
+					img = CImage<T, NumChannels>{ layout.height, layout.width, layout.color_space };
+					return reinterpret_cast<std::uint8_t*>(&img(0, 0));
+				};
+		}
+
+		template <typename T, size_t NumChannels>
+		auto Allocator(PImage<T, NumChannels>& img)
+		{
+			static_assert(sizeof(Pixel<T, NumChannels>) == NumChannels * sizeof(T), "Pixels are expected to be tightly packed.");
+
+			return [&img](const ImageLayout& layout)
+				{
+					CheckLayout<T, NumChannels>(layout);
+					img = PImage<T, NumChannels>{ layout.height, layout.width, layout.color_space };
+					return reinterpret_cast<std::uint8_t*>(&img(0));
+				};
+		}
+	}
+
+	// Reads only the header chunks, the result is the layout Read decodes the file into: palettes are expanded to RGB,
+	// transparency chunks to an alpha channel and grayscale images with less than 8 bits to 8 bits. Missing image data or
+	// damaged chunks after the header are not detected.
+	ImageLayout Probe(std::wstring_view fileName);
+
+	ImageLayout Probe(std::span<const std::byte> data);
+
 	PngImg Read(std::wstring_view fileName);
 
-	void Write(const PngImg& img, std::wstring_view fileName);
+	// Decodes a png file held in memory, the data is read in place.
+	PngImg Read(std::span<const std::byte> data);
+
+	// Decodes straight into the storage of an interleaved image. T has to match the bit depth of the file and NumChannels
+	// its number of channels.
+	template <typename T, size_t NumChannels>
+	void Read(std::wstring_view fileName, CImage<T, NumChannels>& img)
+	{
+		detail::ReadInterleaved(fileName, detail::Allocator(img));
+	}
+
+	template <typename T, size_t NumChannels>
+	void Read(std::wstring_view fileName, PImage<T, NumChannels>& img)
+	{
+		detail::ReadInterleaved(fileName, detail::Allocator(img));
+	}
+
+	template <typename T, size_t NumChannels>
+	void Read(std::span<const std::byte> data, CImage<T, NumChannels>& img)
+	{
+		detail::ReadInterleaved(data, detail::Allocator(img));
+	}
+
+	template <typename T, size_t NumChannels>
+	void Read(std::span<const std::byte> data, PImage<T, NumChannels>& img)
+	{
+		detail::ReadInterleaved(data, detail::Allocator(img));
+	}
+
+	// zlib strategy of the deflate stream, Filtered suits filtered image rows and Rle is fast with a good ratio on them.
+	enum class CompressionStrategy
+	{
+		Default,
+		Filtered,
+		HuffmanOnly,
+		Rle,
+		Fixed
+	};
+
+	// Filter of every row, or Adaptive to let libpng pick the best one per row.
+	enum class RowFilter
+	{
+		None,
+		Sub,
+		Up,
+		Average,
+		Paeth,
+		Adaptive
+	};
+
+	// The defaults are those of libpng for 8-bit and 16-bit images. Level 1 with Up or Sub filtering and the Rle strategy
+	// encodes several times faster, level 9 with adaptive filtering gives the smallest files.
+	//
+	// With more than one thread Write cuts the image into bands of about 256 KB of filtered rows, which are filtered and
+	// deflated in parallel, in the way of pigz. Each band starts with the end of the band before it as preset dictionary,
+	// so the files are only slightly bigger than with a single thread. The whole image is filtered in memory first.
+	struct PngWriteOptions
+	{
+		int compression_level{ 6 };     // 0 (store) - 9
+		CompressionStrategy strategy{ CompressionStrategy::Filtered };
+		int memory_level{ 8 };          // 1 - 9, zlib memory for the compression state
+		int window_bits{ 15 };          // 8 - 15, log2 of the deflate window size
+		RowFilter filter{ RowFilter::Adaptive };
+		size_t buffer_size{ 8192 };     // bytes of compressed data written to the file at once
+		size_t num_threads{ 1 };        // threads of Write, 0 for one per hardware core; RowWriter always uses one
+	};
+
+	void Write(const PngImg& img, std::wstring_view fileName, const PngWriteOptions& options = PngWriteOptions{});
+
+	// Encodes into memory, the result is the content the file would have.
+	std::vector<std::byte> Write(const PngImg& img, const PngWriteOptions& options = PngWriteOptions{});
+
+	// Decodes a file a few rows at a time, so that only the rows being processed need to be in memory. Rows are interleaved
+	// samples in native byte order, layout().num_channels * layout().bit_depth / 8 bytes per pixel. Interlaced files spread
+	// every row over several passes; those are decoded in full on the first call and handed out from memory.
+	class RowReader
+	{
+	public:
+
+		explicit RowReader(std::wstring_view fileName);
+
+		RowReader(const RowReader&) = delete;
+		RowReader& operator=(const RowReader&) = delete;
+
+		~RowReader();
+
+		const ImageLayout& layout() const noexcept;
+
+		size_t row_bytes() const noexcept;
+
+		// Number of rows decoded so far.
+		size_t rows_read() const noexcept;
+
+		// Decodes up to numRows rows into rows, which are row_bytes() apart. Returns the number of decoded rows, 0 at the end.
+		size_t read_rows(std::uint8_t* rows, size_t numRows);
+
+	private:
+		struct State;
+		std::unique_ptr<State> m_state;
+	};
+
+	// Encodes a file a few rows at a time, the counterpart of RowReader. The file is complete after finish().
+	class RowWriter
+	{
+	public:
+
+		RowWriter(std::wstring_view fileName, const ImageLayout& layout, const PngWriteOptions& options = PngWriteOptions{});
+
+		RowWriter(const RowWriter&) = delete;
+		RowWriter& operator=(const RowWriter&) = delete;
+
+		~RowWriter();
+
+		const ImageLayout& layout() const noexcept;
+
+		size_t row_bytes() const noexcept;
+
+		size_t rows_written() const noexcept;
+
+		// Encodes numRows rows which are row_bytes() apart, at most the rows left of the image.
+		void write_rows(std::uint8_t const* rows, size_t numRows);
+
+		// Writes the end of the file, all rows have to be written by then.
+		void finish();
+
+	private:
+		struct State;
+		std::unique_ptr<State> m_state;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/color/color_conversion.hpp>
+#include <imglib/utility/half.hpp>
+#include <imglib/utility/parallel.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace imglib::algorithm
+{
+    // Dithering applied when the output has fewer levels than the input, for example 16-bit or floating point to 8-bit.
+    enum class Dithering
+    {
+        None,
+        Ordered,        // 8 x 8 Bayer matrix
+        FloydSteinberg  // Error diffusion, the rows are pipelined over the threads
+    };
+
+    namespace detail
+    {
+        // Integer samples use their full range, floating point samples are normalized to [0, 1].
+        template <typename T>
+        concept SampleType = std::same_as<T, std::uint8_t> || std::same_as<T, std::uint16_t> || std::same_as<T, float> || std::same_as<T, half>;
+
+        template <typename T>
+        constexpr bool is_integer_sample = std::is_integral_v<T>;
+
+        template <typename TOut, typename TIn>
+        constexpr bool reduces_depth = is_integer_sample<TOut> && (!is_integer_sample<TIn> || sizeof(TIn) > sizeof(TOut));
+
+        template <typename T>
+        float to_float_sample(T val) noexcept
+        {
+            if constexpr (std::same_as<T, float>)
+                return val;
+            else if constexpr (std::same_as<T, half>)
+                return static_cast<float>(val);
+            else
+                return static_cast<float>(val) * (1.0f / std::numeric_limits<T>::max());
+        }
+
+        // Clamps to [0, max] with NaN going to 0.
+        template <typename T>
+        T round_sample(float val) noexcept
+        {
+            constexpr float max = std::numeric_limits<T>::max();
+            return static_cast<T>(std::min(max, std::max(0.0f, val) + 0.5f));
+        }
+
+        template <typename TOut, typename TIn>
+        TOut convert_sample(TIn val) noexcept
+        {
+            if constexpr (std::same_as<TOut, TIn>)
+                return val;
+            else if constexpr (std::same_as<TIn, std::uint8_t> && std::same_as<TOut, std::uint16_t>)
+                return static_cast<std::uint16_t>(val * 257u);
+            else if constexpr (std::same_as<TIn, std::uint16_t> && std::same_as<TOut, std::uint8_t>)
+                return static_cast<std::uint8_t>((val * 255u + 32895u) >> 16);     // rounded val / 257
+            else if constexpr (std::same_as<TOut, float>)
+                return to_float_sample(val);
+            else if constexpr (std::same_as<TOut, half>)
+                return half{ to_float_sample(val) };
+            else
+                return round_sample<TOut>(to_float_sample(val) * std::numeric_limits<TOut>::max());
+        }
+
+        template <typename TOut, typename TIn>
+        void convert_kernel(TIn const* in, TOut* out, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = convert_sample<TOut>(in[i]);
+        }
+
+        // Input value in units of the output levels.
+        template <typename TOut, typename TIn>
+        float scale_to_levels(TIn val) noexcept
+        {
+            if constexpr (is_integer_sample<TIn>)
+                return static_cast<float>(val) * (static_cast<float>(std::numeric_limits<TOut>::max()) / std::numeric_limits<TIn>::max());
+            else
+                return to_float_sample(val) * std::numeric_limits<TOut>::max();
+        }
+
+        constexpr std::uint8_t bayer_matrix[8][8]
+        {
+            {  0, 32,  8, 40,  2, 34, 10, 42 },
+            { 48, 16, 56, 24, 50, 18, 58, 26 },
+            { 12, 44,  4, 36, 14, 46,  6, 38 },
+            { 60, 28, 52, 20, 62, 30, 54, 22 },
+            {  3, 35, 11, 43,  1, 33,  9, 41 },
+            { 51, 19, 59, 27, 49, 17, 57, 25 },
+            { 15, 47,  7, 39, 13, 45,  5, 37 },
+            { 63, 31, 55, 23, 61, 29, 53, 21 }
+        };
+
+        template <typename TOut, typename TIn>
+        void ordered_dither_row(TIn const* in, TOut* out, size_t row, size_t count) noexcept
+        {
+            constexpr float max = std::numeric_limits<TOut>::max();
+
+            // Thresholds in (0, 1) replace the rounding offset of 0.5.
+            float thresholds[8];
+            for (size_t j = 0; j < 8; j++)
+                thresholds[j] = (bayer_matrix[row & 7][j] + 0.5f) / 64.0f;
+
+            for (size_t i = 0; i < count; i++)
+                out[i] = static_cast<TOut>(std::min(max, std::max(0.0f, scale_to_levels<TOut>(in[i]) + thresholds[i & 7])));
+        }
+
+        // Floyd-Steinberg error diffusion of one channel. A row needs the error of the row above up to one column to the
+        // right, so the rows are dealt out to the threads in turn and each row follows the one above in chunks of columns.
+        // The results do not depend on the number of threads.
+        template <typename TOut, typename TIn>
+        void floyd_steinberg(const Channel<TIn>& in, Channel<TOut>& out, size_t numThreads)
+        {
+            constexpr float max = std::numeric_limits<TOut>::max();
+            constexpr size_t chunkSize{ 64 };
+
+            const size_t height = in.num_rows();
+            const size_t width = in.num_columns();
+            numThreads = std::min(GetNumThreads(numThreads), height);
+
+            // Error diffused into a row, with a column of padding on both sides. A thread reuses a buffer only after its
+            // previous row, the last one reading it, is done.
+            const size_t numBuffers = numThreads + 1;
+            std::vector<float> errors(numBuffers * (width + 2), 0.0f);
+            std::vector<std::atomic<size_t>> progress(height);
+
+            parallel_for(0, numThreads, [&](size_t firstRow, size_t, size_t)
+                {
+                    for (size_t row = firstRow; row < height; row += numThreads)
+                    {
+                        float const* incoming = errors.data() + (row % numBuffers) * (width + 2);
+                        float* next = errors.data() + ((row + 1) % numBuffers) * (width + 2);
+                        TIn const* src = in.data() + row * width;
+                        TOut* dst = &out(row, 0);
+
+                        next[0] = next[1] = 0.0f;
+                        float carry = 0.0f;
+
+                        for (size_t first = 0; first < width; first += chunkSize)
+                        {
+                            size_t last = std::min(first + chunkSize, width);
+                            if (row > 0)
+                            {
+                                size_t needed = std::min(last + 1, width);
+                                while (progress[row - 1].load(std::memory_order_acquire) < needed)
+                                    std::this_thread::yield();
+                            }
+
+                            for (size_t col = first; col < last; col++)
+                            {
+                                float val = scale_to_levels<TOut>(src[col]) + incoming[col + 1] + carry;
+                                float quantized = std::floor(std::min(max, std::max(0.0f, val)) + 0.5f);
+                                float error = val - quantized;
+                                dst[col] = static_cast<TOut>(quantized);
+
+                                carry = error * (7.0f / 16.0f);
+                                next[col + 2] = error * (1.0f / 16.0f);
+                                next[col + 1] += error * (5.0f / 16.0f);
+                                next[col] += error * (3.0f / 16.0f);
+                            }
+
+                            progress[row].store(last, std::memory_order_release);
+                        }
+                    }
+                }, numThreads);
+        }
+    }
+
+    // Converts between 8-bit, 16-bit, float and half samples. Integer samples span their full range and floating point
+    // samples [0, 1], floating point values outside of it are clamped when converted to integers. Dithering is only
+    // applied when the output has fewer levels than the input.
+    template <typename TOut, typename TIn>
+        requires detail::SampleType<TOut> && detail::SampleType<TIn>
+    Image<TOut> convert(const Image<TIn>& img, Dithering dithering = Dithering::None, size_t numThreads = 0)
+    {
+        Image<TOut> outImg{ img.height(), img.width(), img.color_space(), img.num_channels() };
+
+        if constexpr (detail::reduces_depth<TOut, TIn>)
+        {
+            if (dithering == Dithering::Ordered)
+            {
+                parallel_for(0, img.height(), [&](size_t, size_t first, size_t last)
+                    {
+                        for (size_t t = 0; t < img.num_channels(); t++)
+                            for (size_t row = first; row < last; row++)
+                                detail::ordered_dither_row(img(t).data() + row * img.width(), &outImg(t)(row, 0), row, img.width());
+                    }, numThreads);
+
+                return outImg;
+            }
+
+            if (dithering == Dithering::FloydSteinberg)
+            {
+                for (size_t t = 0; t < img.num_channels(); t++)
+                    detail::floyd_steinberg(img(t), outImg(t), numThreads);
+
+                return outImg;
+            }
+        }
+
+        imglib::detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                for (size_t t = 0; t < img.num_channels(); t++)
+                    detail::convert_kernel(img(t).data() + first, &outImg(t)(0) + first, count);
+            });
+
+        return outImg;
+    }
+}
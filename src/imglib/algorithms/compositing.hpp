@@ -0,0 +1,238 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/color/color_conversion.hpp>
+#include <imglib/utility/parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace imglib::algorithm
+{
+    // Straight alpha keeps the color values as they are, premultiplied color values are already scaled by alpha / max.
+    enum class AlphaMode
+    {
+        Straight,
+        Premultiplied
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        using BlendAccumulator = std::conditional_t<sizeof(T) == 1, std::uint32_t, std::uint64_t>;
+
+        // Channel index of alpha, the color channels come before it.
+        inline size_t alpha_index(ColorSpace cs)
+        {
+            if (cs == ColorSpace::RGBA)
+                return 3;
+
+            if (cs == ColorSpace::GrayScaleAlpha)
+                return 1;
+
+            throw std::invalid_argument("Image has no alpha channel.");
+        }
+
+        inline ColorSpace without_alpha(ColorSpace cs) noexcept
+        {
+            return cs == ColorSpace::RGBA ? ColorSpace::RGB : ColorSpace::GrayScale;
+        }
+
+        // ceil(2^24 / d) for every 8-bit divisor.
+        inline const std::array<std::uint32_t, 256>& get_alpha_reciprocals() noexcept
+        {
+            static const std::array<std::uint32_t, 256> table = []()
+                {
+                    std::array<std::uint32_t, 256> t{};
+                    for (std::uint32_t d = 1; d < 256; d++)
+                        t[d] = ((std::uint32_t{ 1 } << 24) + d - 1) / d;
+                    return t;
+                }();
+
+            return table;
+        }
+
+        // Rounded n / d, clamped to max, for n in [0, max * max] and d in [1, max]. 8-bit numerators stay below 2^24 / 255,
+        // so the multiplication with the reciprocal gives the exact quotient.
+        template <typename T>
+        T divide_rounded(BlendAccumulator<T> n, BlendAccumulator<T> d) noexcept
+        {
+            constexpr BlendAccumulator<T> max = std::numeric_limits<T>::max();
+            n += d / 2;
+
+            BlendAccumulator<T> q{};
+            if constexpr (sizeof(T) == 1)
+                q = static_cast<BlendAccumulator<T>>((std::uint64_t{ n } * get_alpha_reciprocals()[d]) >> 24);
+            else
+                q = n / d;
+
+            return static_cast<T>(std::min(q, max));
+        }
+
+        template <typename T>
+        void premultiply_kernel(T* color, T const* alpha, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; i++)
+                color[i] = imglib::detail::divide_by_max<T>(BlendAccumulator<T>{ color[i] } * alpha[i]);
+        }
+
+        template <typename T>
+        void unpremultiply_kernel(T* color, T const* alpha, size_t count) noexcept
+        {
+            constexpr BlendAccumulator<T> max = std::numeric_limits<T>::max();
+            for (size_t i = 0; i < count; i++)
+                color[i] = alpha[i] == 0 ? T{ 0 } : divide_rounded<T>(BlendAccumulator<T>{ color[i] } * max, alpha[i]);
+        }
+
+        // dst = src + dst * (1 - srcAlpha), for premultiplied color values and for alpha itself.
+        template <typename T>
+        void over_premultiplied_kernel(T* dst, T const* src, T const* srcAlpha, size_t count) noexcept
+        {
+            constexpr BlendAccumulator<T> max = std::numeric_limits<T>::max();
+            for (size_t i = 0; i < count; i++)
+            {
+                BlendAccumulator<T> val = src[i] + imglib::detail::divide_by_max<T>(BlendAccumulator<T>{ dst[i] } * (max - srcAlpha[i]));
+                dst[i] = static_cast<T>(std::min(val, max));
+            }
+        }
+
+        // Straight alpha onto an opaque destination: dst = src * srcAlpha + dst * (1 - srcAlpha).
+        template <typename T>
+        void over_opaque_kernel(T* dst, T const* src, T const* srcAlpha, size_t count) noexcept
+        {
+            constexpr BlendAccumulator<T> max = std::numeric_limits<T>::max();
+            for (size_t i = 0; i < count; i++)
+                dst[i] = imglib::detail::divide_by_max<T>(BlendAccumulator<T>{ src[i] } * srcAlpha[i] + BlendAccumulator<T>{ dst[i] } * (max - srcAlpha[i]));
+        }
+
+        // Straight alpha onto a destination with straight alpha. The result is the average of the two colors weighted by
+        // srcAlpha and by the part of dstAlpha that shows through, which sum to the resulting alpha.
+        template <typename T>
+        void over_straight_kernel(T* dst, T const* dstAlpha, T const* src, T const* srcAlpha, size_t count) noexcept
+        {
+            constexpr BlendAccumulator<T> max = std::numeric_limits<T>::max();
+            for (size_t i = 0; i < count; i++)
+            {
+                BlendAccumulator<T> under = imglib::detail::divide_by_max<T>(BlendAccumulator<T>{ dstAlpha[i] } * (max - srcAlpha[i]));
+                BlendAccumulator<T> alpha = srcAlpha[i] + under;
+                dst[i] = alpha == 0 ? T{ 0 } : divide_rounded<T>(BlendAccumulator<T>{ src[i] } * srcAlpha[i] + BlendAccumulator<T>{ dst[i] } * under, alpha);
+            }
+        }
+
+        template <typename T>
+        void lerp_kernel(T const* first, T const* second, T* out, T weight, size_t count) noexcept
+        {
+            constexpr BlendAccumulator<T> max = std::numeric_limits<T>::max();
+            for (size_t i = 0; i < count; i++)
+                out[i] = imglib::detail::divide_by_max<T>(BlendAccumulator<T>{ first[i] } * (max - weight) + BlendAccumulator<T>{ second[i] } * weight);
+        }
+    }
+
+    // Scales the color channels of an RGBA or GrayScaleAlpha image by alpha / max, with exact rounding.
+    template <typename T>
+        requires imglib::detail::ColorConvertible<T>
+    void PremultiplyAlpha(Image<T>& img, size_t numThreads = 0)
+    {
+        const size_t alpha = detail::alpha_index(img.color_space());
+        T const* a = img(alpha).data();
+
+        imglib::detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                for (size_t t = 0; t < alpha; t++)
+                    detail::premultiply_kernel(&img(t)(0) + first, a + first, count);
+            });
+    }
+
+    // Inverse of PremultiplyAlpha, fully transparent pixels become black.
+    template <typename T>
+        requires imglib::detail::ColorConvertible<T>
+    void UnpremultiplyAlpha(Image<T>& img, size_t numThreads = 0)
+    {
+        const size_t alpha = detail::alpha_index(img.color_space());
+        T const* a = img(alpha).data();
+
+        imglib::detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                for (size_t t = 0; t < alpha; t++)
+                    detail::unpremultiply_kernel(&img(t)(0) + first, a + first, count);
+            });
+    }
+
+    // Composites src (RGBA or GrayScaleAlpha) over dst with the top left corner of src at (top, left) of dst. dst has the
+    // color space of src, or the same without alpha, in which case it is treated as opaque. Parts of src outside of dst
+    // are ignored. In premultiplied mode both images are expected to be premultiplied.
+    template <typename T>
+        requires imglib::detail::ColorConvertible<T>
+    void CompositeOver(Image<T>& dst, const Image<T>& src, std::ptrdiff_t top, std::ptrdiff_t left, AlphaMode mode = AlphaMode::Straight, size_t numThreads = 0)
+    {
+        const size_t srcAlpha = detail::alpha_index(src.color_space());
+        const bool dstHasAlpha = dst.color_space() == src.color_space();
+        if (!dstHasAlpha && dst.color_space() != detail::without_alpha(src.color_space()))
+            throw std::invalid_argument("Color spaces of the images do not match.");
+
+        const auto srcHeight = static_cast<std::ptrdiff_t>(src.height());
+        const auto srcWidth = static_cast<std::ptrdiff_t>(src.width());
+        const std::ptrdiff_t rowBegin = std::max<std::ptrdiff_t>(top, 0);
+        const std::ptrdiff_t rowEnd = std::min<std::ptrdiff_t>(top + srcHeight, static_cast<std::ptrdiff_t>(dst.height()));
+        const std::ptrdiff_t colBegin = std::max<std::ptrdiff_t>(left, 0);
+        const std::ptrdiff_t colEnd = std::min<std::ptrdiff_t>(left + srcWidth, static_cast<std::ptrdiff_t>(dst.width()));
+        if (rowBegin >= rowEnd || colBegin >= colEnd)
+            return;
+
+        const auto width = static_cast<size_t>(colEnd - colBegin);
+        const auto numRows = static_cast<size_t>(rowEnd - rowBegin);
+        constexpr size_t minPixelsPerThread{ 1 << 15 };
+        numThreads = std::min(GetNumThreads(numThreads), std::max(numRows * width / minPixelsPerThread, size_t{ 1 }));
+
+        parallel_for(static_cast<size_t>(rowBegin), static_cast<size_t>(rowEnd), [&](size_t, size_t first, size_t last)
+            {
+                for (size_t row = first; row < last; row++)
+                {
+                    const auto srcRow = static_cast<size_t>(static_cast<std::ptrdiff_t>(row) - top);
+                    const auto srcCol = static_cast<size_t>(colBegin - left);
+                    T const* sa = &src(srcAlpha)(srcRow, srcCol);
+
+                    // Straight color needs the destination alpha from before the composition, so alpha is done last.
+                    for (size_t t = 0; t < srcAlpha; t++)
+                    {
+                        T* d = &dst(t)(row, static_cast<size_t>(colBegin));
+                        T const* s = &src(t)(srcRow, srcCol);
+                        if (mode == AlphaMode::Premultiplied)
+                            detail::over_premultiplied_kernel(d, s, sa, width);
+                        else if (dstHasAlpha)
+                            detail::over_straight_kernel(d, &dst(srcAlpha)(row, static_cast<size_t>(colBegin)), s, sa, width);
+                        else
+                            detail::over_opaque_kernel(d, s, sa, width);
+                    }
+
+                    if (dstHasAlpha)
+                        detail::over_premultiplied_kernel(&dst(srcAlpha)(row, static_cast<size_t>(colBegin)), sa, sa, width);
+                }
+            }, numThreads);
+    }
+
+    // Linear interpolation first * (1 - weight / max) + second * weight / max of two images of the same size and layout.
+    template <typename T>
+        requires imglib::detail::ColorConvertible<T>
+    Image<T> Blend(const Image<T>& first, const Image<T>& second, T weight, size_t numThreads = 0)
+    {
+        if (first.height() != second.height() || first.width() != second.width() ||
+            first.color_space() != second.color_space() || first.num_channels() != second.num_channels())
+            throw std::invalid_argument("Images do not match.");
+
+        Image<T> outImg{ first.height(), first.width(), first.color_space(), first.num_channels() };
+
+        imglib::detail::for_each_pixel_range(first.size(), numThreads, [&](size_t begin, size_t count)
+            {
+                for (size_t t = 0; t < first.num_channels(); t++)
+                    detail::lerp_kernel(first(t).data() + begin, second(t).data() + begin, &outImg(t)(0) + begin, weight, count);
+            });
+
+        return outImg;
+    }
+}
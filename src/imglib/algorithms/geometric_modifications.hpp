@@ -1,41 +1,187 @@
 #pragma once
 
 #include <imglib/image/image.hpp>
+#include <imglib/utility/parallel.hpp>
 
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include <concepts>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace imglib::algorithm
 {
+    namespace detail
+    {
+        // Unsigned integers are averaged exactly in integer arithmetic, everything else goes through a double accumulator.
+        template <typename T>
+        concept IntegerShrinkable = std::unsigned_integral<T> && sizeof(T) <= 4;
+
+        // Narrowest accumulator that holds the sum of 4 x 4 values of T, narrow lanes vectorize better.
+        template <typename T>
+        using FixedShrinkAccumulator = std::conditional_t<sizeof(T) == 1, std::uint16_t, std::conditional_t<sizeof(T) == 2, std::uint32_t, std::uint64_t>>;
+
+        // Power of two factors: the rows of a block are summed column-wise first (one add per input value), then each group of
+        // Amount neighbouring column sums is added and divided with round half up by a shift. The loops work on raw spans with
+        // fixed width accumulators so that the compiler vectorizes them.
+        template <typename T, size_t Amount>
+            requires IntegerShrinkable<T> && (Amount == 2 || Amount == 4)
+        void shrink_row(T const* in, size_t stride, T* out, size_t outWidth, std::vector<FixedShrinkAccumulator<T>>& buffer)
+        {
+            using Acc = FixedShrinkAccumulator<T>;
+            constexpr unsigned shift = Amount == 2 ? 2 : 4;
+            constexpr Acc half = Acc{ 1 } << (shift - 1);
+
+            const size_t n = outWidth * Amount;
+            buffer.resize(n);
+            Acc* sums = buffer.data();
+
+            T const* row0 = in;
+            T const* row1 = in + stride;
+            for (size_t j = 0; j < n; j++)
+                sums[j] = static_cast<Acc>(static_cast<Acc>(row0[j]) + row1[j]);
+
+            if constexpr (Amount == 4)
+            {
+                T const* row2 = in + 2 * stride;
+                T const* row3 = in + 3 * stride;
+                for (size_t j = 0; j < n; j++)
+                    sums[j] = static_cast<Acc>(sums[j] + static_cast<Acc>(static_cast<Acc>(row2[j]) + row3[j]));
+            }
+
+            for (size_t j = 0; j < outWidth; j++)
+            {
+                Acc const* s = sums + j * Amount;
+                Acc sum = static_cast<Acc>(s[0] + s[1]);
+                if constexpr (Amount == 4)
+                    sum = static_cast<Acc>(sum + s[2] + s[3]);
+
+                out[j] = static_cast<T>((sum + half) >> shift);
+            }
+        }
+
+        // Any factor: integer column sums over the block rows, then per block sums divided with round half up.
+        template <typename T, typename Acc>
+            requires IntegerShrinkable<T>
+        void shrink_row(T const* in, size_t stride, size_t amount, T* out, size_t outWidth, std::vector<Acc>& buffer)
+        {
+            const size_t n = outWidth * amount;
+            buffer.assign(in, in + n);
+            Acc* sums = buffer.data();
+
+            for (size_t k = 1; k < amount; k++)
+            {
+                T const* row = in + k * stride;
+                for (size_t j = 0; j < n; j++)
+                    sums[j] += row[j];
+            }
+
+            const Acc divisor = static_cast<Acc>(amount * amount);
+            const Acc half = divisor / 2;
+            for (size_t j = 0; j < outWidth; j++)
+            {
+                Acc const* s = sums + j * amount;
+                Acc sum = std::accumulate(s, s + amount, Acc{ 0 });
+                out[j] = static_cast<T>((sum + half) / divisor);
+            }
+        }
+
+        template <typename T>
+        void shrink_row(T const* in, size_t stride, size_t amount, T* out, size_t outWidth)
+        {
+            const double divisor = static_cast<double>(amount * amount);
+            for (size_t j = 0; j < outWidth; j++)
+            {
+                double sum{ 0 };
+                for (size_t k = 0; k < amount; k++)
+                    sum = std::accumulate(in + k * stride + j * amount, in + k * stride + (j + 1) * amount, sum);
+
+                if constexpr (std::is_integral_v<T>)
+                    out[j] = static_cast<T>(std::floor(sum / divisor + 0.5));
+                else
+                    out[j] = static_cast<T>(sum / divisor);
+            }
+        }
+
+        // Shrinks the output rows [firstRow, lastRow) of a channel.
+        template <typename T>
+        void shrink_rows(const Channel<T>& in, Channel<T>& out, size_t amount, size_t firstRow, size_t lastRow)
+        {
+            const size_t stride = in.num_columns();
+            const size_t outWidth = out.num_columns();
+            T* outData = &out(0);
+
+            if constexpr (IntegerShrinkable<T>)
+            {
+                if (amount == 2)
+                {
+                    std::vector<FixedShrinkAccumulator<T>> buffer;
+                    for (size_t i = firstRow; i < lastRow; i++)
+                        shrink_row<T, 2>(in.data() + i * 2 * stride, stride, outData + i * outWidth, outWidth, buffer);
+                }
+                else if (amount == 4)
+                {
+                    std::vector<FixedShrinkAccumulator<T>> buffer;
+                    for (size_t i = firstRow; i < lastRow; i++)
+                        shrink_row<T, 4>(in.data() + i * 4 * stride, stride, outData + i * outWidth, outWidth, buffer);
+                }
+                else if (static_cast<double>(amount) * amount * std::numeric_limits<T>::max() <= std::numeric_limits<std::uint32_t>::max())
+                {
+                    std::vector<std::uint32_t> buffer;
+                    for (size_t i = firstRow; i < lastRow; i++)
+                        shrink_row(in.data() + i * amount * stride, stride, amount, outData + i * outWidth, outWidth, buffer);
+                }
+                else
+                {
+                    std::vector<std::uint64_t> buffer;
+                    for (size_t i = firstRow; i < lastRow; i++)
+                        shrink_row(in.data() + i * amount * stride, stride, amount, outData + i * outWidth, outWidth, buffer);
+                }
+            }
+            else
+            {
+                for (size_t i = firstRow; i < lastRow; i++)
+                    shrink_row(in.data() + i * amount * stride, stride, amount, outData + i * outWidth, outWidth);
+            }
+        }
+    }
+
+    // Reduces the image by an integer factor, every output pixel is the average of an amount x amount block rounded to the
+    // nearest value. Remaining rows and columns that do not fill a whole block are dropped. numThreads = 0 uses one thread
+    // per hardware core.
     template<typename T>
-    Image<T> Shrink(const Image<T>& img, size_t amount)
+    Image<T> Shrink(const Image<T>& img, size_t amount, size_t numThreads = 0)
     {
-        if (img.size() == 0 || amount > img.height() || amount > img.width())
+        if (img.size() == 0 || amount == 0 || amount > img.height() || amount > img.width())
             throw std::invalid_argument("At least one of the arguments is invalid.");
        
         if (amount == 1) 
             return img;
 
         Image<T> outImg(img.height() / amount, img.width() / amount, img.color_space(), img.num_channels());
-        size_t divisor{ amount * amount };
 
-        for (size_t t = 0; t < outImg.num_channels(); ++t)
-        {
-            size_t imgRow{ 0 };
-            for (size_t i = 0; i < outImg.height(); ++i, imgRow += amount)
+        // Output rows of all channels are distributed over the threads, small images are not worth the thread start-up.
+        constexpr size_t minPixelsPerThread{ 1 << 15 };
+        const size_t outHeight = outImg.height();
+        const size_t numRows = outHeight * outImg.num_channels();
+        numThreads = std::min(GetNumThreads(numThreads), std::max(img.size() * img.num_channels() / minPixelsPerThread, size_t{ 1 }));
+
+        parallel_for(0, numRows, [&](size_t, size_t first, size_t last)
             {
-                size_t imgCol{ 0 };
-                for (size_t j = 0; j < outImg.width(); ++j, imgCol += amount)
+                while (first < last)
                 {
-                    double sum{ 0 };
-                    for (size_t k = imgRow; k < imgRow + amount; ++k)
-                        sum = std::accumulate(img(t).git(k, imgCol), img(t).git(k, imgCol + amount), sum);
-
-                    outImg(t)(i, j) = static_cast<T>(sum / divisor);
+                    size_t t = first / outHeight;
+                    size_t row = first % outHeight;
+                    size_t rowEnd = std::min(outHeight, row + (last - first));
+                    detail::shrink_rows(img(t), outImg(t), amount, row, rowEnd);
+                    first += rowEnd - row;
                 }
-            }
-        }
+            }, numThreads);
+
         return outImg;
     }
 }
@@ -2,22 +2,198 @@
 
 #include <vector>
 #include <limits>
+#include <concepts>
+#include <cstdint>
+#include <stdexcept>
 #include <imglib/image/image.hpp>
 #include <imglib/color/color.hpp>
 #include <imglib/utility/utility.hpp>
+#include <imglib/utility/parallel.hpp>
+#include <imglib/utility/simple_geometry.hpp>
+#include <imglib/algorithms/image_generation.hpp>
 
 namespace imglib::algorithm 
 {
+	namespace detail
+	{
+		// 8-bit and 16-bit integer channels are binned through a lookup table indexed by the pixel value.
+		template<typename T>
+		concept LutBinnable = std::integral<T> && sizeof(T) <= 2;
+
+		// Maps a value to its bin: floor((val - min) * numBins / range), the maximum value is put into the last bin.
+		template<typename T>
+		size_t to_bin(T val, size_t numBins) noexcept
+		{
+			if constexpr (std::integral<T> && sizeof(T) <= 4)
+			{
+				constexpr std::uint64_t range = static_cast<std::uint64_t>(static_cast<std::int64_t>(std::numeric_limits<T>::max()) - std::numeric_limits<T>::min());
+				auto offset = static_cast<std::uint64_t>(static_cast<std::int64_t>(val) - std::numeric_limits<T>::min());
+				return std::min(static_cast<size_t>(offset * numBins / range), numBins - 1);
+			}
+			else
+			{
+				constexpr double minVal = std::is_integral_v<T> ? static_cast<double>(std::numeric_limits<T>::min()) : 0.0;
+				constexpr double range = static_cast<double>(std::numeric_limits<T>::max()) - minVal;
+				auto bin = static_cast<size_t>((static_cast<double>(val) - minVal) / range * numBins);
+				return std::min(bin, numBins - 1);
+			}
+		}
+
+		template<typename T>
+			requires LutBinnable<T>
+		std::vector<std::uint32_t> get_bin_lut(size_t numBins)
+		{
+			constexpr size_t lutSize = static_cast<size_t>(std::numeric_limits<T>::max()) - std::numeric_limits<T>::min() + 1;
+			std::vector<std::uint32_t> lut(lutSize);
+
+			T val = std::numeric_limits<T>::min();
+			for (size_t i = 0; i < lutSize; i++, val++)
+				lut[i] = static_cast<std::uint32_t>(to_bin(val, numBins));
+
+			return lut;
+		}
+
+		// Counts into four interleaved sub-histograms so that runs of equal neighbouring pixels do not serialize on
+		// the same counter (store-to-load forwarding stalls). The sub-histograms are merged by add_to.
+		template<typename T>
+		class HistogramCounter
+		{
+		public:
+			HistogramCounter(size_t numBins, std::vector<std::uint32_t> const& lut) : m_numBins{ numBins }, m_lut{ lut }, m_sub(4 * numBins, 0) { }
+
+			void count(T const* first, T const* last)
+			{
+				if (!m_lut.empty())
+				{
+					std::uint32_t const* pLut = m_lut.data();
+					count(first, last, [pLut](T val) { return pLut[static_cast<size_t>(static_cast<std::int64_t>(val) - std::numeric_limits<T>::min())]; });
+				}
+				else
+				{
+					count(first, last, [numBins = m_numBins](T val) { return to_bin(val, numBins); });
+				}
+			}
+
+			void add_to(std::vector<size_t>& histogram) const
+			{
+				size_t const* h = m_sub.data();
+				for (size_t i = 0; i < m_numBins; i++)
+					histogram[i] += h[i] + h[i + m_numBins] + h[i + 2 * m_numBins] + h[i + 3 * m_numBins];
+			}
+
+			void reset() { std::fill(m_sub.begin(), m_sub.end(), 0); }
+
+		private:
+
+			template<typename BinFunc>
+			void count(T const* first, T const* last, BinFunc toBin)
+			{
+				size_t* h0 = m_sub.data();
+				size_t* h1 = h0 + m_numBins;
+				size_t* h2 = h1 + m_numBins;
+				size_t* h3 = h2 + m_numBins;
+
+				for (; last - first >= 4; first += 4)
+				{
+					h0[toBin(first[0])]++;
+					h1[toBin(first[1])]++;
+					h2[toBin(first[2])]++;
+					h3[toBin(first[3])]++;
+				}
+
+				for (; first != last; first++)
+					h0[toBin(*first)]++;
+			}
+
+			size_t m_numBins;
+			std::vector<std::uint32_t> const& m_lut;
+			std::vector<size_t> m_sub;
+		};
+
+		// The lookup table only pays off when there are more pixels than table entries.
+		template<typename T>
+		std::vector<std::uint32_t> get_bin_lut_if_profitable(size_t numPixels, size_t numBins)
+		{
+			if constexpr (LutBinnable<T>)
+			{
+				if (sizeof(T) == 1 || numPixels > (size_t{ 1 } << (8 * sizeof(T))))
+					return get_bin_lut<T>(numBins);
+			}
+
+			return {};
+		}
+	}
+
 	template<typename T>
 	std::vector<size_t> get_histogram(const Channel<T>& ch, size_t numBins)
 	{
+		if (numBins == 0)
+			throw std::invalid_argument("Number of bins should be greater than 0.");
+
 		std::vector<size_t> histogram(numBins, 0);
 
-		auto data_range = std::numeric_limits<T>::max() - std::numeric_limits<T>::min();
-		double step_size = (double)data_range / (double)numBins;
+		auto lut = detail::get_bin_lut_if_profitable<T>(ch.size(), numBins);
+		detail::HistogramCounter<T> counter{ numBins, lut };
+		counter.count(ch.data(), ch.data() + ch.size());
+		counter.add_to(histogram);
 
-		for (auto it = ch.cbegin(); it != ch.cend(); it++)
-			histogram[(size_t)(*it / step_size)]++;
+		return histogram;
+	}
+
+	// Histogram of the pixels inside the given box (inclusive corners, (row, column) order as in algorithm::block).
+	template<typename T>
+	std::vector<size_t> get_histogram(const Channel<T>& ch, const Rectangle2D<size_t>& box, size_t numBins)
+	{
+		if (numBins == 0)
+			throw std::invalid_argument("Number of bins should be greater than 0.");
+
+		if (box.bottom_right()(0) >= ch.num_rows() || box.bottom_right()(1) >= ch.num_columns())
+			throw std::invalid_argument("Box is outside of the channel.");
+
+		std::vector<size_t> histogram(numBins, 0);
+
+		auto lut = detail::get_bin_lut_if_profitable<T>(box.height() * box.width(), numBins);
+		detail::HistogramCounter<T> counter{ numBins, lut };
+		for (size_t row = box.top_left()(0); row <= box.bottom_right()(0); row++)
+		{
+			T const* first = ch.data() + row * ch.num_columns() + box.top_left()(1);
+			counter.count(first, first + box.width());
+		}
+		counter.add_to(histogram);
+
+		return histogram;
+	}
+
+	// Multi-threaded version of get_histogram: each thread counts a contiguous band of pixels into its own histogram,
+	// the per-thread histograms are summed at the end. numThreads = 0 uses one thread per hardware core.
+	template<typename T>
+	std::vector<size_t> get_histogram_parallel(const Channel<T>& ch, size_t numBins, size_t numThreads = 0)
+	{
+		if (numBins == 0)
+			throw std::invalid_argument("Number of bins should be greater than 0.");
+
+		// Below this size starting the threads costs more than counting the pixels.
+		constexpr size_t minPixelsPerThread{ 1 << 16 };
+
+		numThreads = std::min(GetNumThreads(numThreads), std::max(ch.size() / minPixelsPerThread, size_t{ 1 }));
+		if (numThreads == 1)
+			return get_histogram(ch, numBins);
+
+		auto lut = detail::get_bin_lut_if_profitable<T>(ch.size(), numBins);
+		std::vector<std::vector<size_t>> partials(numThreads, std::vector<size_t>(numBins, 0));
+
+		T const* data = ch.data();
+		parallel_for(0, ch.size(), [&](size_t band, size_t first, size_t last)
+			{
+				detail::HistogramCounter<T> counter{ numBins, lut };
+				counter.count(data + first, data + last);
+				counter.add_to(partials[band]);
+			}, numThreads);
+
+		std::vector<size_t> histogram(numBins, 0);
+		for (const auto& partial : partials)
+			for (size_t i = 0; i < numBins; i++)
+				histogram[i] += partial[i];
 
 		return histogram;
 	}
@@ -34,41 +210,82 @@ namespace imglib::algorithm
 		size_t padding{ 12 };
 	};
 
+	namespace detail
+	{
+		// Draws the histogram image of the settings with its top left corner at (row, col) of the image.
+		template<typename T, size_t NumChannels>
+		void render_histogram(Image<T>& img, size_t row, size_t col, const std::vector<double>& normalizedHist, const HistogramImageSettings<T, NumChannels>& settings)
+		{
+			using Point2D = Point<size_t, 2u>;
+
+			size_t height = settings.max_bin_height + 2 * settings.padding;
+			size_t width = settings.bin_width * settings.num_bins + 2 * settings.padding;
+
+			// Set the background color
+			fill_rectangle(img, Rectangle2D<size_t>{ Point2D{ row, col }, height, width }, settings.back);
+
+			// Create the bins using the front color, each bin is a single rectangle fill
+			size_t baseRow = row + height - settings.padding - 1;
+			for (size_t i = 0; i < normalizedHist.size(); i++)
+			{
+				size_t binHeight = static_cast<size_t>(normalizedHist[i] * settings.max_bin_height);
+
+				size_t colStart = col + settings.padding + i * settings.bin_width + 1;
+				size_t colEnd = std::min(colStart + settings.bin_width, col + width);
+
+				if (binHeight == 0 || colStart >= colEnd)
+					continue;
+
+				fill_rectangle(img, Rectangle2D<size_t>{ Point2D{ baseRow - binHeight + 1, colStart }, binHeight, colEnd - colStart }, settings.front);
+			}
+		}
+	}
+
 	template<typename T1, typename T2, size_t NumChannels>
 	Image<T2> get_histogram_image(const Channel<T1>& ch, const HistogramImageSettings<T2, NumChannels>& settings)
 	{
 		auto hist = get_histogram(ch, settings.num_bins);
 		auto normalized_hist = normalize(hist);
-		constexpr auto maxRangeVal = std::numeric_limits<T2>::max();
 
 		size_t height = settings.max_bin_height + 2 * settings.padding;
 		size_t width = settings.bin_width * settings.num_bins + 2 * settings.padding;
 
 		// Create the histogram image
-		auto histogramImg = Image<T2>{ height, width, settings.front.color_space(), NumChannels};
+		auto histogramImg = Image<T2>{ height, width, settings.front.color_space(), NumChannels };
+		detail::render_histogram(histogramImg, 0, 0, normalized_hist, settings);
 
-		// Set the background color
-		histogramImg = settings.back;
+		return histogramImg;
+	}
 
-		// Create the bins using the front color
-		for (size_t i = 0; i < normalized_hist.size(); i++)
-		{
-			size_t bin_height = normalized_hist[i] * settings.max_bin_height;
+	// Renders the histogram images of the channels into a single atlas image, numColumns histograms per atlas row in the order
+	// of the channels. The histograms are computed and drawn in parallel, each into its own tile of the atlas.
+	template<typename T1, typename T2, size_t NumChannels>
+	Image<T2> get_histogram_atlas(const std::vector<Channel<T1> const*>& channels, const HistogramImageSettings<T2, NumChannels>& settings, size_t numColumns, size_t numThreads = 0)
+	{
+		if (channels.empty() || numColumns == 0)
+			throw std::invalid_argument("At least one of the arguments is invalid.");
 
-			if (bin_height == 0)
-				continue;
+		size_t tileHeight = settings.max_bin_height + 2 * settings.padding;
+		size_t tileWidth = settings.bin_width * settings.num_bins + 2 * settings.padding;
+		size_t numRows = (channels.size() + numColumns - 1) / numColumns;
+		numColumns = std::min(numColumns, channels.size());
 
-			size_t col_start = settings.padding + i * settings.bin_width + 1;
-			size_t col_end = col_start + settings.bin_width;
+		auto atlas = Image<T2>{ numRows * tileHeight, numColumns * tileWidth, settings.front.color_space(), NumChannels };
 
-			size_t row_start = histogramImg.height() - settings.padding - 1;
-			size_t row_end = row_start - bin_height;
+		parallel_for(0, numRows * numColumns, [&](size_t, size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					size_t row = (i / numColumns) * tileHeight;
+					size_t col = (i % numColumns) * tileWidth;
 
-			for (size_t col = col_start; col < col_end; col++)
-				for (size_t row = row_start; row > row_end; row--)
-					histogramImg.set_pixel(row, col, settings.front);		
-		}
+					if (i < channels.size())
+						detail::render_histogram(atlas, row, col, normalize(get_histogram(*channels[i], settings.num_bins)), settings);
+					else
+						fill_rectangle(atlas, Rectangle2D<size_t>{ Point<size_t, 2u>{ row, col }, tileHeight, tileWidth }, settings.back);
+				}
+			}, numThreads);
 
-		return histogramImg;
+		return atlas;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <imglib/image/channel.hpp>
+#include <imglib/algorithms/histogram.hpp>
+#include <imglib/utility/utility.hpp>
+#include <imglib/utility/parallel.hpp>
+#include <imglib/utility/simple_geometry.hpp>
+
+namespace imglib::algorithm
+{
+	namespace detail
+	{
+		template<typename T>
+		constexpr size_t num_levels() noexcept { return static_cast<size_t>(std::numeric_limits<T>::max()) - std::numeric_limits<T>::min() + 1; }
+
+		template<typename T>
+		size_t to_level(T val) noexcept { return static_cast<size_t>(static_cast<std::int64_t>(val) - std::numeric_limits<T>::min()); }
+
+		template<typename T>
+		T from_level(double level) noexcept { return static_cast<T>(std::llround(level) + std::numeric_limits<T>::min()); }
+
+		// Cumulative distribution of the histogram normalized to [0, 1].
+		inline std::vector<double> get_cdf(const std::vector<size_t>& histogram)
+		{
+			std::vector<size_t> cumulative(histogram.size());
+			std::partial_sum(histogram.begin(), histogram.end(), cumulative.begin());
+			return normalize(cumulative);
+		}
+
+		// lut is indexed by (value - min), one entry per representable value.
+		template<typename T>
+		Channel<T> apply_lut(const Channel<T>& ch, const std::vector<T>& lut)
+		{
+			Channel<T> out{ ch.num_rows(), ch.num_columns() };
+			std::transform(ch.cbegin(), ch.cend(), out.begin(), [pLut = lut.data()](T val) { return pLut[to_level(val)]; });
+			return out;
+		}
+	}
+
+	// Global histogram equalization, the darkest occupied level is mapped to the minimum of the data range.
+	template<typename T>
+		requires detail::LutBinnable<T>
+	Channel<T> equalize_histogram(const Channel<T>& ch)
+	{
+		if (ch.empty())
+			throw std::invalid_argument("Channel is empty.");
+
+		constexpr size_t numLevels = detail::num_levels<T>();
+		auto cdf = detail::get_cdf(get_histogram(ch, numLevels));
+
+		double cdfMin = *std::find_if(cdf.begin(), cdf.end(), [](double val) { return val > 0; });
+		if (cdfMin >= 1.0)
+			return ch;
+
+		std::vector<T> lut(numLevels);
+		for (size_t i = 0; i < numLevels; i++)
+			lut[i] = detail::from_level<T>(std::max(cdf[i] - cdfMin, 0.0) / (1.0 - cdfMin) * (numLevels - 1));
+
+		return detail::apply_lut(ch, lut);
+	}
+
+	// Maps the intensities of the channel so that its histogram resembles the histogram of the reference channel.
+	template<typename T>
+		requires detail::LutBinnable<T>
+	Channel<T> match_histogram(const Channel<T>& ch, const Channel<T>& reference)
+	{
+		if (ch.empty() || reference.empty())
+			throw std::invalid_argument("Channel is empty.");
+
+		constexpr size_t numLevels = detail::num_levels<T>();
+		auto cdf = detail::get_cdf(get_histogram(ch, numLevels));
+		auto referenceCdf = detail::get_cdf(get_histogram(reference, numLevels));
+
+		// Both cdfs are non-decreasing, walk them together instead of searching for every level.
+		std::vector<T> lut(numLevels);
+		size_t j{ 0 };
+		for (size_t i = 0; i < numLevels; i++)
+		{
+			while (j < numLevels - 1 && referenceCdf[j] < cdf[i])
+				j++;
+
+			lut[i] = detail::from_level<T>(static_cast<double>(j));
+		}
+
+		return detail::apply_lut(ch, lut);
+	}
+
+	struct ClaheSettings
+	{
+		size_t tile_rows{ 8 };		// number of tiles in the vertical direction
+		size_t tile_columns{ 8 };	// number of tiles in the horizontal direction
+		double clip_limit{ 2.0 };	// bins are clipped at clip_limit times the mean bin count, <= 0 disables clipping
+		size_t num_bins{ 256 };		// number of histogram bins per tile, 16-bit channels are quantized to this many levels
+		size_t num_threads{ 0 };	// 0 means one thread per hardware core
+	};
+
+	// Contrast limited adaptive histogram equalization. A clipped histogram and mapping LUT is computed for every tile
+	// in parallel, every pixel is then mapped through the LUTs of the four nearest tiles and bilinearly blended.
+	template<typename T>
+		requires detail::LutBinnable<T>
+	Channel<T> clahe(const Channel<T>& ch, const ClaheSettings& settings = ClaheSettings{})
+	{
+		constexpr size_t numLevels = detail::num_levels<T>();
+
+		if (ch.empty() || settings.tile_rows < 1 || settings.tile_columns < 1 || settings.num_bins < 1 || settings.num_bins > numLevels ||
+			settings.tile_rows > ch.num_rows() || settings.tile_columns > ch.num_columns())
+			throw std::invalid_argument("At least one of the arguments is invalid.");
+
+		const size_t numBins = settings.num_bins;
+		const size_t tileRows = settings.tile_rows;
+		const size_t tileCols = settings.tile_columns;
+
+		std::vector<size_t> rowBounds(tileRows + 1), colBounds(tileCols + 1);
+		for (size_t i = 0; i <= tileRows; i++)
+			rowBounds[i] = i * ch.num_rows() / tileRows;
+		for (size_t i = 0; i <= tileCols; i++)
+			colBounds[i] = i * ch.num_columns() / tileCols;
+
+		// Per-tile mapping from bin to output value.
+		std::vector<T> tileLuts(tileRows * tileCols * numBins);
+
+		parallel_for(0, tileRows * tileCols, [&](size_t, size_t first, size_t last)
+			{
+				for (size_t t = first; t < last; t++)
+				{
+					size_t ty = t / tileCols, tx = t % tileCols;
+					size_t height = rowBounds[ty + 1] - rowBounds[ty];
+					size_t width = colBounds[tx + 1] - colBounds[tx];
+					size_t numPixels = height * width;
+
+					auto hist = get_histogram(ch, Rectangle2D<size_t>{ Point<size_t, 2u>{ rowBounds[ty], colBounds[tx] }, height, width }, numBins);
+
+					if (settings.clip_limit > 0)
+					{
+						auto limit = std::max(static_cast<size_t>(settings.clip_limit * numPixels / numBins), size_t{ 1 });
+
+						size_t excess{ 0 };
+						for (auto& h : hist)
+						{
+							if (h > limit)
+							{
+								excess += h - limit;
+								h = limit;
+							}
+						}
+
+						// Redistribute the clipped counts uniformly, the remainder is spread evenly over the range.
+						size_t increment = excess / numBins;
+						size_t remainder = excess % numBins;
+						for (auto& h : hist)
+							h += increment;
+
+						if (remainder > 0)
+						{
+							size_t step = std::max(numBins / remainder, size_t{ 1 });
+							for (size_t i = 0; i < numBins && remainder > 0; i += step, remainder--)
+								hist[i]++;
+						}
+					}
+
+					T* lut = tileLuts.data() + t * numBins;
+					double scale = static_cast<double>(numLevels - 1) / numPixels;
+					size_t cumulative{ 0 };
+					for (size_t i = 0; i < numBins; i++)
+					{
+						cumulative += hist[i];
+						lut[i] = detail::from_level<T>(std::min(cumulative * scale, static_cast<double>(numLevels - 1)));
+					}
+				}
+			}, settings.num_threads);
+
+		// Interpolation between the centers of the neighbouring tiles, pixels outside the outermost centers use the nearest tile.
+		struct Neighbours
+		{
+			size_t index0;
+			size_t index1;
+			double weight;
+		};
+
+		auto get_neighbours = [](const std::vector<size_t>& bounds, size_t numPositions)
+			{
+				size_t numTiles = bounds.size() - 1;
+				std::vector<Neighbours> neighbours(numPositions);
+
+				size_t tile{ 0 };
+				for (size_t pos = 0; pos < numPositions; pos++)
+				{
+					auto center = [&bounds](size_t i) { return (bounds[i] + bounds[i + 1] - 1) / 2.0; };
+
+					while (tile + 1 < numTiles && center(tile + 1) <= pos)
+						tile++;
+
+					if (pos <= center(0))
+						neighbours[pos] = { 0, 0, 0.0 };
+					else if (tile + 1 == numTiles)
+						neighbours[pos] = { tile, tile, 0.0 };
+					else
+						neighbours[pos] = { tile, tile + 1, (pos - center(tile)) / (center(tile + 1) - center(tile)) };
+				}
+
+				return neighbours;
+			};
+
+		auto rowNeighbours = get_neighbours(rowBounds, ch.num_rows());
+		auto colNeighbours = get_neighbours(colBounds, ch.num_columns());
+		auto binLut = detail::get_bin_lut<T>(numBins);
+
+		Channel<T> out{ ch.num_rows(), ch.num_columns() };
+
+		parallel_for(0, ch.num_rows(), [&](size_t, size_t firstRow, size_t lastRow)
+			{
+				for (size_t row = firstRow; row < lastRow; row++)
+				{
+					const auto& rn = rowNeighbours[row];
+					T const* lutRow0 = tileLuts.data() + rn.index0 * tileCols * numBins;
+					T const* lutRow1 = tileLuts.data() + rn.index1 * tileCols * numBins;
+
+					auto inIt = ch.crow_begin(row);
+					auto outIt = out.row_begin(row);
+					for (size_t col = 0; col < ch.num_columns(); col++, inIt++, outIt++)
+					{
+						const auto& cn = colNeighbours[col];
+						size_t bin = binLut[detail::to_level(*inIt)];
+						size_t offset0 = cn.index0 * numBins + bin;
+						size_t offset1 = cn.index1 * numBins + bin;
+
+						double top = (1.0 - cn.weight) * detail::to_level(lutRow0[offset0]) + cn.weight * detail::to_level(lutRow0[offset1]);
+						double bottom = (1.0 - cn.weight) * detail::to_level(lutRow1[offset0]) + cn.weight * detail::to_level(lutRow1[offset1]);
+						*outIt = detail::from_level<T>((1.0 - rn.weight) * top + rn.weight * bottom);
+					}
+				}
+			}, settings.num_threads);
+
+		return out;
+	}
+}
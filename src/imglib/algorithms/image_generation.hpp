@@ -9,6 +9,31 @@
 
 namespace imglib::algorithm
 {
+    // Fills the box (inclusive corners, (row, column) order) of the channel with the given value.
+    // Each row is filled as one raw span so that std::fill can lower it to memset / vector stores.
+    template <typename T>
+    void fill_rectangle(Channel<T>& ch, const Rectangle2D<size_t>& box, T val)
+    {
+        if (box.bottom_right()(0) >= ch.num_rows() || box.bottom_right()(1) >= ch.num_columns())
+            throw std::invalid_argument("Box is outside of the channel.");
+
+        for (size_t j = box.top_left()(0); j <= box.bottom_right()(0); j++)
+        {
+            T* first = &ch(j, box.top_left()(1));
+            std::fill(first, first + box.width(), val);
+        }
+    }
+
+    template <typename T, size_t NumChannels>
+    void fill_rectangle(Image<T>& img, const Rectangle2D<size_t>& box, const Color<T, NumChannels>& clr)
+    {
+        if (img.num_channels() != NumChannels)
+            throw std::invalid_argument("Channel number mismatch.");
+
+        for (size_t i = 0; i < NumChannels; i++)
+            fill_rectangle(img(i), box, clr(i));
+    }
+
     template <typename T, std::convertible_to<T>... U>
         requires (sizeof...(U) >= 1)
     void block(Image<T>& img, const Rectangle2D<size_t>& box, U... vals)
@@ -17,13 +42,8 @@ namespace imglib::algorithm
             throw std::invalid_argument("Channel number mismatch.");
 
         size_t i{ 0 };
-        for (auto val : { vals... }) 
-        {
-            for (size_t j = box.top_left()(0); j <= box.bottom_right()(0); j++)
-                std::fill(img(i).git(j, box.top_left()(1)), img(i).git(j, box.bottom_right()(1) + 1), val);
-
-            i++;
-        }
+        for (T val : { static_cast<T>(vals)... })
+            fill_rectangle(img(i++), box, val);
     }
 
     template <typename T, std::convertible_to<T>... U>
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/image/channel.hpp>
+#include <imglib/algorithms/geometric_modifications.hpp>
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
+#include <cmath>
+
+namespace imglib::algorithm
+{
+    enum class PyramidFilter
+    {
+        Box,        // 2 x 2 average, level i + 1 is identical to Shrink(level i, 2)
+        Gaussian    // 5 x 5 binomial (1 4 6 4 1) low-pass followed by taking every second row and column
+    };
+
+    // Successive half resolution levels of an image. Level 0 is a copy of the image, level i + 1 is (height / 2) x (width / 2)
+    // of level i. All levels of all channels live in a single allocation and are produced in one streaming pass: as soon as
+    // a row of a level is written, every row of the next levels that depends only on the rows written so far is produced,
+    // so each row is consumed while it is still in the cache.
+    template <typename T>
+    class ImagePyramid
+    {
+    public:
+
+        ImagePyramid() noexcept = default;
+
+        ImagePyramid(const Image<T>& img, size_t numLevels, PyramidFilter filter = PyramidFilter::Box) :
+            m_numChannels{ img.num_channels() },
+            m_colorSpace{ img.color_space() },
+            m_filter{ filter }
+        {
+            if (img.size() == 0 || numLevels < 1)
+                throw std::invalid_argument("At least one of the arguments is invalid.");
+
+            size_t height{ img.height() }, width{ img.width() }, offset{ 0 };
+            for (size_t i = 0; i < numLevels; i++, height /= 2, width /= 2)
+            {
+                if (height < 1 || width < 1)
+                    throw std::invalid_argument("Image is too small for the number of levels.");
+
+                m_levels.push_back(Level{ height, width, offset });
+                offset += height * width * m_numChannels;
+            }
+
+            m_data = std::make_unique<T[]>(offset);
+            build(img);
+        }
+
+        size_t num_levels() const noexcept { return m_levels.size(); }
+
+        size_t num_channels() const noexcept { return m_numChannels; }
+
+        ColorSpace color_space() const noexcept { return m_colorSpace; }
+
+        PyramidFilter filter() const noexcept { return m_filter; }
+
+        size_t height(size_t level) const { return m_levels[level].height; }
+
+        size_t width(size_t level) const { return m_levels[level].width; }
+
+        ChannelView<T> operator()(size_t level, size_t channel) { return ChannelView<T>{ plane(level, channel), height(level), width(level) }; }
+
+        ChannelView<const T> operator()(size_t level, size_t channel) const { return ChannelView<const T>{ plane(level, channel), height(level), width(level) }; }
+
+        // Copies the given level into a new image.
+        Image<T> image(size_t level) const
+        {
+            Image<T> img{ height(level), width(level), m_colorSpace, m_numChannels };
+            for (size_t t = 0; t < m_numChannels; t++)
+                img(t) = (*this)(level, t).to_channel();
+
+            return img;
+        }
+
+    private:
+
+        struct Level
+        {
+            size_t height;
+            size_t width;
+            size_t offset;
+        };
+
+        // Integer pixels are filtered exactly, everything else in double.
+        using Accumulator = std::conditional_t<std::unsigned_integral<T> && sizeof(T) <= 2, std::uint32_t, double>;
+        using FixedShrinkBuffer = std::conditional_t<detail::IntegerShrinkable<T>, detail::FixedShrinkAccumulator<T>, double>;
+
+        T* plane(size_t level, size_t channel) const { return m_data.get() + m_levels[level].offset + channel * m_levels[level].height * m_levels[level].width; }
+
+        // Number of rows of level - 1 that have to exist before the given row of the level can be produced.
+        size_t rows_needed(size_t level, size_t row) const
+        {
+            if (m_filter == PyramidFilter::Box)
+                return 2 * row + 2;
+
+            return std::min(2 * row + 3, m_levels[level - 1].height);
+        }
+
+        void build(const Image<T>& img)
+        {
+            std::vector<size_t> numRowsDone(m_levels.size(), 0);
+            std::vector<Accumulator> buffer;
+            std::vector<FixedShrinkBuffer> shrinkBuffer;
+
+            for (size_t row = 0; row < img.height(); row++)
+            {
+                for (size_t t = 0; t < m_numChannels; t++)
+                    std::copy(img(t).crow_begin(row), img(t).crow_end(row), plane(0, t) + row * img.width());
+
+                numRowsDone[0]++;
+
+                for (size_t l = 1; l < m_levels.size(); l++)
+                {
+                    while (numRowsDone[l] < m_levels[l].height && rows_needed(l, numRowsDone[l]) <= numRowsDone[l - 1])
+                    {
+                        for (size_t t = 0; t < m_numChannels; t++)
+                        {
+                            if (m_filter == PyramidFilter::Box)
+                                box_row(l, t, numRowsDone[l], shrinkBuffer);
+                            else
+                                gaussian_row(l, t, numRowsDone[l], buffer);
+                        }
+
+                        numRowsDone[l]++;
+                    }
+                }
+            }
+        }
+
+        void box_row(size_t level, size_t channel, size_t row, std::vector<FixedShrinkBuffer>& buffer) const
+        {
+            const Level& src = m_levels[level - 1];
+            const Level& dst = m_levels[level];
+            T const* in = plane(level - 1, channel) + 2 * row * src.width;
+            T* out = plane(level, channel) + row * dst.width;
+
+            if constexpr (detail::IntegerShrinkable<T>)
+                detail::shrink_row<T, 2>(in, src.width, out, dst.width, buffer);
+            else
+                detail::shrink_row(in, src.width, 2, out, dst.width);
+        }
+
+        void gaussian_row(size_t level, size_t channel, size_t row, std::vector<Accumulator>& buffer) const
+        {
+            const Level& src = m_levels[level - 1];
+            const Level& dst = m_levels[level];
+            T const* in = plane(level - 1, channel);
+            T* out = plane(level, channel) + row * dst.width;
+
+            // Borders are handled by repeating the edge rows / columns.
+            auto clampRow = [&src](std::ptrdiff_t r) { return in_range(r, src.height); };
+            auto clampCol = [&src](std::ptrdiff_t c) { return in_range(c, src.width); };
+
+            // Vertical pass over the five source rows.
+            auto center = static_cast<std::ptrdiff_t>(2 * row);
+            T const* r0 = in + clampRow(center - 2) * src.width;
+            T const* r1 = in + clampRow(center - 1) * src.width;
+            T const* r2 = in + clampRow(center) * src.width;
+            T const* r3 = in + clampRow(center + 1) * src.width;
+            T const* r4 = in + clampRow(center + 2) * src.width;
+
+            buffer.resize(src.width);
+            Accumulator* v = buffer.data();
+            for (size_t j = 0; j < src.width; j++)
+                v[j] = static_cast<Accumulator>(r0[j]) + r4[j] + 4 * (static_cast<Accumulator>(r1[j]) + r3[j]) + 6 * static_cast<Accumulator>(r2[j]);
+
+            // Horizontal pass at every second column.
+            for (size_t j = 0; j < dst.width; j++)
+            {
+                auto c = static_cast<std::ptrdiff_t>(2 * j);
+                Accumulator sum = v[clampCol(c - 2)] + v[clampCol(c + 2)] + 4 * (v[clampCol(c - 1)] + v[clampCol(c + 1)]) + 6 * v[c];
+
+                if constexpr (std::is_integral_v<Accumulator>)
+                    out[j] = static_cast<T>((sum + 128) >> 8);
+                else if constexpr (std::is_integral_v<T>)
+                    out[j] = static_cast<T>(std::floor(sum / 256.0 + 0.5));
+                else
+                    out[j] = static_cast<T>(sum / 256.0);
+            }
+        }
+
+        static size_t in_range(std::ptrdiff_t i, size_t size) { return static_cast<size_t>(std::clamp<std::ptrdiff_t>(i, 0, static_cast<std::ptrdiff_t>(size) - 1)); }
+
+        size_t m_numChannels{ 0 };
+        ColorSpace m_colorSpace{ ColorSpace::Unspecified };
+        PyramidFilter m_filter{ PyramidFilter::Box };
+        std::vector<Level> m_levels;
+        std::unique_ptr<T[]> m_data{ nullptr };
+    };
+}
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <concepts>
+#include <cstdint>
+#include <stdexcept>
+#include <imglib/image/channel.hpp>
+#include <imglib/algorithms/histogram.hpp>
+#include <imglib/utility/parallel.hpp>
+
+namespace imglib::algorithm
+{
+	// The window around a pixel is (2 * radius + 1) x (2 * radius + 1) and it is clipped at the channel borders.
+	struct LocalStatisticsSettings
+	{
+		size_t radius{ 1 };
+		bool mean{ true };
+		bool variance{ true };
+		bool min_max{ true };
+		size_t num_threads{ 0 };	// 0 means one thread per hardware core
+	};
+
+	// Channels of the statistics that are not requested in the settings are left empty.
+	template<typename T>
+	struct LocalStatistics
+	{
+		Channel<double> mean;
+		Channel<double> variance;
+		Channel<T> min;
+		Channel<T> max;
+	};
+
+	namespace detail
+	{
+		// Sums are exact for 8-bit and 16-bit integers.
+		template<typename T>
+		using LocalSumType = std::conditional_t<std::integral<T> && sizeof(T) <= 2, std::int64_t, double>;
+
+		// Window sums of the rows [firstRow, lastRow). The column sums of the window are updated by one row in and one row out
+		// when moving down and the row sum by one column in and one column out when moving right, so the cost per pixel does
+		// not depend on the radius.
+		template<typename T>
+		void local_mean_variance(const Channel<T>& ch, size_t radius, size_t firstRow, size_t lastRow, Channel<double>* mean, Channel<double>* variance)
+		{
+			using Sum = LocalSumType<T>;
+
+			const size_t rows = ch.num_rows();
+			const size_t cols = ch.num_columns();
+			std::vector<Sum> colSum(cols, 0), colSqSum(cols, 0);
+
+			auto add_row = [&](size_t row, Sum sign)
+				{
+					T const* in = ch.data() + row * cols;
+					for (size_t j = 0; j < cols; j++)
+					{
+						Sum val = static_cast<Sum>(in[j]);
+						colSum[j] += sign * val;
+						colSqSum[j] += sign * val * val;
+					}
+				};
+
+			size_t top = firstRow > radius ? firstRow - radius : 0;
+			size_t bottom = std::min(firstRow + radius, rows - 1);
+			for (size_t i = top; i <= bottom; i++)
+				add_row(i, 1);
+
+			for (size_t row = firstRow; row < lastRow; row++)
+			{
+				if (row > firstRow)
+				{
+					if (row + radius < rows)
+						add_row(row + radius, 1);
+
+					if (row > radius)
+						add_row(row - radius - 1, -1);
+				}
+
+				size_t numWindowRows = std::min(row + radius, rows - 1) - (row > radius ? row - radius : 0) + 1;
+
+				Sum sum{ 0 }, sqSum{ 0 };
+				for (size_t j = 0; j <= std::min(radius, cols - 1); j++)
+				{
+					sum += colSum[j];
+					sqSum += colSqSum[j];
+				}
+
+				for (size_t col = 0; col < cols; col++)
+				{
+					if (col > 0)
+					{
+						if (col + radius < cols)
+						{
+							sum += colSum[col + radius];
+							sqSum += colSqSum[col + radius];
+						}
+
+						if (col > radius)
+						{
+							sum -= colSum[col - radius - 1];
+							sqSum -= colSqSum[col - radius - 1];
+						}
+					}
+
+					size_t numWindowCols = std::min(col + radius, cols - 1) - (col > radius ? col - radius : 0) + 1;
+					double count = static_cast<double>(numWindowRows * numWindowCols);
+					double m = static_cast<double>(sum) / count;
+
+					if (mean)
+						(*mean)(row, col) = m;
+
+					if (variance)
+						(*variance)(row, col) = std::max(static_cast<double>(sqSum) / count - m * m, 0.0);
+				}
+			}
+		}
+
+		// Van Herk / Gil-Werman running extremum over n positions, each position being a run of `width` contiguous values
+		// `stride` apart. Block-wise prefix and suffix extrema make the cost three comparisons per value for any radius.
+		// Processing whole rows as positions lets the vertical pass stream through memory row by row.
+		template<typename T, typename Compare>
+		void running_extremum(T const* in, T* out, size_t n, size_t width, size_t stride, size_t radius, Compare better, std::vector<T>& prefix, std::vector<T>& suffix)
+		{
+			const size_t k = 2 * radius + 1;
+			prefix.resize(n * width);
+			suffix.resize(n * width);
+
+			auto pick = [&better](T a, T b) { return better(b, a) ? b : a; };
+
+			for (size_t blockStart = 0; blockStart < n; blockStart += k)
+			{
+				size_t blockEnd = std::min(blockStart + k, n) - 1;
+
+				std::copy(in + blockStart * stride, in + blockStart * stride + width, prefix.data() + blockStart * width);
+				for (size_t i = blockStart + 1; i <= blockEnd; i++)
+				{
+					T const* src = in + i * stride;
+					T const* prev = prefix.data() + (i - 1) * width;
+					T* dst = prefix.data() + i * width;
+					for (size_t j = 0; j < width; j++)
+						dst[j] = pick(prev[j], src[j]);
+				}
+
+				std::copy(in + blockEnd * stride, in + blockEnd * stride + width, suffix.data() + blockEnd * width);
+				for (size_t i = blockEnd; i-- > blockStart;)
+				{
+					T const* src = in + i * stride;
+					T const* next = suffix.data() + (i + 1) * width;
+					T* dst = suffix.data() + i * width;
+					for (size_t j = 0; j < width; j++)
+						dst[j] = pick(next[j], src[j]);
+				}
+			}
+
+			for (size_t i = 0; i < n; i++)
+			{
+				size_t a = i > radius ? i - radius : 0;
+				size_t b = std::min(i + radius, n - 1);
+				T* dst = out + i * stride;
+
+				// A window that lies in one block starts at the block start or ends at the (clipped) block end.
+				if (a / k != b / k)
+				{
+					T const* s = suffix.data() + a * width;
+					T const* p = prefix.data() + b * width;
+					for (size_t j = 0; j < width; j++)
+						dst[j] = pick(s[j], p[j]);
+				}
+				else if (a % k == 0)
+				{
+					std::copy(prefix.data() + b * width, prefix.data() + (b + 1) * width, dst);
+				}
+				else
+				{
+					std::copy(suffix.data() + a * width, suffix.data() + (a + 1) * width, dst);
+				}
+			}
+		}
+
+		template<typename T, typename Compare>
+		Channel<T> local_extremum(const Channel<T>& ch, size_t radius, Compare better, size_t numThreads)
+		{
+			const size_t rows = ch.num_rows();
+			const size_t cols = ch.num_columns();
+			Channel<T> horizontal{ rows, cols };
+			Channel<T> out{ rows, cols };
+
+			T* pHorizontal = &horizontal(0);
+			T* pOut = &out(0);
+
+			parallel_for(0, rows, [&](size_t, size_t first, size_t last)
+				{
+					std::vector<T> prefix, suffix;
+					for (size_t row = first; row < last; row++)
+						running_extremum(ch.data() + row * cols, pHorizontal + row * cols, cols, 1, 1, radius, better, prefix, suffix);
+				}, numThreads);
+
+			parallel_for(0, cols, [&](size_t, size_t first, size_t last)
+				{
+					std::vector<T> prefix, suffix;
+					running_extremum(static_cast<T const*>(pHorizontal) + first, pOut + first, rows, last - first, cols, radius, better, prefix, suffix);
+				}, numThreads);
+
+			return out;
+		}
+	}
+
+	// Computes the requested local window statistics of every pixel.
+	template<typename T>
+	LocalStatistics<T> get_local_statistics(const Channel<T>& ch, const LocalStatisticsSettings& settings = LocalStatisticsSettings{})
+	{
+		if (ch.empty())
+			throw std::invalid_argument("Channel is empty.");
+
+		LocalStatistics<T> stats;
+		const size_t rows = ch.num_rows();
+		const size_t cols = ch.num_columns();
+
+		if (settings.mean || settings.variance)
+		{
+			if (settings.mean)
+				stats.mean = Channel<double>{ rows, cols };
+
+			if (settings.variance)
+				stats.variance = Channel<double>{ rows, cols };
+
+			Channel<double>* mean = settings.mean ? &stats.mean : nullptr;
+			Channel<double>* variance = settings.variance ? &stats.variance : nullptr;
+
+			parallel_for(0, rows, [&](size_t, size_t first, size_t last)
+				{
+					detail::local_mean_variance(ch, settings.radius, first, last, mean, variance);
+				}, settings.num_threads);
+		}
+
+		if (settings.min_max)
+		{
+			stats.min = detail::local_extremum(ch, settings.radius, std::less<T>{}, settings.num_threads);
+			stats.max = detail::local_extremum(ch, settings.radius, std::greater<T>{}, settings.num_threads);
+		}
+
+		return stats;
+	}
+
+	// Calls func(row, col, histogram) for every pixel in row-major order with the histogram of its window.
+	// A histogram is kept for every column of the window rows and updated by one row in and one row out when moving down,
+	// the window histogram is updated by one column histogram in and one out when moving right (Perreault and Hebert).
+	template<typename T, typename Func>
+	void for_each_local_histogram(const Channel<T>& ch, size_t radius, size_t numBins, Func&& func)
+	{
+		if (ch.empty())
+			throw std::invalid_argument("Channel is empty.");
+
+		if (numBins == 0)
+			throw std::invalid_argument("Number of bins should be greater than 0.");
+
+		const size_t rows = ch.num_rows();
+		const size_t cols = ch.num_columns();
+
+		auto lut = detail::get_bin_lut_if_profitable<T>(ch.size(), numBins);
+		std::vector<size_t> bins(ch.size());
+		if (!lut.empty())
+			std::transform(ch.cbegin(), ch.cend(), bins.begin(), [&lut](T val) { return lut[static_cast<size_t>(static_cast<std::int64_t>(val) - std::numeric_limits<T>::min())]; });
+		else
+			std::transform(ch.cbegin(), ch.cend(), bins.begin(), [numBins](T val) { return detail::to_bin(val, numBins); });
+
+		std::vector<size_t> colHist(cols * numBins, 0);
+		std::vector<size_t> hist(numBins);
+
+		for (size_t i = 0; i <= std::min(radius, rows - 1); i++)
+			for (size_t j = 0; j < cols; j++)
+				colHist[j * numBins + bins[i * cols + j]]++;
+
+		for (size_t row = 0; row < rows; row++)
+		{
+			if (row > 0)
+			{
+				if (row + radius < rows)
+					for (size_t j = 0; j < cols; j++)
+						colHist[j * numBins + bins[(row + radius) * cols + j]]++;
+
+				if (row > radius)
+					for (size_t j = 0; j < cols; j++)
+						colHist[j * numBins + bins[(row - radius - 1) * cols + j]]--;
+			}
+
+			std::fill(hist.begin(), hist.end(), 0);
+			for (size_t j = 0; j <= std::min(radius, cols - 1); j++)
+				for (size_t b = 0; b < numBins; b++)
+					hist[b] += colHist[j * numBins + b];
+
+			for (size_t col = 0; col < cols; col++)
+			{
+				if (col > 0)
+				{
+					if (col + radius < cols)
+						for (size_t b = 0; b < numBins; b++)
+							hist[b] += colHist[(col + radius) * numBins + b];
+
+					if (col > radius)
+						for (size_t b = 0; b < numBins; b++)
+							hist[b] -= colHist[(col - radius - 1) * numBins + b];
+				}
+
+				func(row, col, static_cast<const std::vector<size_t>&>(hist));
+			}
+		}
+	}
+}
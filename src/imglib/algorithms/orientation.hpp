@@ -0,0 +1,374 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/image/channel.hpp>
+#include <imglib/utility/simple_geometry.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMGLIB_ORIENTATION_SSE2     // undefined at the end of the file
+#endif
+
+namespace imglib::algorithm
+{
+    // Clockwise rotations.
+    enum class Rotation
+    {
+        Rotate90,
+        Rotate180,
+        Rotate270
+    };
+
+    namespace detail
+    {
+        // Side of the square tiles the reorientation kernels work on. A source and a destination tile of 8-byte values fit
+        // into the L1 cache together, so both the row-wise reads and the column-wise writes of a tile hit the cache.
+        constexpr size_t orientation_tile{ 32 };
+
+#ifdef IMGLIB_ORIENTATION_SSE2
+        // 8 x 8 transposes held in registers: three rounds of interleaving pairs of rows.
+        inline void transpose_8x8(std::uint8_t const* in, std::ptrdiff_t inStride, std::uint8_t* out, std::ptrdiff_t outStride) noexcept
+        {
+            auto load = [in, inStride](std::ptrdiff_t i) { return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i * inStride)); };
+
+            __m128i a0 = _mm_unpacklo_epi8(load(0), load(1));
+            __m128i a1 = _mm_unpacklo_epi8(load(2), load(3));
+            __m128i a2 = _mm_unpacklo_epi8(load(4), load(5));
+            __m128i a3 = _mm_unpacklo_epi8(load(6), load(7));
+
+            __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+            __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+            __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+            __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+
+            // Each register holds two output rows.
+            const __m128i rows[4]{ _mm_unpacklo_epi32(b0, b2), _mm_unpackhi_epi32(b0, b2), _mm_unpacklo_epi32(b1, b3), _mm_unpackhi_epi32(b1, b3) };
+            for (std::ptrdiff_t i = 0; i < 4; i++)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 2 * i * outStride), rows[i]);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + (2 * i + 1) * outStride), _mm_srli_si128(rows[i], 8));
+            }
+        }
+
+        inline void transpose_8x8(std::uint16_t const* in, std::ptrdiff_t inStride, std::uint16_t* out, std::ptrdiff_t outStride) noexcept
+        {
+            auto load = [in, inStride](std::ptrdiff_t i) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * inStride)); };
+
+            __m128i r[8];
+            for (std::ptrdiff_t i = 0; i < 8; i++)
+                r[i] = load(i);
+
+            __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+            __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+            __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+            __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+            __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+            __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+            __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+            __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+            __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+            __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+            __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+            __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+            __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+            __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+            __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+            __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+            const __m128i rows[8]{
+                _mm_unpacklo_epi64(b0, b4), _mm_unpackhi_epi64(b0, b4), _mm_unpacklo_epi64(b1, b5), _mm_unpackhi_epi64(b1, b5),
+                _mm_unpacklo_epi64(b2, b6), _mm_unpackhi_epi64(b2, b6), _mm_unpacklo_epi64(b3, b7), _mm_unpackhi_epi64(b3, b7) };
+
+            for (std::ptrdiff_t i = 0; i < 8; i++)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * outStride), rows[i]);
+        }
+#endif
+
+        // 8-bit and 16-bit values of any signedness go through the register transposes, bits are only moved.
+        template <typename T>
+        constexpr bool has_register_transpose() noexcept
+        {
+#ifdef IMGLIB_ORIENTATION_SSE2
+            return std::is_trivially_copyable_v<T> && (sizeof(T) == 1 || sizeof(T) == 2);
+#else
+            return false;
+#endif
+        }
+
+        template <typename T>
+        void transpose_tile(T const* in, std::ptrdiff_t inStride, T* out, std::ptrdiff_t outStride, size_t rows, size_t cols) noexcept
+        {
+            size_t i{ 0 };
+            if constexpr (has_register_transpose<T>())
+            {
+#ifdef IMGLIB_ORIENTATION_SSE2
+                using Bits = std::conditional_t<sizeof(T) == 1, std::uint8_t, std::uint16_t>;
+                for (; i + 8 <= rows; i += 8)
+                {
+                    size_t j{ 0 };
+                    for (; j + 8 <= cols; j += 8)
+                    {
+                        auto src = reinterpret_cast<Bits const*>(in + static_cast<std::ptrdiff_t>(i) * inStride + static_cast<std::ptrdiff_t>(j));
+                        auto dst = reinterpret_cast<Bits*>(out + static_cast<std::ptrdiff_t>(j) * outStride + static_cast<std::ptrdiff_t>(i));
+                        transpose_8x8(src, inStride, dst, outStride);
+                    }
+
+                    for (size_t k = i; k < i + 8; k++)
+                        for (size_t l = j; l < cols; l++)
+                            out[static_cast<std::ptrdiff_t>(l) * outStride + static_cast<std::ptrdiff_t>(k)] = in[static_cast<std::ptrdiff_t>(k) * inStride + static_cast<std::ptrdiff_t>(l)];
+                }
+#endif
+            }
+
+            for (; i < rows; i++)
+                for (size_t j = 0; j < cols; j++)
+                    out[static_cast<std::ptrdiff_t>(j) * outStride + static_cast<std::ptrdiff_t>(i)] = in[static_cast<std::ptrdiff_t>(i) * inStride + static_cast<std::ptrdiff_t>(j)];
+        }
+
+        // out(j, i) = in(i, j) for a rows x cols input, tile by tile. The strides are in elements and may be negative, which
+        // turns the transpose into the rotations: a reversed input walks the rows bottom up, a reversed output fills it bottom up.
+        template <typename T>
+        void transpose_copy(T const* in, std::ptrdiff_t inStride, T* out, std::ptrdiff_t outStride, size_t rows, size_t cols) noexcept
+        {
+            for (size_t i = 0; i < rows; i += orientation_tile)
+            {
+                size_t tileRows = std::min(orientation_tile, rows - i);
+                for (size_t j = 0; j < cols; j += orientation_tile)
+                {
+                    size_t tileCols = std::min(orientation_tile, cols - j);
+                    transpose_tile(in + static_cast<std::ptrdiff_t>(i) * inStride + static_cast<std::ptrdiff_t>(j), inStride,
+                        out + static_cast<std::ptrdiff_t>(j) * outStride + static_cast<std::ptrdiff_t>(i), outStride, tileRows, tileCols);
+                }
+            }
+        }
+
+        // Transposes a size x size matrix in place by swapping the tiles above the diagonal with the ones below it.
+        template <typename T>
+        void transpose_in_place(T* data, size_t size) noexcept
+        {
+            for (size_t ib = 0; ib < size; ib += orientation_tile)
+            {
+                size_t iEnd = std::min(ib + orientation_tile, size);
+                for (size_t jb = ib; jb < size; jb += orientation_tile)
+                {
+                    size_t jEnd = std::min(jb + orientation_tile, size);
+                    for (size_t i = ib; i < iEnd; i++)
+                        for (size_t j = std::max(jb, i + 1); j < jEnd; j++)
+                            std::swap(data[i * size + j], data[j * size + i]);
+                }
+            }
+        }
+
+        // Writes the reoriented rows x cols plane into out. The output is cols x rows for the transposing operations.
+        template <typename T>
+        void rotate_plane(T const* in, size_t rows, size_t cols, T* out, Rotation rotation) noexcept
+        {
+            const auto r = static_cast<std::ptrdiff_t>(rows);
+            const auto c = static_cast<std::ptrdiff_t>(cols);
+
+            switch (rotation)
+            {
+            case Rotation::Rotate90:
+                // out(i, j) = in(rows - 1 - j, i)
+                transpose_copy(in + (r - 1) * c, -c, out, r, rows, cols);
+                break;
+            case Rotation::Rotate180:
+                std::reverse_copy(in, in + rows * cols, out);
+                break;
+            case Rotation::Rotate270:
+                // out(i, j) = in(j, cols - 1 - i)
+                transpose_copy(in, c, out + (c - 1) * r, -r, rows, cols);
+                break;
+            }
+        }
+
+        template <typename T>
+        void flip_plane(T const* in, size_t rows, size_t cols, T* out, Orientation2D direction) noexcept
+        {
+            for (size_t i = 0; i < rows; i++)
+            {
+                if (direction == Orientation2D::Horizontal)
+                    std::reverse_copy(in + i * cols, in + (i + 1) * cols, out + i * cols);
+                else
+                    std::copy(in + (rows - 1 - i) * cols, in + (rows - i) * cols, out + i * cols);
+            }
+        }
+
+        template <typename T>
+        void flip_plane_in_place(T* data, size_t rows, size_t cols, Orientation2D direction) noexcept
+        {
+            if (direction == Orientation2D::Horizontal)
+            {
+                for (size_t i = 0; i < rows; i++)
+                    std::reverse(data + i * cols, data + (i + 1) * cols);
+            }
+            else
+            {
+                for (size_t i = 0; i < rows / 2; i++)
+                    std::swap_ranges(data + i * cols, data + (i + 1) * cols, data + (rows - 1 - i) * cols);
+            }
+        }
+
+        template <typename T, typename Func>
+        Image<T> reorient_image(const Image<T>& img, bool transposes, Func&& func)
+        {
+            Image<T> outImg = transposes ? Image<T>(img.width(), img.height(), img.color_space(), img.num_channels()) : Image<T>(img.height(), img.width(), img.color_space(), img.num_channels());
+            if (img.size() > 0)
+                for (size_t t = 0; t < img.num_channels(); t++)
+                    func(img(t).data(), &outImg(t)(0));
+
+            return outImg;
+        }
+    }
+
+    // Mirrors the rows and columns: out(i, j) = ch(j, i).
+    template <typename T>
+    Channel<T> Transpose(const Channel<T>& ch)
+    {
+        Channel<T> out{ ch.num_columns(), ch.num_rows() };
+        detail::transpose_copy(ch.data(), static_cast<std::ptrdiff_t>(ch.num_columns()), &out(0), static_cast<std::ptrdiff_t>(ch.num_rows()), ch.num_rows(), ch.num_columns());
+
+        return out;
+    }
+
+    template <typename T>
+    Image<T> Transpose(const Image<T>& img)
+    {
+        return detail::reorient_image(img, true, [&img](T const* in, T* out) {
+            detail::transpose_copy(in, static_cast<std::ptrdiff_t>(img.width()), out, static_cast<std::ptrdiff_t>(img.height()), img.height(), img.width()); });
+    }
+
+    template <typename T>
+    Channel<T> Rotate(const Channel<T>& ch, Rotation rotation)
+    {
+        bool transposes = rotation != Rotation::Rotate180;
+        Channel<T> out = transposes ? Channel<T>{ ch.num_columns(), ch.num_rows() } : Channel<T>{ ch.num_rows(), ch.num_columns() };
+        detail::rotate_plane(ch.data(), ch.num_rows(), ch.num_columns(), &out(0), rotation);
+
+        return out;
+    }
+
+    template <typename T>
+    Image<T> Rotate(const Image<T>& img, Rotation rotation)
+    {
+        return detail::reorient_image(img, rotation != Rotation::Rotate180, [&img, rotation](T const* in, T* out) {
+            detail::rotate_plane(in, img.height(), img.width(), out, rotation); });
+    }
+
+    // Horizontal mirrors the columns (left-right), Vertical mirrors the rows (top-bottom).
+    template <typename T>
+    Channel<T> Flip(const Channel<T>& ch, Orientation2D direction)
+    {
+        Channel<T> out{ ch.num_rows(), ch.num_columns() };
+        detail::flip_plane(ch.data(), ch.num_rows(), ch.num_columns(), &out(0), direction);
+
+        return out;
+    }
+
+    template <typename T>
+    Image<T> Flip(const Image<T>& img, Orientation2D direction)
+    {
+        return detail::reorient_image(img, false, [&img, direction](T const* in, T* out) {
+            detail::flip_plane(in, img.height(), img.width(), out, direction); });
+    }
+
+    // In place variants. Transposing and the 90 / 270 degree rotations keep the shape only for square channels.
+    template <typename T>
+    void TransposeInPlace(Channel<T>& ch)
+    {
+        if (ch.num_rows() != ch.num_columns())
+            throw std::invalid_argument("Channel is not square.");
+
+        if (!ch.empty())
+            detail::transpose_in_place(&ch(0), ch.num_rows());
+    }
+
+    template <typename T>
+    void RotateInPlace(Channel<T>& ch, Rotation rotation)
+    {
+        if (ch.empty())
+            return;
+
+        if (rotation == Rotation::Rotate180)
+        {
+            std::reverse(&ch(0), &ch(0) + ch.size());
+            return;
+        }
+
+        // A clockwise rotation is a transpose followed by a left-right mirror, the counter clockwise one mirrors top-bottom.
+        TransposeInPlace(ch);
+        detail::flip_plane_in_place(&ch(0), ch.num_rows(), ch.num_columns(), rotation == Rotation::Rotate90 ? Orientation2D::Horizontal : Orientation2D::Vertical);
+    }
+
+    template <typename T>
+    void FlipInPlace(Channel<T>& ch, Orientation2D direction)
+    {
+        if (!ch.empty())
+            detail::flip_plane_in_place(&ch(0), ch.num_rows(), ch.num_columns(), direction);
+    }
+
+    template <typename T>
+    void TransposeInPlace(Image<T>& img)
+    {
+        for (size_t t = 0; t < img.num_channels(); t++)
+            TransposeInPlace(img(t));
+    }
+
+    template <typename T>
+    void RotateInPlace(Image<T>& img, Rotation rotation)
+    {
+        if (rotation != Rotation::Rotate180 && img.height() != img.width())
+            throw std::invalid_argument("Image is not square.");
+
+        for (size_t t = 0; t < img.num_channels(); t++)
+            RotateInPlace(img(t), rotation);
+    }
+
+    template <typename T>
+    void FlipInPlace(Image<T>& img, Orientation2D direction)
+    {
+        for (size_t t = 0; t < img.num_channels(); t++)
+            FlipInPlace(img(t), direction);
+    }
+
+    // Brings an image stored with the given EXIF orientation tag (1 - 8) upright. Every orientation is a single pass.
+    template <typename T>
+    Image<T> ApplyExifOrientation(const Image<T>& img, int orientation)
+    {
+        switch (orientation)
+        {
+        case 1:
+            return img;
+        case 2:
+            return Flip(img, Orientation2D::Horizontal);
+        case 3:
+            return Rotate(img, Rotation::Rotate180);
+        case 4:
+            return Flip(img, Orientation2D::Vertical);
+        case 5:
+            return Transpose(img);
+        case 6:
+            return Rotate(img, Rotation::Rotate90);
+        case 7:
+            // Transverse: out(i, j) = img(height - 1 - j, width - 1 - i)
+            return detail::reorient_image(img, true, [&img](T const* in, T* out) {
+                const auto h = static_cast<std::ptrdiff_t>(img.height());
+                const auto w = static_cast<std::ptrdiff_t>(img.width());
+                detail::transpose_copy(in + (h - 1) * w, -w, out + (w - 1) * h, -h, img.height(), img.width()); });
+        case 8:
+            return Rotate(img, Rotation::Rotate270);
+        default:
+            throw std::invalid_argument("Invalid EXIF orientation.");
+        }
+    }
+}
+
+#undef IMGLIB_ORIENTATION_SSE2
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/algorithms/warp.hpp>
+#include <imglib/utility/parallel.hpp>
+#include <imglib/utility/simple_geometry.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace imglib::algorithm
+{
+    // Source coordinates of every destination pixel for Remap, built once and applied to any number of images of the same
+    // size. An entry takes 6 bytes: 16-bit source column and row plus the two bilinear weights in 1 / 256 steps.
+    // With tile ordering the entries of each tile_size x tile_size destination tile are stored together and Remap processes
+    // the image tile by tile, so the source reads of a tile stay in a small, cache resident area even for strong distortions.
+    class RemapMap
+    {
+    public:
+
+        static constexpr size_t tile_size{ 64 };
+
+        RemapMap() noexcept = default;
+
+        // func(row, col) returns the source position of the destination pixel as Point<double, 2u>{ row, column }. It is
+        // called concurrently from several threads. Positions outside of the source (or NaN) give the border value.
+        template <typename Func>
+        RemapMap(size_t srcHeight, size_t srcWidth, size_t height, size_t width, Func&& func, Interpolation interpolation = Interpolation::Bilinear,
+            bool tileOrdered = false, size_t numThreads = 0) :
+            m_srcHeight{ srcHeight },
+            m_srcWidth{ srcWidth },
+            m_height{ height },
+            m_width{ width },
+            m_interpolation{ interpolation },
+            m_tileOrdered{ tileOrdered }
+        {
+            constexpr auto maxSize = static_cast<size_t>(std::numeric_limits<std::int16_t>::max());
+            if (srcHeight == 0 || srcWidth == 0 || height == 0 || width == 0)
+                throw std::invalid_argument("At least one of the arguments is invalid.");
+
+            if (srcHeight > maxSize || srcWidth > maxSize)
+                throw std::invalid_argument("Source image is too large for 16-bit coordinates.");
+
+            m_xs.resize(height * width);
+            m_ys.resize(height * width);
+            m_fx.resize(height * width);
+            m_fy.resize(height * width);
+
+            parallel_for(0, height, [&](size_t, size_t first, size_t last)
+                {
+                    for (size_t row = first; row < last; row++)
+                        for (size_t col = 0; col < width; col++)
+                            set_entry(index(row, col), func(row, col));
+                }, numThreads);
+        }
+
+        size_t src_height() const noexcept { return m_srcHeight; }
+
+        size_t src_width() const noexcept { return m_srcWidth; }
+
+        size_t height() const noexcept { return m_height; }
+
+        size_t width() const noexcept { return m_width; }
+
+        Interpolation interpolation() const noexcept { return m_interpolation; }
+
+        bool tile_ordered() const noexcept { return m_tileOrdered; }
+
+        // Position of the entry of a destination pixel. The entries of the pixels of a row within one tile are consecutive.
+        size_t index(size_t row, size_t col) const noexcept
+        {
+            if (!m_tileOrdered)
+                return row * m_width + col;
+
+            size_t tileTop = row - row % tile_size;
+            size_t tileLeft = col - col % tile_size;
+            size_t tileHeight = std::min(tile_size, m_height - tileTop);
+            size_t tileWidth = std::min(tile_size, m_width - tileLeft);
+            return tileTop * m_width + tileLeft * tileHeight + (row - tileTop) * tileWidth + (col - tileLeft);
+        }
+
+        std::int16_t const* xs() const noexcept { return m_xs.data(); }
+
+        std::int16_t const* ys() const noexcept { return m_ys.data(); }
+
+        std::uint8_t const* fx() const noexcept { return m_fx.data(); }
+
+        std::uint8_t const* fy() const noexcept { return m_fy.data(); }
+
+    private:
+
+        static constexpr std::int16_t outside{ -1 };
+
+        void set_entry(size_t i, const Point<double, 2u>& pos)
+        {
+            const double y = pos(0);
+            const double x = pos(1);
+            const double maxX = static_cast<double>(m_srcWidth - 1);
+            const double maxY = static_cast<double>(m_srcHeight - 1);
+
+            m_xs[i] = m_ys[i] = outside;
+            m_fx[i] = m_fy[i] = 0;
+
+            if (m_interpolation == Interpolation::Nearest)
+            {
+                if (x >= -0.5 && y >= -0.5 && x < maxX + 0.5 && y < maxY + 0.5)
+                {
+                    m_xs[i] = static_cast<std::int16_t>(std::floor(x + 0.5));
+                    m_ys[i] = static_cast<std::int16_t>(std::floor(y + 0.5));
+                }
+            }
+            else if (x >= 0.0 && y >= 0.0 && x <= maxX && y <= maxY)
+            {
+                // Positions are rounded to 1 / 256 of a pixel like the fixed point positions of Warp.
+                auto px = std::llround(x * 256.0), py = std::llround(y * 256.0);
+                m_xs[i] = static_cast<std::int16_t>(px >> 8);
+                m_ys[i] = static_cast<std::int16_t>(py >> 8);
+                m_fx[i] = static_cast<std::uint8_t>(px & 0xFF);
+                m_fy[i] = static_cast<std::uint8_t>(py & 0xFF);
+            }
+        }
+
+        size_t m_srcHeight{ 0 };
+        size_t m_srcWidth{ 0 };
+        size_t m_height{ 0 };
+        size_t m_width{ 0 };
+        Interpolation m_interpolation{ Interpolation::Bilinear };
+        bool m_tileOrdered{ false };
+        std::vector<std::int16_t> m_xs;
+        std::vector<std::int16_t> m_ys;
+        std::vector<std::uint8_t> m_fx;
+        std::vector<std::uint8_t> m_fy;
+    };
+
+    // Brown-Conrady lens model in pixel units: focal lengths, principal point, radial (k1, k2, k3) and tangential (p1, p2) terms.
+    struct LensDistortion
+    {
+        double fx{ 1.0 };
+        double fy{ 1.0 };
+        double cx{ 0.0 };
+        double cy{ 0.0 };
+        double k1{ 0.0 };
+        double k2{ 0.0 };
+        double k3{ 0.0 };
+        double p1{ 0.0 };
+        double p2{ 0.0 };
+    };
+
+    // Map that removes the lens distortion: every pixel of the undistorted height x width image reads the distorted position.
+    inline RemapMap UndistortionMap(const LensDistortion& lens, size_t height, size_t width, Interpolation interpolation = Interpolation::Bilinear,
+        bool tileOrdered = true, size_t numThreads = 0)
+    {
+        if (lens.fx == 0.0 || lens.fy == 0.0)
+            throw std::invalid_argument("Focal length should not be zero.");
+
+        auto distort = [&lens](size_t row, size_t col)
+            {
+                double x = (col - lens.cx) / lens.fx;
+                double y = (row - lens.cy) / lens.fy;
+                double r2 = x * x + y * y;
+                double radial = 1.0 + r2 * (lens.k1 + r2 * (lens.k2 + r2 * lens.k3));
+                double xd = x * radial + 2.0 * lens.p1 * x * y + lens.p2 * (r2 + 2.0 * x * x);
+                double yd = y * radial + lens.p1 * (r2 + 2.0 * y * y) + 2.0 * lens.p2 * x * y;
+                return Point<double, 2u>{ lens.fy * yd + lens.cy, lens.fx * xd + lens.cx };
+            };
+
+        return RemapMap{ height, width, height, width, distort, interpolation, tileOrdered, numThreads };
+    }
+
+    namespace detail
+    {
+        // Gathers count consecutive entries of the map into out.
+        template <typename T>
+        void remap_sample(T const* plane, size_t srcWidth, const RemapMap& map, size_t first, size_t count, T* out, T borderValue) noexcept
+        {
+            std::int16_t const* xs = map.xs() + first;
+            std::int16_t const* ys = map.ys() + first;
+            std::uint8_t const* fx = map.fx() + first;
+            std::uint8_t const* fy = map.fy() + first;
+
+            if (map.interpolation() == Interpolation::Nearest)
+            {
+                for (size_t j = 0; j < count; j++)
+                    out[j] = xs[j] < 0 ? borderValue : plane[static_cast<size_t>(ys[j]) * srcWidth + static_cast<size_t>(xs[j])];
+
+                return;
+            }
+
+            for (size_t j = 0; j < count; j++)
+            {
+                if (xs[j] < 0)
+                {
+                    out[j] = borderValue;
+                    continue;
+                }
+
+                T const* p = plane + static_cast<size_t>(ys[j]) * srcWidth + static_cast<size_t>(xs[j]);
+                size_t dx = fx[j] != 0 ? 1 : 0;
+                size_t dy = fy[j] != 0 ? srcWidth : 0;
+                out[j] = bilinear_blend(p[0], p[dx], p[dy], p[dy + dx], fx[j], fy[j]);
+            }
+        }
+    }
+
+    // Applies the map to every channel of the image. Destination rows, or rows of tiles for a tile ordered map, are
+    // distributed over the threads.
+    template <typename T>
+    Image<T> Remap(const Image<T>& img, const RemapMap& map, T borderValue = T{}, size_t numThreads = 0)
+    {
+        if (img.height() != map.src_height() || img.width() != map.src_width())
+            throw std::invalid_argument("Image size does not match the map.");
+
+        Image<T> outImg(map.height(), map.width(), img.color_space(), img.num_channels());
+
+        if (!map.tile_ordered())
+        {
+            parallel_for(0, map.height(), [&](size_t, size_t first, size_t last)
+                {
+                    for (size_t row = first; row < last; row++)
+                        for (size_t t = 0; t < img.num_channels(); t++)
+                            detail::remap_sample(img(t).data(), img.width(), map, map.index(row, 0), map.width(), &outImg(t)(row, 0), borderValue);
+                }, numThreads);
+
+            return outImg;
+        }
+
+        const size_t numTileRows = (map.height() + RemapMap::tile_size - 1) / RemapMap::tile_size;
+        parallel_for(0, numTileRows, [&](size_t, size_t first, size_t last)
+            {
+                for (size_t tileRow = first; tileRow < last; tileRow++)
+                {
+                    size_t top = tileRow * RemapMap::tile_size;
+                    size_t bottom = std::min(top + RemapMap::tile_size, map.height());
+                    for (size_t left = 0; left < map.width(); left += RemapMap::tile_size)
+                    {
+                        size_t tileWidth = std::min(RemapMap::tile_size, map.width() - left);
+                        for (size_t t = 0; t < img.num_channels(); t++)
+                            for (size_t row = top; row < bottom; row++)
+                                detail::remap_sample(img(t).data(), img.width(), map, map.index(row, left), tileWidth, &outImg(t)(row, left), borderValue);
+                    }
+                }
+            }, numThreads);
+
+        return outImg;
+    }
+}
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/image/cimage.hpp>
+#include <imglib/image/pimage.hpp>
+#include <imglib/utility/parallel.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace imglib::algorithm
+{
+    enum class ResizeFilter
+    {
+        Bilinear,   // triangle filter, support 1
+        Bicubic,    // Keys cubic convolution with a = -0.5, support 2
+        Lanczos3    // windowed sinc, support 3
+    };
+
+    namespace detail
+    {
+        // Filter weights of one direction. Output position i reads the input positions first[i] .. first[i] + taps - 1,
+        // with weights[i * taps + k]. Every output position has the same number of taps, unused taps have zero weight.
+        struct ResampleWeights
+        {
+            static constexpr int fraction_bits{ 14 };
+
+            size_t taps{ 0 };
+            std::vector<size_t> first;
+            std::vector<std::int32_t> fixed;    // weights in fixed point with fraction_bits, each row sums to exactly 1 << fraction_bits
+            std::vector<double> real;
+        };
+
+        inline double filter_support(ResizeFilter filter) noexcept
+        {
+            switch (filter)
+            {
+            case ResizeFilter::Bilinear:
+                return 1.0;
+            case ResizeFilter::Bicubic:
+                return 2.0;
+            default:
+                return 3.0;
+            }
+        }
+
+        inline double filter_value(ResizeFilter filter, double x) noexcept
+        {
+            x = std::abs(x);
+            switch (filter)
+            {
+            case ResizeFilter::Bilinear:
+                return x < 1.0 ? 1.0 - x : 0.0;
+            case ResizeFilter::Bicubic:
+            {
+                constexpr double a{ -0.5 };
+                if (x < 1.0)
+                    return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+                if (x < 2.0)
+                    return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+                return 0.0;
+            }
+            default:
+            {
+                if (x >= 3.0)
+                    return 0.0;
+                if (x < 1e-8)
+                    return 1.0;
+                double px = std::numbers::pi * x;
+                return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+            }
+            }
+        }
+
+        inline ResampleWeights compute_resample_weights(size_t srcSize, size_t dstSize, ResizeFilter filter)
+        {
+            // When reducing, the filter is stretched by the scale so that it also acts as the anti-aliasing low-pass.
+            double scale = static_cast<double>(srcSize) / dstSize;
+            double filterScale = std::max(scale, 1.0);
+            double support = filter_support(filter) * filterScale;
+
+            ResampleWeights w;
+            w.taps = std::min(static_cast<size_t>(std::ceil(support)) * 2 + 1, srcSize);
+            w.first.resize(dstSize);
+            w.fixed.assign(dstSize * w.taps, 0);
+            w.real.assign(dstSize * w.taps, 0.0);
+
+            for (size_t i = 0; i < dstSize; i++)
+            {
+                double center = (i + 0.5) * scale;
+                auto lo = static_cast<std::ptrdiff_t>(std::floor(center - support));
+                auto hi = static_cast<std::ptrdiff_t>(std::ceil(center + support));
+                lo = std::max<std::ptrdiff_t>(lo, 0);
+                hi = std::min<std::ptrdiff_t>(hi, static_cast<std::ptrdiff_t>(srcSize));
+
+                // Keep the window inside the input, the weights are placed at their offset from first.
+                size_t first = std::min(static_cast<size_t>(lo), srcSize - w.taps);
+                w.first[i] = first;
+
+                double* real = w.real.data() + i * w.taps;
+                double total{ 0 };
+                for (auto x = lo; x < hi && static_cast<size_t>(x) < first + w.taps; x++)
+                {
+                    double val = filter_value(filter, (x + 0.5 - center) / filterScale);
+                    real[x - first] = val;
+                    total += val;
+                }
+
+                if (total != 0.0)
+                    for (size_t k = 0; k < w.taps; k++)
+                        real[k] /= total;
+
+                // Round to fixed point and put the rounding error on the largest weight so that flat areas stay exact.
+                std::int32_t* fixed = w.fixed.data() + i * w.taps;
+                std::int32_t fixedTotal{ 0 };
+                size_t largest{ 0 };
+                for (size_t k = 0; k < w.taps; k++)
+                {
+                    fixed[k] = static_cast<std::int32_t>(std::lround(real[k] * (1 << ResampleWeights::fraction_bits)));
+                    fixedTotal += fixed[k];
+                    if (fixed[k] > fixed[largest])
+                        largest = k;
+                }
+                fixed[largest] += (1 << ResampleWeights::fraction_bits) - fixedTotal;
+            }
+
+            return w;
+        }
+
+        // The weights depend only on the sizes and the filter, they are computed once and shared by later calls.
+        inline std::shared_ptr<const ResampleWeights> get_resample_weights(size_t srcSize, size_t dstSize, ResizeFilter filter)
+        {
+            static std::mutex cacheMutex;
+            static std::map<std::tuple<size_t, size_t, ResizeFilter>, std::shared_ptr<const ResampleWeights>> cache;
+            constexpr size_t maxCacheSize{ 64 };
+
+            auto key = std::make_tuple(srcSize, dstSize, filter);
+            {
+                std::lock_guard lock{ cacheMutex };
+                if (auto it = cache.find(key); it != cache.end())
+                    return it->second;
+            }
+
+            auto weights = std::make_shared<const ResampleWeights>(compute_resample_weights(srcSize, dstSize, filter));
+
+            std::lock_guard lock{ cacheMutex };
+            if (cache.size() >= maxCacheSize)
+                cache.clear();
+
+            cache.emplace(key, weights);
+            return weights;
+        }
+
+        // The horizontal pass of 8-bit and 16-bit integers is done in fixed point and the vertical one in float, everything
+        // else is resampled in double.
+        template <typename T>
+        concept FixedPointResample = std::integral<T> && sizeof(T) <= 2;
+
+        template <typename T>
+        using ResampleAccumulator = std::conditional_t<FixedPointResample<T>, std::conditional_t<sizeof(T) == 1, std::int32_t, std::int64_t>, double>;
+
+        // Samples between the two passes. They are neither rounded nor clamped, so integer outputs are rounded once.
+        template <typename T>
+        using ResampleIntermediate = std::conditional_t<FixedPointResample<T>, float, double>;
+
+        template <typename T, typename Acc>
+        ResampleIntermediate<T> to_intermediate(Acc acc) noexcept
+        {
+            if constexpr (FixedPointResample<T>)
+                return static_cast<float>(acc) * (1.0f / (1 << ResampleWeights::fraction_bits));
+            else
+                return acc;
+        }
+
+        template <typename T, typename U>
+        T resample_result(U val) noexcept
+        {
+            if constexpr (std::is_integral_v<T>)
+                return static_cast<T>(std::clamp<U>(std::floor(val + U{ 0.5 }), std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+            else
+                return static_cast<T>(val);
+        }
+
+        template <typename T>
+        auto resample_weight(const ResampleWeights& w, size_t index) noexcept
+        {
+            if constexpr (FixedPointResample<T>)
+                return static_cast<ResampleAccumulator<T>>(w.fixed[index]);
+            else
+                return w.real[index];
+        }
+
+        // Resamples an interleaved plane of height x width pixels with numChannels values per pixel (1 for the planes of Image).
+        // The horizontal pass writes an intermediate of srcHeight x dstWidth pixels in floating point, the vertical pass
+        // accumulates whole rows of it with one weight per row, which is a contiguous multiply-add over the row that the
+        // compiler vectorizes.
+        template <typename T>
+        void resample_plane(T const* in, size_t srcHeight, size_t srcWidth, T* out, size_t dstHeight, size_t dstWidth, size_t numChannels, ResizeFilter filter, size_t numThreads)
+        {
+            using Acc = ResampleAccumulator<T>;
+            using Intermediate = ResampleIntermediate<T>;
+
+            auto xw = get_resample_weights(srcWidth, dstWidth, filter);
+            auto yw = get_resample_weights(srcHeight, dstHeight, filter);
+
+            const size_t srcRowLen = srcWidth * numChannels;
+            const size_t dstRowLen = dstWidth * numChannels;
+            std::vector<Intermediate> intermediate(srcHeight * dstRowLen);
+
+            parallel_for(0, srcHeight, [&](size_t, size_t firstRow, size_t lastRow)
+                {
+                    for (size_t row = firstRow; row < lastRow; row++)
+                    {
+                        T const* src = in + row * srcRowLen;
+                        Intermediate* dst = intermediate.data() + row * dstRowLen;
+
+                        for (size_t j = 0; j < dstWidth; j++)
+                        {
+                            T const* px = src + xw->first[j] * numChannels;
+                            size_t w0 = j * xw->taps;
+                            for (size_t c = 0; c < numChannels; c++)
+                            {
+                                Acc acc{ 0 };
+                                for (size_t k = 0; k < xw->taps; k++)
+                                    acc += resample_weight<T>(*xw, w0 + k) * static_cast<Acc>(px[k * numChannels + c]);
+
+                                dst[j * numChannels + c] = to_intermediate<T>(acc);
+                            }
+                        }
+                    }
+                }, numThreads);
+
+            parallel_for(0, dstHeight, [&](size_t, size_t firstRow, size_t lastRow)
+                {
+                    std::vector<Intermediate> rowAcc(dstRowLen);
+                    for (size_t row = firstRow; row < lastRow; row++)
+                    {
+                        std::fill(rowAcc.begin(), rowAcc.end(), Intermediate{ 0 });
+                        Intermediate* acc = rowAcc.data();
+
+                        for (size_t k = 0; k < yw->taps; k++)
+                        {
+                            const auto weight = static_cast<Intermediate>(yw->real[row * yw->taps + k]);
+                            if (weight == 0)
+                                continue;
+
+                            Intermediate const* src = intermediate.data() + (yw->first[row] + k) * dstRowLen;
+                            for (size_t j = 0; j < dstRowLen; j++)
+                                acc[j] += weight * src[j];
+                        }
+
+                        T* dst = out + row * dstRowLen;
+                        for (size_t j = 0; j < dstRowLen; j++)
+                            dst[j] = resample_result<T>(acc[j]);
+                    }
+                }, numThreads);
+        }
+    }
+
+    // Resizes the image to height x width with a separable filter. Works for any scale factor in both directions.
+    // numThreads = 0 uses one thread per hardware core.
+    template <typename T>
+    Image<T> Resize(const Image<T>& img, size_t height, size_t width, ResizeFilter filter = ResizeFilter::Bicubic, size_t numThreads = 0)
+    {
+        if (img.size() == 0 || height == 0 || width == 0)
+            throw std::invalid_argument("At least one of the arguments is invalid.");
+
+        Image<T> outImg(height, width, img.color_space(), img.num_channels());
+        for (size_t t = 0; t < img.num_channels(); t++)
+            detail::resample_plane(img(t).data(), img.height(), img.width(), &outImg(t)(0), height, width, 1, filter, numThreads);
+
+        return outImg;
+    }
+
+    template <typename T, size_t NumChannels>
+    CImage<T, NumChannels> Resize(const CImage<T, NumChannels>& img, size_t height, size_t width, ResizeFilter filter = ResizeFilter::Bicubic, size_t numThreads = 0)
+    {
+        if (img.size() == 0 || height == 0 || width == 0)
+            throw std::invalid_argument("At least one of the arguments is invalid.");
+
+        CImage<T, NumChannels> outImg(height, width, img.color_space());
+        detail::resample_plane(img.data(), img.height(), img.width(), &outImg(0, 0), height, width, NumChannels, filter, numThreads);
+
+        return outImg;
+    }
+
+    template <typename T, size_t NumChannels>
+    PImage<T, NumChannels> Resize(const PImage<T, NumChannels>& img, size_t height, size_t width, ResizeFilter filter = ResizeFilter::Bicubic, size_t numThreads = 0)
+    {
+        static_assert(sizeof(Pixel<T, NumChannels>) == NumChannels * sizeof(T), "Pixels are expected to be tightly packed.");
+
+        if (img.size() == 0 || height == 0 || width == 0)
+            throw std::invalid_argument("At least one of the arguments is invalid.");
+
+        PImage<T, NumChannels> outImg(height, width, img.color_space());
+        detail::resample_plane(reinterpret_cast<T const*>(&img(0)), img.height(), img.width(), reinterpret_cast<T*>(&outImg(0)), height, width, NumChannels, filter, numThreads);
+
+        return outImg;
+    }
+}
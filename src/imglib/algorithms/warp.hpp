@@ -0,0 +1,318 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/utility/parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace imglib::algorithm
+{
+    enum class Interpolation
+    {
+        Nearest,
+        Bilinear
+    };
+
+    // Homogeneous 3 x 3 matrix in row-major order. It maps the (column, row, 1) coordinates of a source pixel to the destination.
+    using Transform2D = std::array<double, 9>;
+
+    inline Transform2D AffineTransform(double a00, double a01, double a02, double a10, double a11, double a12) noexcept
+    {
+        return Transform2D{ a00, a01, a02, a10, a11, a12, 0.0, 0.0, 1.0 };
+    }
+
+    inline Transform2D InvertTransform(const Transform2D& m)
+    {
+        Transform2D inv{
+            m[4] * m[8] - m[5] * m[7], m[2] * m[7] - m[1] * m[8], m[1] * m[5] - m[2] * m[4],
+            m[5] * m[6] - m[3] * m[8], m[0] * m[8] - m[2] * m[6], m[2] * m[3] - m[0] * m[5],
+            m[3] * m[7] - m[4] * m[6], m[1] * m[6] - m[0] * m[7], m[0] * m[4] - m[1] * m[3] };
+
+        double det = m[0] * inv[0] + m[1] * inv[3] + m[2] * inv[6];
+        if (std::abs(det) < std::numeric_limits<double>::epsilon())
+            throw std::invalid_argument("Transform is not invertible.");
+
+        // Scaled so that the last element is 1, which keeps affine transforms recognizable as such.
+        double scale = std::abs(inv[8]) > std::numeric_limits<double>::epsilon() * std::abs(det) ? inv[8] : det;
+        for (auto& val : inv)
+            val /= scale;
+
+        return inv;
+    }
+
+    struct WarpSettings
+    {
+        Interpolation interpolation{ Interpolation::Bilinear };
+        size_t num_threads{ 0 };    // 0 means one thread per hardware core
+    };
+
+    namespace detail
+    {
+        // Source positions are walked in fixed point with 32 fraction bits, the bilinear weights are rounded to 8 of them.
+        constexpr int warp_position_bits{ 32 };
+        constexpr int warp_fraction_bits{ 8 };
+        constexpr std::int32_t warp_outside{ -1 };
+        constexpr std::int64_t warp_invalid_position{ std::numeric_limits<std::int64_t>::min() / 4 };
+
+        // Limit of the source coordinates handled in fixed point, positions beyond it are outside of every image anyway.
+        constexpr double warp_position_limit{ 1 << 30 };
+
+        inline std::int64_t to_warp_position(double val) noexcept
+        {
+            return std::llround(std::clamp(val, -warp_position_limit, warp_position_limit) * (std::int64_t{ 1 } << warp_position_bits));
+        }
+
+        struct WarpRowBuffers
+        {
+            std::vector<std::int64_t> xs;
+            std::vector<std::int64_t> ys;
+        };
+
+        // Source coordinates of one destination row. offsets[j] is the index of the (top-left) source pixel or warp_outside,
+        // fx and fy are the bilinear weights of the right and bottom neighbours in 1 / 256 steps.
+        inline void warp_row_coordinates(const Transform2D& inverse, size_t srcHeight, size_t srcWidth, size_t row, size_t width, Interpolation interpolation,
+            std::int32_t* offsets, std::uint8_t* fx, std::uint8_t* fy, WarpRowBuffers& buffers)
+        {
+            buffers.xs.resize(width);
+            buffers.ys.resize(width);
+            std::int64_t* xs = buffers.xs.data();
+            std::int64_t* ys = buffers.ys.data();
+
+            const double y = static_cast<double>(row);
+            const bool affine = inverse[6] == 0.0 && inverse[7] == 0.0;
+            const double x0 = inverse[1] * y + inverse[2];
+            const double y0 = inverse[4] * y + inverse[5];
+
+            if (affine && std::abs(x0) + std::abs(inverse[0]) * width < warp_position_limit && std::abs(y0) + std::abs(inverse[3]) * width < warp_position_limit)
+            {
+                // Affine rows are linear in fixed point, every position is the row start plus j steps, so there is no drift.
+                const std::int64_t startX = to_warp_position(x0), stepX = to_warp_position(inverse[0]);
+                const std::int64_t startY = to_warp_position(y0), stepY = to_warp_position(inverse[3]);
+                for (size_t j = 0; j < width; j++)
+                {
+                    xs[j] = startX + static_cast<std::int64_t>(j) * stepX;
+                    ys[j] = startY + static_cast<std::int64_t>(j) * stepY;
+                }
+            }
+            else
+            {
+                // Perspective rows need one division per pixel, points at or behind the horizon are outside.
+                const double w0 = inverse[7] * y + inverse[8];
+                for (size_t j = 0; j < width; j++)
+                {
+                    const double x = static_cast<double>(j);
+                    const double w = inverse[6] * x + w0;
+                    const double scale = w > std::numeric_limits<double>::epsilon() ? 1.0 / w : 0.0;
+                    xs[j] = w > std::numeric_limits<double>::epsilon() ? to_warp_position((inverse[0] * x + x0) * scale) : warp_invalid_position;
+                    ys[j] = w > std::numeric_limits<double>::epsilon() ? to_warp_position((inverse[3] * x + y0) * scale) : warp_invalid_position;
+                }
+            }
+
+            constexpr std::int64_t one = std::int64_t{ 1 } << warp_position_bits;
+            constexpr int fractionShift = warp_position_bits - warp_fraction_bits;
+            const std::int64_t h = static_cast<std::int64_t>(srcHeight);
+            const std::int64_t w = static_cast<std::int64_t>(srcWidth);
+
+            if (interpolation == Interpolation::Nearest)
+            {
+                for (size_t j = 0; j < width; j++)
+                {
+                    std::int64_t ix = (xs[j] + one / 2) >> warp_position_bits;
+                    std::int64_t iy = (ys[j] + one / 2) >> warp_position_bits;
+                    bool inside = xs[j] >= -one / 2 && ys[j] >= -one / 2 && ix < w && iy < h;
+                    offsets[j] = inside ? static_cast<std::int32_t>(iy * w + ix) : warp_outside;
+                    fx[j] = 0;
+                    fy[j] = 0;
+                }
+            }
+            else
+            {
+                // A position on the last column / row has zero weight for the neighbour beyond it, which is never read.
+                const std::int64_t maxX = (w - 1) * one;
+                const std::int64_t maxY = (h - 1) * one;
+                // Positions are rounded to the weight resolution, which keeps them on the pixel grid despite rounding errors.
+                constexpr std::int64_t half = std::int64_t{ 1 } << (fractionShift - 1);
+                for (size_t j = 0; j < width; j++)
+                {
+                    bool inside = xs[j] >= 0 && ys[j] >= 0 && xs[j] <= maxX && ys[j] <= maxY;
+                    std::int64_t x = xs[j] + half, y = ys[j] + half;
+                    offsets[j] = inside ? static_cast<std::int32_t>((y >> warp_position_bits) * w + (x >> warp_position_bits)) : warp_outside;
+                    fx[j] = static_cast<std::uint8_t>((x >> fractionShift) & 0xFF);
+                    fy[j] = static_cast<std::uint8_t>((y >> fractionShift) & 0xFF);
+                }
+            }
+        }
+
+        // 8-bit and 16-bit integers are blended exactly in integer arithmetic, everything else in double.
+        template <typename T>
+        using BilinearAccumulator = std::conditional_t<std::unsigned_integral<T> && sizeof(T) <= 2, std::uint32_t,
+            std::conditional_t<std::signed_integral<T> && sizeof(T) <= 2, std::int64_t, double>>;
+
+        template <typename T>
+        T bilinear_blend(T p00, T p01, T p10, T p11, std::uint8_t fx, std::uint8_t fy) noexcept
+        {
+            using Acc = BilinearAccumulator<T>;
+            constexpr Acc one{ 1 << warp_fraction_bits };
+
+            Acc top = static_cast<Acc>(p00) * (one - fx) + static_cast<Acc>(p01) * fx;
+            Acc bottom = static_cast<Acc>(p10) * (one - fx) + static_cast<Acc>(p11) * fx;
+            Acc sum = top * (one - fy) + bottom * fy;
+
+            if constexpr (std::is_integral_v<Acc>)
+                return static_cast<T>((sum + (Acc{ 1 } << (2 * warp_fraction_bits - 1))) >> (2 * warp_fraction_bits));
+            else if constexpr (std::is_integral_v<T>)
+                return static_cast<T>(std::floor(sum / (one * one) + 0.5));
+            else
+                return static_cast<T>(sum / (one * one));
+        }
+
+        template <typename T>
+        void warp_sample_row(T const* plane, size_t srcWidth, std::int32_t const* offsets, std::uint8_t const* fx, std::uint8_t const* fy,
+            T* out, size_t width, Interpolation interpolation, T borderValue) noexcept
+        {
+            if (interpolation == Interpolation::Nearest)
+            {
+                for (size_t j = 0; j < width; j++)
+                    out[j] = offsets[j] == warp_outside ? borderValue : plane[offsets[j]];
+
+                return;
+            }
+
+            for (size_t j = 0; j < width; j++)
+            {
+                if (offsets[j] == warp_outside)
+                {
+                    out[j] = borderValue;
+                    continue;
+                }
+
+                // Zero weight neighbours are replaced by the pixel itself so that nothing past the last column / row is read.
+                T const* p = plane + offsets[j];
+                size_t dx = fx[j] != 0 ? 1 : 0;
+                size_t dy = fy[j] != 0 ? srcWidth : 0;
+                out[j] = bilinear_blend(p[0], p[dx], p[dy], p[dy + dx], fx[j], fy[j]);
+            }
+        }
+
+        inline void check_warp_arguments(size_t srcHeight, size_t srcWidth, size_t height, size_t width)
+        {
+            if (srcHeight == 0 || srcWidth == 0 || height == 0 || width == 0)
+                throw std::invalid_argument("At least one of the arguments is invalid.");
+
+            if (srcHeight * srcWidth > static_cast<size_t>(std::numeric_limits<std::int32_t>::max()))
+                throw std::invalid_argument("Image is too large.");
+        }
+    }
+
+    // Source coordinates of every destination pixel of a warp, computed once and applied to any number of images of the
+    // same size with Warp(img, map). Takes 6 bytes per destination pixel.
+    class WarpMap
+    {
+    public:
+
+        WarpMap() noexcept = default;
+
+        WarpMap(const Transform2D& transform, size_t srcHeight, size_t srcWidth, size_t height, size_t width, Interpolation interpolation = Interpolation::Bilinear, size_t numThreads = 0) :
+            m_srcHeight{ srcHeight },
+            m_srcWidth{ srcWidth },
+            m_height{ height },
+            m_width{ width },
+            m_interpolation{ interpolation }
+        {
+            detail::check_warp_arguments(srcHeight, srcWidth, height, width);
+
+            const Transform2D inverse = InvertTransform(transform);
+            m_offsets.resize(height * width);
+            m_fx.resize(height * width);
+            m_fy.resize(height * width);
+
+            parallel_for(0, height, [&](size_t, size_t first, size_t last)
+                {
+                    detail::WarpRowBuffers buffers;
+                    for (size_t row = first; row < last; row++)
+                        detail::warp_row_coordinates(inverse, srcHeight, srcWidth, row, width, interpolation, &m_offsets[row * width], &m_fx[row * width], &m_fy[row * width], buffers);
+                }, numThreads);
+        }
+
+        size_t src_height() const noexcept { return m_srcHeight; }
+
+        size_t src_width() const noexcept { return m_srcWidth; }
+
+        size_t height() const noexcept { return m_height; }
+
+        size_t width() const noexcept { return m_width; }
+
+        Interpolation interpolation() const noexcept { return m_interpolation; }
+
+        std::int32_t const* offsets(size_t row) const { return m_offsets.data() + row * m_width; }
+
+        std::uint8_t const* fx(size_t row) const { return m_fx.data() + row * m_width; }
+
+        std::uint8_t const* fy(size_t row) const { return m_fy.data() + row * m_width; }
+
+    private:
+
+        size_t m_srcHeight{ 0 };
+        size_t m_srcWidth{ 0 };
+        size_t m_height{ 0 };
+        size_t m_width{ 0 };
+        Interpolation m_interpolation{ Interpolation::Bilinear };
+        std::vector<std::int32_t> m_offsets;
+        std::vector<std::uint8_t> m_fx;
+        std::vector<std::uint8_t> m_fy;
+    };
+
+    // Warps the image into a height x width image with an affine or perspective transform from source to destination
+    // coordinates. Destination pixels that map outside of the source get borderValue. The source coordinates of a row are
+    // computed once and shared by all channels, bands of rows are processed in parallel.
+    template <typename T>
+    Image<T> Warp(const Image<T>& img, const Transform2D& transform, size_t height, size_t width, const WarpSettings& settings = WarpSettings{}, T borderValue = T{})
+    {
+        detail::check_warp_arguments(img.height(), img.width(), height, width);
+
+        const Transform2D inverse = InvertTransform(transform);
+        Image<T> outImg(height, width, img.color_space(), img.num_channels());
+
+        parallel_for(0, height, [&](size_t, size_t first, size_t last)
+            {
+                detail::WarpRowBuffers buffers;
+                std::vector<std::int32_t> offsets(width);
+                std::vector<std::uint8_t> fx(width), fy(width);
+
+                for (size_t row = first; row < last; row++)
+                {
+                    detail::warp_row_coordinates(inverse, img.height(), img.width(), row, width, settings.interpolation, offsets.data(), fx.data(), fy.data(), buffers);
+                    for (size_t t = 0; t < img.num_channels(); t++)
+                        detail::warp_sample_row(img(t).data(), img.width(), offsets.data(), fx.data(), fy.data(), &outImg(t)(row, 0), width, settings.interpolation, borderValue);
+                }
+            }, settings.num_threads);
+
+        return outImg;
+    }
+
+    template <typename T>
+    Image<T> Warp(const Image<T>& img, const WarpMap& map, T borderValue = T{}, size_t numThreads = 0)
+    {
+        if (img.height() != map.src_height() || img.width() != map.src_width())
+            throw std::invalid_argument("Image size does not match the map.");
+
+        Image<T> outImg(map.height(), map.width(), img.color_space(), img.num_channels());
+
+        parallel_for(0, map.height(), [&](size_t, size_t first, size_t last)
+            {
+                for (size_t row = first; row < last; row++)
+                    for (size_t t = 0; t < img.num_channels(); t++)
+                        detail::warp_sample_row(img(t).data(), img.width(), map.offsets(row), map.fx(row), map.fy(row), &outImg(t)(row, 0), map.width(), map.interpolation(), borderValue);
+            }, numThreads);
+
+        return outImg;
+    }
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
+#include <cmath>
 #include <concepts>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 
 namespace imglib
 {
@@ -14,11 +19,54 @@ namespace imglib
         RGBA,           // RGB with alpha channel
         YCbCr,
         CMYK,           // Substractive color model, 4 channels - Cyan, Magenta, Yellow, Key (black)
-        YCCK
+        YCCK,
+        HSV,            // Hue, Saturation, Value
+        HSL,            // Hue, Saturation, Lightness
+        Lab             // CIE L*a*b* (D65 white point)
     };
 
     template<typename T> class Image;
 
+    namespace detail
+    {
+        // Conversions work on 8-bit and 16-bit unsigned values in fixed point.
+        template <typename T>
+        concept ColorConvertible = std::unsigned_integral<T> && sizeof(T) <= 2;
+
+        constexpr int color_fraction_bits{ 16 };
+
+        constexpr std::int32_t to_color_fixed(double val) noexcept
+        {
+            return static_cast<std::int32_t>(val * (1 << color_fraction_bits) + (val < 0 ? -0.5 : 0.5));
+        }
+
+        // Red and blue weights of Rec.601 luma, green gets the rest.
+        constexpr double rec601_kr{ 0.299 };
+        constexpr double rec601_kb{ 0.114 };
+
+        // 8-bit and 16-bit values give the same result as rgb_to_luma, other types are weighted in double.
+        template <typename T>
+        T rec601_luma(T r, T g, T b) noexcept
+        {
+            if constexpr (ColorConvertible<T>)
+            {
+                using Acc = std::conditional_t<sizeof(T) == 1, std::int32_t, std::int64_t>;
+                constexpr Acc yr = to_color_fixed(rec601_kr);
+                constexpr Acc yb = to_color_fixed(rec601_kb);
+                constexpr Acc yg = (Acc{ 1 } << color_fraction_bits) - yr - yb;
+                return static_cast<T>((yr * r + yg * g + yb * b + (Acc{ 1 } << (color_fraction_bits - 1))) >> color_fraction_bits);
+            }
+            else
+            {
+                double y = rec601_kr * r + (1.0 - rec601_kr - rec601_kb) * g + rec601_kb * b;
+                if constexpr (std::is_integral_v<T>)
+                    return static_cast<T>(std::clamp<double>(std::floor(y + 0.5), std::numeric_limits<T>::min(), std::numeric_limits<T>::max()));
+                else
+                    return static_cast<T>(y);
+            }
+        }
+    }
+
     template <typename T>
     T interpolate(T start, T end, double ratio) { return static_cast<T>(start * (1.0 - ratio) + end * ratio); }
 
@@ -77,16 +125,15 @@ namespace imglib
         return colors;
     }
 
+    // Rec.601 luma of an RGB image. color_conversion.hpp has the multi-threaded rgb_to_luma with the choice of standard.
     template<typename T>
     Image<T> rgb_to_grayscale(const Image<T>& rgbImg)
     {
         Image<T> grayImage{ rgbImg.height(), rgbImg.width(), ColorSpace::GrayScale, 1 };
 
         for (size_t i = 0; i < rgbImg.size(); ++i)
-            grayImage(0)(i) = (rgbImg(0)(i) + rgbImg(1)(i) + rgbImg(2)(i)) / 3;
+            grayImage(0)(i) = detail::rec601_luma(rgbImg(0)(i), rgbImg(1)(i), rgbImg(2)(i));
 
         return grayImage;
     }
 }
-
-
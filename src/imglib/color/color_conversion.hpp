@@ -0,0 +1,822 @@
+#pragma once
+
+#include <imglib/image/image.hpp>
+#include <imglib/image/cimage.hpp>
+#include <imglib/image/pimage.hpp>
+#include <imglib/utility/parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace imglib
+{
+    enum class LumaStandard
+    {
+        Rec601,     // SDTV and JPEG (JFIF)
+        Rec709      // HDTV
+    };
+
+    namespace detail
+    {
+        // Full range YCbCr as in JFIF, the chroma channels are centered at half of the value range.
+        struct YCbCrCoefficients
+        {
+            std::int32_t yr, yg, yb;
+            std::int32_t cbr, cbg, cbb;
+            std::int32_t crr, crg, crb;
+            std::int32_t rcr, gcb, gcr, bcb;
+        };
+
+        constexpr YCbCrCoefficients make_ycbcr_coefficients(double kr, double kb) noexcept
+        {
+            const double kg = 1.0 - kr - kb;
+
+            // Rows of the forward matrix sum to exactly one (luma) and zero (chroma), so gray stays gray without chroma.
+            YCbCrCoefficients c{};
+            c.yr = to_color_fixed(kr);
+            c.yb = to_color_fixed(kb);
+            c.yg = (1 << color_fraction_bits) - c.yr - c.yb;
+            c.cbr = to_color_fixed(-0.5 * kr / (1.0 - kb));
+            c.cbb = to_color_fixed(0.5);
+            c.cbg = -c.cbr - c.cbb;
+            c.crr = to_color_fixed(0.5);
+            c.crb = to_color_fixed(-0.5 * kb / (1.0 - kr));
+            c.crg = -c.crr - c.crb;
+            c.rcr = to_color_fixed(2.0 * (1.0 - kr));
+            c.gcb = to_color_fixed(-2.0 * kb * (1.0 - kb) / kg);
+            c.gcr = to_color_fixed(-2.0 * kr * (1.0 - kr) / kg);
+            c.bcb = to_color_fixed(2.0 * (1.0 - kb));
+            return c;
+        }
+
+        inline const YCbCrCoefficients& get_ycbcr_coefficients(LumaStandard standard) noexcept
+        {
+            static constexpr YCbCrCoefficients rec601{ make_ycbcr_coefficients(rec601_kr, rec601_kb) };
+            static constexpr YCbCrCoefficients rec709{ make_ycbcr_coefficients(0.2126, 0.0722) };
+            return standard == LumaStandard::Rec709 ? rec709 : rec601;
+        }
+
+        // 32 bits are enough for the products of 8-bit values, the narrow lanes vectorize better.
+        template <typename T>
+        using ColorAccumulator = std::conditional_t<sizeof(T) == 1, std::int32_t, std::int64_t>;
+
+        template <typename T, typename Acc>
+        T clamp_color(Acc val) noexcept
+        {
+            return static_cast<T>(std::clamp<Acc>(val, 0, std::numeric_limits<T>::max()));
+        }
+
+        // The kernels convert count pixels whose values are step apart: 1 for the planes of Image, the number of channels for
+        // interleaved images. All values of a pixel are read before it is written, so the output may be the input.
+        template <typename T>
+        void rgb_to_ycbcr_kernel(T const* r, T const* g, T const* b, size_t inStep, T* y, T* cb, T* cr, size_t outStep, size_t count, const YCbCrCoefficients& c) noexcept
+        {
+            using Acc = ColorAccumulator<T>;
+            constexpr Acc half = Acc{ 1 } << (color_fraction_bits - 1);
+            constexpr Acc offset = Acc{ 1 } << (8 * sizeof(T) - 1);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                Acc R = r[i * inStep], G = g[i * inStep], B = b[i * inStep];
+                Acc Y = (c.yr * R + c.yg * G + c.yb * B + half) >> color_fraction_bits;
+                Acc Cb = ((c.cbr * R + c.cbg * G + c.cbb * B + half) >> color_fraction_bits) + offset;
+                Acc Cr = ((c.crr * R + c.crg * G + c.crb * B + half) >> color_fraction_bits) + offset;
+
+                y[i * outStep] = static_cast<T>(Y);
+                cb[i * outStep] = clamp_color<T>(Cb);
+                cr[i * outStep] = clamp_color<T>(Cr);
+            }
+        }
+
+        template <typename T>
+        void ycbcr_to_rgb_kernel(T const* y, T const* cb, T const* cr, size_t inStep, T* r, T* g, T* b, size_t outStep, size_t count, const YCbCrCoefficients& c) noexcept
+        {
+            using Acc = ColorAccumulator<T>;
+            constexpr Acc half = Acc{ 1 } << (color_fraction_bits - 1);
+            constexpr Acc offset = Acc{ 1 } << (8 * sizeof(T) - 1);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                Acc Y = y[i * inStep], Cb = Acc{ cb[i * inStep] } - offset, Cr = Acc{ cr[i * inStep] } - offset;
+
+                r[i * outStep] = clamp_color<T>(Y + ((c.rcr * Cr + half) >> color_fraction_bits));
+                g[i * outStep] = clamp_color<T>(Y + ((c.gcb * Cb + c.gcr * Cr + half) >> color_fraction_bits));
+                b[i * outStep] = clamp_color<T>(Y + ((c.bcb * Cb + half) >> color_fraction_bits));
+            }
+        }
+
+        template <typename T>
+        void rgb_to_luma_kernel(T const* r, T const* g, T const* b, size_t inStep, T* y, size_t outStep, size_t count, const YCbCrCoefficients& c) noexcept
+        {
+            using Acc = ColorAccumulator<T>;
+            constexpr Acc half = Acc{ 1 } << (color_fraction_bits - 1);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                Acc R = r[i * inStep], G = g[i * inStep], B = b[i * inStep];
+                y[i * outStep] = static_cast<T>((c.yr * R + c.yg * G + c.yb * B + half) >> color_fraction_bits);
+            }
+        }
+
+        // Calls func(first, count) on contiguous pixel ranges in parallel, small images are not worth the thread start-up.
+        template <typename Func>
+        void for_each_pixel_range(size_t numPixels, size_t numThreads, Func&& func)
+        {
+            constexpr size_t minPixelsPerThread{ 1 << 15 };
+            numThreads = std::min(GetNumThreads(numThreads), std::max(numPixels / minPixelsPerThread, size_t{ 1 }));
+            parallel_for(0, numPixels, [&func](size_t, size_t first, size_t last) { func(first, last - first); }, numThreads);
+        }
+
+        template <typename T, size_t NumChannels>
+        T* interleaved_data(CImage<T, NumChannels>& img) { return &img(0, 0); }
+
+        template <typename T, size_t NumChannels>
+        T const* interleaved_data(const CImage<T, NumChannels>& img) { return img.data(); }
+
+        template <typename T, size_t NumChannels>
+        T* interleaved_data(PImage<T, NumChannels>& img)
+        {
+            static_assert(sizeof(Pixel<T, NumChannels>) == NumChannels * sizeof(T), "Pixels are expected to be tightly packed.");
+            return reinterpret_cast<T*>(&img(0));
+        }
+
+        template <typename T, size_t NumChannels>
+        T const* interleaved_data(const PImage<T, NumChannels>& img)
+        {
+            static_assert(sizeof(Pixel<T, NumChannels>) == NumChannels * sizeof(T), "Pixels are expected to be tightly packed.");
+            return reinterpret_cast<T const*>(&img(0));
+        }
+
+        template <template <typename, size_t> class InterleavedImage, typename T, size_t NumChannels>
+        concept Interleaved = std::same_as<InterleavedImage<T, NumChannels>, CImage<T, NumChannels>> || std::same_as<InterleavedImage<T, NumChannels>, PImage<T, NumChannels>>;
+
+        inline void check_color_space(ColorSpace actual, ColorSpace expected)
+        {
+            if (actual != expected)
+                throw std::invalid_argument("Image has an unexpected color space.");
+        }
+
+        inline void check_rgb(ColorSpace cs)
+        {
+            if (cs != ColorSpace::RGB && cs != ColorSpace::RGBA)
+                throw std::invalid_argument("Image has an unexpected color space.");
+        }
+
+        template <typename T>
+        void convert_planes(Image<T> const& in, Image<T>& out, bool toYCbCr, LumaStandard standard, size_t numThreads)
+        {
+            const auto& c = get_ycbcr_coefficients(standard);
+            T const* i0 = in(0).data();
+            T const* i1 = in(1).data();
+            T const* i2 = in(2).data();
+            T* o0 = &out(0)(0);
+            T* o1 = &out(1)(0);
+            T* o2 = &out(2)(0);
+
+            for_each_pixel_range(in.size(), numThreads, [&](size_t first, size_t count)
+                {
+                    if (toYCbCr)
+                        rgb_to_ycbcr_kernel(i0 + first, i1 + first, i2 + first, 1, o0 + first, o1 + first, o2 + first, 1, count, c);
+                    else
+                        ycbcr_to_rgb_kernel(i0 + first, i1 + first, i2 + first, 1, o0 + first, o1 + first, o2 + first, 1, count, c);
+                });
+        }
+
+        template <typename T>
+        void convert_interleaved(T const* in, T* out, bool toYCbCr, size_t numPixels, LumaStandard standard, size_t numThreads)
+        {
+            const auto& c = get_ycbcr_coefficients(standard);
+            for_each_pixel_range(numPixels, numThreads, [&](size_t first, size_t count)
+                {
+                    T const* src = in + 3 * first;
+                    T* dst = out + 3 * first;
+                    if (toYCbCr)
+                        rgb_to_ycbcr_kernel(src, src + 1, src + 2, 3, dst, dst + 1, dst + 2, 3, count, c);
+                    else
+                        ycbcr_to_rgb_kernel(src, src + 1, src + 2, 3, dst, dst + 1, dst + 2, 3, count, c);
+                });
+        }
+    }
+
+    // Luma (Y') of an RGB or RGBA image with the weights of the given standard, alpha is ignored.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> rgb_to_luma(const Image<T>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_rgb(img.color_space());
+
+        Image<T> grayImg{ img.height(), img.width(), ColorSpace::GrayScale, 1 };
+        const auto& c = detail::get_ycbcr_coefficients(standard);
+        T* out = &grayImg(0)(0);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                detail::rgb_to_luma_kernel(img(0).data() + first, img(1).data() + first, img(2).data() + first, 1, out + first, 1, count, c);
+            });
+
+        return grayImg;
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T, size_t NumChannels>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, NumChannels> && (NumChannels == 3 || NumChannels == 4)
+    InterleavedImage<T, 1> rgb_to_luma(const InterleavedImage<T, NumChannels>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_rgb(img.color_space());
+
+        InterleavedImage<T, 1> grayImg{ img.height(), img.width(), ColorSpace::GrayScale };
+        const auto& c = detail::get_ycbcr_coefficients(standard);
+        T const* in = detail::interleaved_data(img);
+        T* out = detail::interleaved_data(grayImg);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                T const* src = in + NumChannels * first;
+                detail::rgb_to_luma_kernel(src, src + 1, src + 2, NumChannels, out + first, 1, count, c);
+            });
+
+        return grayImg;
+    }
+
+    // Converts the image to a single luma channel, the first plane is reused for the result.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    void rgb_to_luma_in_place(Image<T>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_rgb(img.color_space());
+
+        const auto& c = detail::get_ycbcr_coefficients(standard);
+        T* y = &img(0)(0);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                detail::rgb_to_luma_kernel(img(0).data() + first, img(1).data() + first, img(2).data() + first, 1, y + first, 1, count, c);
+            });
+
+        // Channels can only be removed from images without a color space.
+        img.set_color_space(ColorSpace::Unspecified);
+        while (img.num_channels() > 1)
+            img.delete_channel(img.num_channels() - 1);
+        img.set_color_space(ColorSpace::GrayScale);
+    }
+
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> rgb_to_ycbcr(const Image<T>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::RGB);
+
+        Image<T> outImg{ img.height(), img.width(), ColorSpace::YCbCr, 3 };
+        detail::convert_planes(img, outImg, true, standard, numThreads);
+        return outImg;
+    }
+
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> ycbcr_to_rgb(const Image<T>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::YCbCr);
+
+        Image<T> outImg{ img.height(), img.width(), ColorSpace::RGB, 3 };
+        detail::convert_planes(img, outImg, false, standard, numThreads);
+        return outImg;
+    }
+
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    void rgb_to_ycbcr_in_place(Image<T>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::RGB);
+        detail::convert_planes(img, img, true, standard, numThreads);
+        img.set_color_space(ColorSpace::YCbCr);
+    }
+
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    void ycbcr_to_rgb_in_place(Image<T>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::YCbCr);
+        detail::convert_planes(img, img, false, standard, numThreads);
+        img.set_color_space(ColorSpace::RGB);
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    InterleavedImage<T, 3> rgb_to_ycbcr(const InterleavedImage<T, 3>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::RGB);
+
+        InterleavedImage<T, 3> outImg{ img.height(), img.width(), ColorSpace::YCbCr };
+        detail::convert_interleaved(detail::interleaved_data(img), detail::interleaved_data(outImg), true, img.size(), standard, numThreads);
+        return outImg;
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    InterleavedImage<T, 3> ycbcr_to_rgb(const InterleavedImage<T, 3>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::YCbCr);
+
+        InterleavedImage<T, 3> outImg{ img.height(), img.width(), ColorSpace::RGB };
+        detail::convert_interleaved(detail::interleaved_data(img), detail::interleaved_data(outImg), false, img.size(), standard, numThreads);
+        return outImg;
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    void rgb_to_ycbcr_in_place(InterleavedImage<T, 3>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::RGB);
+
+        T* data = detail::interleaved_data(img);
+        detail::convert_interleaved(static_cast<T const*>(data), data, true, img.size(), standard, numThreads);
+        img.set_color_space(ColorSpace::YCbCr);
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    void ycbcr_to_rgb_in_place(InterleavedImage<T, 3>& img, LumaStandard standard = LumaStandard::Rec601, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::YCbCr);
+
+        T* data = detail::interleaved_data(img);
+        detail::convert_interleaved(static_cast<T const*>(data), data, false, img.size(), standard, numThreads);
+        img.set_color_space(ColorSpace::RGB);
+    }
+
+    namespace detail
+    {
+        // Rounded t / max for t in [0, max * max], exact without a division: t / (2^n - 1) is approximated by (t + t / 2^n) / 2^n.
+        template <typename T>
+        T divide_by_max(std::conditional_t<sizeof(T) == 1, std::uint32_t, std::uint64_t> t) noexcept
+        {
+            constexpr int bits = 8 * sizeof(T);
+            t += decltype(t){ 1 } << (bits - 1);
+            return static_cast<T>((t + (t >> bits)) >> bits);
+        }
+
+        // Rounded a * b / max for values in [0, max].
+        template <typename T>
+        T multiply_normalized(ColorAccumulator<T> a, ColorAccumulator<T> b) noexcept
+        {
+            using Acc = std::conditional_t<sizeof(T) == 1, std::uint32_t, std::uint64_t>;
+            return divide_by_max<T>(static_cast<Acc>(a) * static_cast<Acc>(b));
+        }
+
+        // C, M, Y and K are ink amounts. Files written by Adobe applications store them inverted (max - ink), for those
+        // flip is 0 and the stored values are already the remaining light. Otherwise flip is max and x ^ flip = max - x.
+        template <typename T>
+        void cmyk_to_rgb_kernel(T const* c, T const* m, T const* y, T const* k, size_t inStep, T* r, T* g, T* b, size_t outStep, size_t count, bool inverted) noexcept
+        {
+            using Acc = ColorAccumulator<T>;
+            const Acc flip = inverted ? 0 : std::numeric_limits<T>::max();
+
+            for (size_t i = 0; i < count; i++)
+            {
+                Acc K = Acc{ k[i * inStep] } ^ flip;
+                Acc C = Acc{ c[i * inStep] } ^ flip, M = Acc{ m[i * inStep] } ^ flip, Y = Acc{ y[i * inStep] } ^ flip;
+                r[i * outStep] = multiply_normalized<T>(C, K);
+                g[i * outStep] = multiply_normalized<T>(M, K);
+                b[i * outStep] = multiply_normalized<T>(Y, K);
+            }
+        }
+
+        template <typename T>
+        void rgb_to_cmyk_kernel(T const* r, T const* g, T const* b, size_t inStep, T* c, T* m, T* y, T* k, size_t outStep, size_t count, bool inverted) noexcept
+        {
+            using Acc = ColorAccumulator<T>;
+            constexpr Acc max = std::numeric_limits<T>::max();
+            const Acc flip = inverted ? max : 0;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                Acc R = r[i * inStep], G = g[i * inStep], B = b[i * inStep];
+                Acc white = std::max({ R, G, B });
+
+                // Black takes the common part of the inks, the rest is scaled to the remaining range.
+                auto ink = [white](Acc val) { return white == 0 ? Acc{ 0 } : ((white - val) * max + white / 2) / white; };
+                c[i * outStep] = static_cast<T>(ink(R) ^ flip);
+                m[i * outStep] = static_cast<T>(ink(G) ^ flip);
+                y[i * outStep] = static_cast<T>(ink(B) ^ flip);
+                k[i * outStep] = static_cast<T>((max - white) ^ flip);
+            }
+        }
+
+        // Chroma contributions of the Rec.601 YCbCr to RGB conversion for every 8-bit chroma value, the green ones are kept
+        // in fixed point with the rounding constant. The results are identical to ycbcr_to_rgb_kernel.
+        struct YccTables
+        {
+            std::int32_t cr_r[256];
+            std::int32_t cb_b[256];
+            std::int32_t cb_g[256];
+            std::int32_t cr_g[256];
+        };
+
+        inline const YccTables& get_ycc_tables() noexcept
+        {
+            static const YccTables tables = []()
+                {
+                    const auto& c = get_ycbcr_coefficients(LumaStandard::Rec601);
+                    constexpr std::int32_t half = std::int32_t{ 1 } << (color_fraction_bits - 1);
+
+                    YccTables t{};
+                    for (std::int32_t i = 0; i < 256; i++)
+                    {
+                        std::int32_t chroma = i - 128;
+                        t.cr_r[i] = (c.rcr * chroma + half) >> color_fraction_bits;
+                        t.cb_b[i] = (c.bcb * chroma + half) >> color_fraction_bits;
+                        t.cb_g[i] = c.gcb * chroma + half;
+                        t.cr_g[i] = c.gcr * chroma;
+                    }
+                    return t;
+                }();
+
+            return tables;
+        }
+
+        // YCCK is CMYK whose C, M and Y were replaced by the YCbCr of (max - C, max - M, max - Y). The YCbCr conversion
+        // gives back max - C, ..., which is the remaining light of regular files and is flipped for inverted ones. 8-bit
+        // chroma is looked up in the tables, 16-bit chroma has too many values for them and is multiplied out.
+        template <typename T>
+        void ycck_to_rgb_kernel(T const* y, T const* cb, T const* cr, T const* k, size_t inStep, T* r, T* g, T* b, size_t outStep, size_t count, bool inverted) noexcept
+        {
+            using Acc = ColorAccumulator<T>;
+            constexpr Acc max = std::numeric_limits<T>::max();
+            constexpr Acc half = Acc{ 1 } << (color_fraction_bits - 1);
+            constexpr Acc offset = Acc{ 1 } << (8 * sizeof(T) - 1);
+            const Acc flip = inverted ? max : 0;
+            const Acc kFlip = inverted ? 0 : max;
+            [[maybe_unused]] const auto& t = get_ycc_tables();
+            [[maybe_unused]] const auto& c = get_ycbcr_coefficients(LumaStandard::Rec601);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                Acc Y = y[i * inStep], Cb = cb[i * inStep], Cr = cr[i * inStep];
+                Acc K = Acc{ k[i * inStep] } ^ kFlip;
+                Acc R{}, G{}, B{};
+
+                if constexpr (sizeof(T) == 1)
+                {
+                    R = Y + t.cr_r[Cr];
+                    G = Y + ((t.cb_g[Cb] + t.cr_g[Cr]) >> color_fraction_bits);
+                    B = Y + t.cb_b[Cb];
+                }
+                else
+                {
+                    Cb -= offset;
+                    Cr -= offset;
+                    R = Y + ((c.rcr * Cr + half) >> color_fraction_bits);
+                    G = Y + ((c.gcb * Cb + c.gcr * Cr + half) >> color_fraction_bits);
+                    B = Y + ((c.bcb * Cb + half) >> color_fraction_bits);
+                }
+
+                r[i * outStep] = multiply_normalized<T>(std::clamp<Acc>(R, 0, max) ^ flip, K);
+                g[i * outStep] = multiply_normalized<T>(std::clamp<Acc>(G, 0, max) ^ flip, K);
+                b[i * outStep] = multiply_normalized<T>(std::clamp<Acc>(B, 0, max) ^ flip, K);
+            }
+        }
+    }
+
+    // CMYK to RGB without color management. inverted is for the CMYK of Adobe applications, which store max - ink.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> cmyk_to_rgb(const Image<T>& img, bool inverted = false, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::CMYK);
+
+        Image<T> outImg{ img.height(), img.width(), ColorSpace::RGB, 3 };
+        T* r = &outImg(0)(0);
+        T* g = &outImg(1)(0);
+        T* b = &outImg(2)(0);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                detail::cmyk_to_rgb_kernel(img(0).data() + first, img(1).data() + first, img(2).data() + first, img(3).data() + first, 1,
+                    r + first, g + first, b + first, 1, count, inverted);
+            });
+
+        return outImg;
+    }
+
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> rgb_to_cmyk(const Image<T>& img, bool inverted = false, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::RGB);
+
+        Image<T> outImg{ img.height(), img.width(), ColorSpace::CMYK, 4 };
+        T* c = &outImg(0)(0);
+        T* m = &outImg(1)(0);
+        T* y = &outImg(2)(0);
+        T* k = &outImg(3)(0);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                detail::rgb_to_cmyk_kernel(img(0).data() + first, img(1).data() + first, img(2).data() + first, 1,
+                    c + first, m + first, y + first, k + first, 1, count, inverted);
+            });
+
+        return outImg;
+    }
+
+    // YCCK (as stored in JPEG files) to RGB, inverted as for cmyk_to_rgb.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> ycck_to_rgb(const Image<T>& img, bool inverted = false, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::YCCK);
+
+        Image<T> outImg{ img.height(), img.width(), ColorSpace::RGB, 3 };
+        T* r = &outImg(0)(0);
+        T* g = &outImg(1)(0);
+        T* b = &outImg(2)(0);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                detail::ycck_to_rgb_kernel(img(0).data() + first, img(1).data() + first, img(2).data() + first, img(3).data() + first, 1,
+                    r + first, g + first, b + first, 1, count, inverted);
+            });
+
+        return outImg;
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 4>
+    InterleavedImage<T, 3> cmyk_to_rgb(const InterleavedImage<T, 4>& img, bool inverted = false, size_t numThreads = 0)
+    {
+        detail::check_color_space(img.color_space(), ColorSpace::CMYK);
+
+        InterleavedImage<T, 3> outImg{ img.height(), img.width(), ColorSpace::RGB };
+        T const* in = detail::interleaved_data(img);
+        T* out = detail::interleaved_data(outImg);
+
+        detail::for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+            {
+                T const* src = in + 4 * first;
+                T* dst = out + 3 * first;
+                detail::cmyk_to_rgb_kernel(src, src + 1, src + 2, src + 3, 4, dst, dst + 1, dst + 2, 3, count, inverted);
+            });
+
+        return outImg;
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        T round_color(float val) noexcept
+        {
+            return static_cast<T>(std::clamp(val + 0.5f, 0.0f, static_cast<float>(std::numeric_limits<T>::max())));
+        }
+
+        // Hue covers the whole value range: red is 0, green a third and blue two thirds of max + 1, where the circle closes.
+        template <typename T>
+        T hue(float R, float G, float B, float hi, float diff) noexcept
+        {
+            constexpr float range = static_cast<float>(std::numeric_limits<T>::max()) + 1.0f;
+            if (diff == 0.0f)
+                return 0;
+
+            float sector = hi == R ? (G - B) / diff : (hi == G ? 2.0f + (B - R) / diff : 4.0f + (R - G) / diff);
+            if (sector < 0.0f)
+                sector += 6.0f;
+
+            auto val = static_cast<std::uint32_t>(sector * (range / 6.0f) + 0.5f);
+            return static_cast<T>(val & static_cast<std::uint32_t>(std::numeric_limits<T>::max()));
+        }
+
+        // The HSV and HSL kernels compute in float, which vectorizes better than integer divisions.
+        template <typename T>
+        void rgb_to_hsv_kernel(T const* r, T const* g, T const* b, size_t inStep, T* h, T* s, T* v, size_t outStep, size_t count) noexcept
+        {
+            constexpr float max = std::numeric_limits<T>::max();
+
+            for (size_t i = 0; i < count; i++)
+            {
+                float R = r[i * inStep], G = g[i * inStep], B = b[i * inStep];
+                float hi = std::max({ R, G, B });
+                float diff = hi - std::min({ R, G, B });
+
+                h[i * outStep] = hue<T>(R, G, B, hi, diff);
+                s[i * outStep] = diff == 0.0f ? T{ 0 } : round_color<T>(diff * max / hi);
+                v[i * outStep] = static_cast<T>(hi);
+            }
+        }
+
+        template <typename T>
+        void rgb_to_hsl_kernel(T const* r, T const* g, T const* b, size_t inStep, T* h, T* s, T* l, size_t outStep, size_t count) noexcept
+        {
+            constexpr float max = std::numeric_limits<T>::max();
+
+            for (size_t i = 0; i < count; i++)
+            {
+                float R = r[i * inStep], G = g[i * inStep], B = b[i * inStep];
+                float hi = std::max({ R, G, B });
+                float lo = std::min({ R, G, B });
+                float diff = hi - lo;
+
+                h[i * outStep] = hue<T>(R, G, B, hi, diff);
+                s[i * outStep] = diff == 0.0f ? T{ 0 } : round_color<T>(diff * max / (max - std::abs(hi + lo - max)));
+                l[i * outStep] = round_color<T>((hi + lo) * 0.5f);
+            }
+        }
+
+        // sRGB to linear light. 8-bit values index the table directly, 16-bit values interpolate between every 64th value.
+        template <typename T>
+        struct SrgbLinearTable
+        {
+            static constexpr int shift{ sizeof(T) == 1 ? 0 : 6 };
+            std::array<float, (std::numeric_limits<T>::max() >> shift) + 2> values;
+        };
+
+        template <typename T>
+        const SrgbLinearTable<T>& get_srgb_linear_table() noexcept
+        {
+            static const SrgbLinearTable<T> table = []()
+                {
+                    SrgbLinearTable<T> t{};
+                    for (size_t i = 0; i < t.values.size(); i++)
+                    {
+                        double x = static_cast<double>(i << SrgbLinearTable<T>::shift) / std::numeric_limits<T>::max();
+                        t.values[i] = static_cast<float>(x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4));
+                    }
+                    return t;
+                }();
+
+            return table;
+        }
+
+        template <typename T>
+        float srgb_to_linear(const SrgbLinearTable<T>& table, T val) noexcept
+        {
+            constexpr int shift = SrgbLinearTable<T>::shift;
+            if constexpr (shift == 0)
+            {
+                return table.values[val];
+            }
+            else
+            {
+                size_t i = val >> shift;
+                float frac = static_cast<float>(val & ((1 << shift) - 1)) * (1.0f / (1 << shift));
+                return table.values[i] + (table.values[i + 1] - table.values[i]) * frac;
+            }
+        }
+
+        // f(t) of the L*a*b* definition, the cube root with a linear part near zero, sampled on [0, 1] and interpolated.
+        struct LabFunctionTable
+        {
+            static constexpr size_t size{ 4096 };
+            std::array<float, size + 1> values;
+        };
+
+        inline const LabFunctionTable& get_lab_function_table() noexcept
+        {
+            static const LabFunctionTable table = []()
+                {
+                    constexpr double epsilon = 216.0 / 24389.0;
+                    constexpr double kappa = 24389.0 / 27.0;
+
+                    LabFunctionTable t{};
+                    for (size_t i = 0; i <= LabFunctionTable::size; i++)
+                    {
+                        double x = static_cast<double>(i) / LabFunctionTable::size;
+                        t.values[i] = static_cast<float>(x > epsilon ? std::cbrt(x) : (kappa * x + 16.0) / 116.0);
+                    }
+                    return t;
+                }();
+
+            return table;
+        }
+
+        inline float lab_function(const LabFunctionTable& table, float t) noexcept
+        {
+            t = std::clamp(t, 0.0f, 1.0f) * LabFunctionTable::size;
+            size_t i = std::min(static_cast<size_t>(t), LabFunctionTable::size - 1);
+            float frac = t - static_cast<float>(i);
+            return table.values[i] + (table.values[i + 1] - table.values[i]) * frac;
+        }
+
+        // L is scaled from [0, 100] to [0, max], a and b by (max + 1) / 256 and centered at half of the range, for 8-bit
+        // values this is L * 255 / 100, a + 128 and b + 128.
+        template <typename T>
+        void rgb_to_lab_kernel(T const* r, T const* g, T const* b, size_t inStep, T* L, T* A, T* B, size_t outStep, size_t count) noexcept
+        {
+            // sRGB to XYZ, X and Z are divided by the D65 white point.
+            constexpr float xr = static_cast<float>(0.412453 / 0.950456), xg = static_cast<float>(0.357580 / 0.950456), xb = static_cast<float>(0.180423 / 0.950456);
+            constexpr float yr = 0.212671f, yg = 0.715160f, yb = 0.072169f;
+            constexpr float zr = static_cast<float>(0.019334 / 1.088754), zg = static_cast<float>(0.119193 / 1.088754), zb = static_cast<float>(0.950227 / 1.088754);
+
+            constexpr float range = static_cast<float>(std::numeric_limits<T>::max()) + 1.0f;
+            constexpr float lScale = static_cast<float>(std::numeric_limits<T>::max()) / 100.0f;
+            constexpr float abScale = range / 256.0f;
+            constexpr float abOffset = range / 2.0f;
+
+            const auto& linear = get_srgb_linear_table<T>();
+            const auto& f = get_lab_function_table();
+
+            for (size_t i = 0; i < count; i++)
+            {
+                float R = srgb_to_linear(linear, r[i * inStep]);
+                float G = srgb_to_linear(linear, g[i * inStep]);
+                float Bl = srgb_to_linear(linear, b[i * inStep]);
+
+                float fx = lab_function(f, xr * R + xg * G + xb * Bl);
+                float fy = lab_function(f, yr * R + yg * G + yb * Bl);
+                float fz = lab_function(f, zr * R + zg * G + zb * Bl);
+
+                L[i * outStep] = round_color<T>((116.0f * fy - 16.0f) * lScale);
+                A[i * outStep] = round_color<T>(500.0f * (fx - fy) * abScale + abOffset);
+                B[i * outStep] = round_color<T>(200.0f * (fy - fz) * abScale + abOffset);
+            }
+        }
+
+        // Runs a three channel kernel over an RGB image into a new image of the given color space.
+        template <typename T, typename Kernel>
+        Image<T> convert_from_rgb(const Image<T>& img, ColorSpace colorSpace, size_t numThreads, Kernel kernel)
+        {
+            check_color_space(img.color_space(), ColorSpace::RGB);
+
+            Image<T> outImg{ img.height(), img.width(), colorSpace, 3 };
+            T* o0 = &outImg(0)(0);
+            T* o1 = &outImg(1)(0);
+            T* o2 = &outImg(2)(0);
+
+            for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+                {
+                    kernel(img(0).data() + first, img(1).data() + first, img(2).data() + first, 1, o0 + first, o1 + first, o2 + first, 1, count);
+                });
+
+            return outImg;
+        }
+
+        template <template <typename, size_t> class InterleavedImage, typename T, typename Kernel>
+        InterleavedImage<T, 3> convert_from_rgb(const InterleavedImage<T, 3>& img, ColorSpace colorSpace, size_t numThreads, Kernel kernel)
+        {
+            check_color_space(img.color_space(), ColorSpace::RGB);
+
+            InterleavedImage<T, 3> outImg{ img.height(), img.width(), colorSpace };
+            T const* in = interleaved_data(img);
+            T* out = interleaved_data(outImg);
+
+            for_each_pixel_range(img.size(), numThreads, [&](size_t first, size_t count)
+                {
+                    T const* src = in + 3 * first;
+                    T* dst = out + 3 * first;
+                    kernel(src, src + 1, src + 2, 3, dst, dst + 1, dst + 2, 3, count);
+                });
+
+            return outImg;
+        }
+    }
+
+    // Hue, saturation and value, all in the full value range of T. Hue wraps around: 0 is red, a third of max + 1 green and
+    // two thirds blue.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> rgb_to_hsv(const Image<T>& img, size_t numThreads = 0)
+    {
+        return detail::convert_from_rgb(img, ColorSpace::HSV, numThreads, detail::rgb_to_hsv_kernel<T>);
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    InterleavedImage<T, 3> rgb_to_hsv(const InterleavedImage<T, 3>& img, size_t numThreads = 0)
+    {
+        return detail::convert_from_rgb(img, ColorSpace::HSV, numThreads, detail::rgb_to_hsv_kernel<T>);
+    }
+
+    // Hue, saturation and lightness, hue as for rgb_to_hsv.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> rgb_to_hsl(const Image<T>& img, size_t numThreads = 0)
+    {
+        return detail::convert_from_rgb(img, ColorSpace::HSL, numThreads, detail::rgb_to_hsl_kernel<T>);
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    InterleavedImage<T, 3> rgb_to_hsl(const InterleavedImage<T, 3>& img, size_t numThreads = 0)
+    {
+        return detail::convert_from_rgb(img, ColorSpace::HSL, numThreads, detail::rgb_to_hsl_kernel<T>);
+    }
+
+    // CIE L*a*b* of sRGB data (D65). For 8-bit images L is scaled to [0, 255] and a, b are offset by 128; 16-bit images use
+    // L * 65535 / 100 and 256 * a + 32768.
+    template <typename T>
+        requires detail::ColorConvertible<T>
+    Image<T> rgb_to_lab(const Image<T>& img, size_t numThreads = 0)
+    {
+        return detail::convert_from_rgb(img, ColorSpace::Lab, numThreads, detail::rgb_to_lab_kernel<T>);
+    }
+
+    template <template <typename, size_t> class InterleavedImage, typename T>
+        requires detail::ColorConvertible<T> && detail::Interleaved<InterleavedImage, T, 3>
+    InterleavedImage<T, 3> rgb_to_lab(const InterleavedImage<T, 3>& img, size_t numThreads = 0)
+    {
+        return detail::convert_from_rgb(img, ColorSpace::Lab, numThreads, detail::rgb_to_lab_kernel<T>);
+    }
+}
@@ -5,6 +5,7 @@
 #include <memory>
 #include <algorithm>
 #include <iterator>
+#include <type_traits>
 
 #include <imglib/config.hpp>
 
@@ -268,4 +269,84 @@ namespace imglib
 
         auto to_index(size_t row, size_t col) const noexcept { return row * m_numCols + col; }
     };
-}
+
+    // Non-owning view of a row-major plane of values with the element access and iterator interface of Channel.
+    // Use ChannelView<const T> for read-only access.
+    template<typename T>
+    class ChannelView
+    {
+    private:
+        T* m_data{ nullptr };
+        size_t m_numRows{ 0 };
+        size_t m_numCols{ 0 };
+
+    public:
+        using value_type             = std::remove_const_t<T>;
+        using iterator               = ValueIterator<T>;
+        using const_iterator         = ValueIterator<const value_type>;
+        using reverse_iterator       = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        ChannelView() noexcept = default;
+
+        ChannelView(T* data, size_t numRows, size_t numCols) noexcept : m_data{ data }, m_numRows{ numRows }, m_numCols{ numCols } { }
+
+        ChannelView(Channel<value_type>& ch) noexcept : m_data{ ch.empty() ? nullptr : &ch(0) }, m_numRows{ ch.num_rows() }, m_numCols{ ch.num_columns() } { }
+
+        ChannelView(const Channel<value_type>& ch) noexcept requires std::is_const_v<T> : m_data{ ch.data() }, m_numRows{ ch.num_rows() }, m_numCols{ ch.num_columns() } { }
+
+        T& operator()(size_t row, size_t col) const { return m_data[row * m_numCols + col]; }
+
+        T& operator()(size_t index) const { return m_data[index]; }
+
+        // Iterators, a const view still gives write access like a pointer does, the c versions are read-only.
+        iterator begin() const noexcept { return iterator{ m_data }; }
+        const_iterator cbegin() const noexcept { return const_iterator{ m_data }; }
+
+        iterator end() const noexcept { return iterator{ m_data + size() }; }
+        const_iterator cend() const noexcept { return const_iterator{ m_data + size() }; }
+
+        // Reverse iterators
+        reverse_iterator rbegin() const noexcept { return reverse_iterator{ end() }; }
+        const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator{ cend() }; }
+
+        reverse_iterator rend() const noexcept { return reverse_iterator{ begin() }; }
+        const_reverse_iterator crend() const noexcept { return const_reverse_iterator{ cbegin() }; }
+
+        // Generic iterator
+        iterator git(size_t row, size_t col) const noexcept { return iterator{ m_data + row * m_numCols + col }; }
+        const_iterator cgit(size_t row, size_t col) const noexcept { return const_iterator{ m_data + row * m_numCols + col }; }
+
+        // Row iterators
+        iterator row_begin(size_t row) const noexcept { return iterator{ m_data + row * m_numCols }; }
+        const_iterator crow_begin(size_t row) const noexcept { return const_iterator{ m_data + row * m_numCols }; }
+
+        iterator row_end(size_t row) const noexcept { return row_begin(row + 1); }
+        const_iterator crow_end(size_t row) const noexcept { return crow_begin(row + 1); }
+
+        // Reverse row iterators
+        reverse_iterator rrow_begin(size_t row) const noexcept { return reverse_iterator{ row_end(row) }; }
+        const_reverse_iterator crrow_begin(size_t row) const noexcept { return const_reverse_iterator{ crow_end(row) }; }
+
+        reverse_iterator rrow_end(size_t row) const noexcept { return reverse_iterator{ row_begin(row) }; }
+        const_reverse_iterator crrow_end(size_t row) const noexcept { return const_reverse_iterator{ crow_begin(row) }; }
+
+        T* data() const noexcept { return m_data; }
+
+        bool empty() const noexcept { return m_data == nullptr; }
+
+        auto num_columns() const noexcept { return m_numCols; }
+
+        auto num_rows() const noexcept { return m_numRows; }
+
+        auto size() const noexcept { return m_numRows * m_numCols; }
+
+        // Copies the viewed values into a new channel.
+        Channel<value_type> to_channel() const
+        {
+            Channel<value_type> ch{ m_numRows, m_numCols };
+            std::copy(m_data, m_data + size(), ch.begin());
+            return ch;
+        }
+    };
+}
\ No newline at end of file
@@ -87,6 +87,8 @@ namespace imglib
 
 		ColorSpace color_space() const noexcept { return m_colorSpace; }
 
+		void set_color_space(ColorSpace cs) { m_colorSpace = cs; }
+
 		size_t size() const noexcept { return m_width * m_height; }
 
 		size_t data_size() const noexcept { return size() * NumChannels; }
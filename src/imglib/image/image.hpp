@@ -103,6 +103,8 @@ namespace imglib
 
             for (size_t i = 0; i < NumChannels; i++) 
                 *m_channels[i] = clr(i);
+
+            return *this;
         }
 
         template <std::convertible_to<T> ...U>
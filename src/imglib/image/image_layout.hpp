@@ -0,0 +1,18 @@
+#pragma once
+
+#include <imglib/color/color.hpp>
+
+#include <cstddef>
+
+namespace imglib
+{
+	// Layout of an image as a codec reads or writes it, known before any pixel data is decoded.
+	struct ImageLayout
+	{
+		size_t height{ 0 };
+		size_t width{ 0 };
+		ColorSpace color_space{ ColorSpace::Unspecified };
+		size_t num_channels{ 0 };
+		int bit_depth{ 0 };
+	};
+}
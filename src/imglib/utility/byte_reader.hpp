@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <span>
+
+namespace imglib::detail
+{
+	// Sequential reads from a file or from memory, for parsing file headers without decoding. Files are read through the
+	// stdio buffer and skipped parts are seeked over.
+	class ByteReader
+	{
+	public:
+
+		explicit ByteReader(FILE* file) noexcept : m_file{ file } { }
+
+		explicit ByteReader(std::span<const std::byte> data) noexcept : m_data{ data } { }
+
+		// Returns false if fewer than count bytes are left.
+		bool read(void* out, size_t count) noexcept
+		{
+			if (m_file)
+				return fread(out, 1, count, m_file) == count;
+
+			if (count > m_data.size() - m_position)
+				return false;
+
+			std::memcpy(out, m_data.data() + m_position, count);
+			m_position += count;
+			return true;
+		}
+
+		bool skip(size_t count) noexcept
+		{
+			if (m_file)
+			{
+				// fseek takes a long, which has 32 bits on Windows.
+				constexpr size_t maxStep{ 1u << 30 };
+				for (; count > 0; count -= std::min(count, maxStep))
+				{
+					if (fseek(m_file, static_cast<long>(std::min(count, maxStep)), SEEK_CUR) != 0)
+						return false;
+				}
+
+				return true;
+			}
+
+			if (count > m_data.size() - m_position)
+				return false;
+
+			m_position += count;
+			return true;
+		}
+
+	private:
+		FILE* m_file{ nullptr };
+		std::span<const std::byte> m_data;
+		size_t m_position{ 0 };
+	};
+}
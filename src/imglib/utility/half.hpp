@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+namespace imglib
+{
+	namespace detail
+	{
+		// IEEE 754 binary32 to binary16 with round to nearest even, overflow gives infinity and NaN stays NaN.
+		constexpr std::uint16_t float_to_half_bits(float value) noexcept
+		{
+			constexpr std::uint32_t f32Infinity = 255u << 23;
+			constexpr std::uint32_t f16Overflow = (127u + 16u) << 23;
+			constexpr std::uint32_t f16MinNormal = 113u << 23;
+			constexpr std::uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+			std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+			const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+			bits &= 0x7FFFFFFFu;
+
+			if (bits >= f16Overflow)
+				return static_cast<std::uint16_t>(sign | (bits > f32Infinity ? 0x7E00u : 0x7C00u));
+
+			// Subnormal results: adding 0.5 lets the floating point unit do the rounding to multiples of 2^-24.
+			if (bits < f16MinNormal)
+			{
+				float shifted = std::bit_cast<float>(bits) + std::bit_cast<float>(denormMagic);
+				return static_cast<std::uint16_t>(sign | (std::bit_cast<std::uint32_t>(shifted) - denormMagic));
+			}
+
+			// Rebias the exponent and round the 13 dropped mantissa bits, ties go to the even result.
+			std::uint32_t mantissaOdd = (bits >> 13) & 1u;
+			bits += (static_cast<std::uint32_t>(15 - 127) << 23) + 0xFFFu + mantissaOdd;
+			return static_cast<std::uint16_t>(sign | (bits >> 13));
+		}
+
+		constexpr float half_bits_to_float(std::uint16_t value) noexcept
+		{
+			constexpr std::uint32_t shiftedExponent = 0x7C00u << 13;
+			constexpr float minNormal = std::bit_cast<float>(113u << 23);
+
+			std::uint32_t bits = (value & 0x7FFFu) << 13;
+			const std::uint32_t exponent = bits & shiftedExponent;
+			bits += (127u - 15u) << 23;
+
+			if (exponent == shiftedExponent)
+			{
+				bits += (128u - 16u) << 23;     // infinity or NaN
+			}
+			else if (exponent == 0)
+			{
+				bits += 1u << 23;               // zero or subnormal, renormalized by the subtraction
+				bits = std::bit_cast<std::uint32_t>(std::bit_cast<float>(bits) - minNormal);
+			}
+
+			return std::bit_cast<float>(bits | (static_cast<std::uint32_t>(value & 0x8000u) << 16));
+		}
+	}
+
+	// 16-bit floating point sample type, a storage format only: arithmetic is done after conversion to float.
+	struct half
+	{
+		std::uint16_t bits{ 0 };
+
+		constexpr half() noexcept = default;
+
+		constexpr explicit half(float value) noexcept : bits{ detail::float_to_half_bits(value) } { }
+
+		constexpr explicit operator float() const noexcept { return detail::half_bits_to_float(bits); }
+
+		static constexpr half from_bits(std::uint16_t bits) noexcept
+		{
+			half h;
+			h.bits = bits;
+			return h;
+		}
+
+		constexpr bool operator==(const half& other) const noexcept = default;
+	};
+}
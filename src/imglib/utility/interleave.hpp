@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+
+namespace imglib
+{
+	namespace detail
+	{
+		// With the number of channels known at compile time the loops have constant strides and vectorize.
+		template <size_t NumChannels, typename T>
+		void deinterleave_row(T const* src, T* const* dst, size_t width) noexcept
+		{
+			for (size_t t = 0; t < NumChannels; t++)
+			{
+				T* plane = dst[t];
+				for (size_t i = 0; i < width; i++)
+					plane[i] = src[i * NumChannels + t];
+			}
+		}
+
+		template <size_t NumChannels, typename T>
+		void interleave_row(T const* const* src, T* dst, size_t width) noexcept
+		{
+			for (size_t t = 0; t < NumChannels; t++)
+			{
+				T const* plane = src[t];
+				for (size_t i = 0; i < width; i++)
+					dst[i * NumChannels + t] = plane[i];
+			}
+		}
+	}
+
+	// Splits a row of interleaved samples into one row per channel.
+	template <typename T>
+	void deinterleave_row(T const* src, size_t numChannels, T* const* dst, size_t width) noexcept
+	{
+		switch (numChannels)
+		{
+		case 1:
+			detail::deinterleave_row<1>(src, dst, width);
+			break;
+		case 2:
+			detail::deinterleave_row<2>(src, dst, width);
+			break;
+		case 3:
+			detail::deinterleave_row<3>(src, dst, width);
+			break;
+		case 4:
+			detail::deinterleave_row<4>(src, dst, width);
+			break;
+		default:
+			for (size_t t = 0; t < numChannels; t++)
+				for (size_t i = 0; i < width; i++)
+					dst[t][i] = src[i * numChannels + t];
+		}
+	}
+
+	// Merges one row per channel into a row of interleaved samples.
+	template <typename T>
+	void interleave_row(T const* const* src, size_t numChannels, T* dst, size_t width) noexcept
+	{
+		switch (numChannels)
+		{
+		case 1:
+			detail::interleave_row<1>(src, dst, width);
+			break;
+		case 2:
+			detail::interleave_row<2>(src, dst, width);
+			break;
+		case 3:
+			detail::interleave_row<3>(src, dst, width);
+			break;
+		case 4:
+			detail::interleave_row<4>(src, dst, width);
+			break;
+		default:
+			for (size_t t = 0; t < numChannels; t++)
+				for (size_t i = 0; i < width; i++)
+					dst[i * numChannels + t] = src[t][i];
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace imglib
+{
+	// Returns the number of worker threads to use, 0 means one thread per hardware core.
+	inline size_t GetNumThreads(size_t numThreads = 0) noexcept
+	{
+		if (numThreads == 0)
+			numThreads = std::thread::hardware_concurrency();
+
+		return numThreads == 0 ? 1 : numThreads;
+	}
+
+	// Splits [begin, end) into contiguous bands and calls func(bandIndex, bandBegin, bandEnd) for each band on its own thread.
+	// The calling thread processes the first band, the function returns when all bands are done.
+	template <typename Func>
+	void parallel_for(size_t begin, size_t end, Func&& func, size_t numThreads = 0)
+	{
+		if (begin >= end)
+			return;
+
+		size_t count = end - begin;
+		size_t numBands = std::min(GetNumThreads(numThreads), count);
+		size_t bandSize = count / numBands;
+		size_t remainder = count % numBands;
+
+		std::vector<std::jthread> workers;
+		workers.reserve(numBands - 1);
+
+		size_t bandBegin = begin + bandSize + (remainder > 0 ? 1 : 0);
+		for (size_t i = 1; i < numBands; i++)
+		{
+			size_t bandEnd = bandBegin + bandSize + (i < remainder ? 1 : 0);
+			workers.emplace_back([&func, i, bandBegin, bandEnd]() { func(i, bandBegin, bandEnd); });
+			bandBegin = bandEnd;
+		}
+
+		func(size_t{ 0 }, begin, begin + bandSize + (remainder > 0 ? 1 : 0));
+	}
+}
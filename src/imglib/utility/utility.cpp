@@ -18,9 +18,12 @@ namespace imglib
             return numChannels == 2;
         case imglib::ColorSpace::RGB:
         case imglib::ColorSpace::YCbCr:
-        case imglib::ColorSpace::YCCK:
+        case imglib::ColorSpace::HSV:
+        case imglib::ColorSpace::HSL:
+        case imglib::ColorSpace::Lab:
             return numChannels == 3;
         case imglib::ColorSpace::CMYK:
+        case imglib::ColorSpace::YCCK:
         case imglib::ColorSpace::RGBA:
             return numChannels == 4;
         default: